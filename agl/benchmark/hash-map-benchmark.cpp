@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+
+#include "agl/dictionary.hpp"
+#include "agl/hash-map.hpp"
+
+// Spread like the ids of 'type_id_t', which are hashes of the type names.
+std::uint64_t make_key(std::int64_t i)
+{
+	return static_cast<std::uint64_t>(i + 1) * 0xBF58476D1CE4E5B9;
+}
+
+template <typename TMap>
+void insert(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		auto map = TMap{};
+		for (auto i = 0; i < state.range(0); ++i)
+			map[make_key(i)] = i;
+
+		benchmark::DoNotOptimize(map.size());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TMap>
+void find(benchmark::State& state)
+{
+	auto map = TMap{};
+	for (auto i = 0; i < state.range(0); ++i)
+		map[make_key(i)] = i;
+
+	auto i = std::int64_t{ 0 };
+	for (auto _ : state)
+	{
+		benchmark::DoNotOptimize(map.find(make_key(i)));
+		i = i + 1 == state.range(0) ? 0 : i + 1;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+template <typename TMap>
+void erase(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		auto map = TMap{};
+		for (auto i = 0; i < state.range(0); ++i)
+			map[make_key(i)] = i;
+		state.ResumeTiming();
+
+		for (auto i = 0; i < state.range(0); ++i)
+			map.erase(map.find(make_key(i)));
+
+		benchmark::DoNotOptimize(map.size());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+using dictionary = agl::dictionary<std::uint64_t, std::uint64_t>;
+using hash_map = agl::hash_map<std::uint64_t, std::uint64_t>;
+
+BENCHMARK_TEMPLATE(insert, dictionary)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK_TEMPLATE(insert, hash_map)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK_TEMPLATE(find, dictionary)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK_TEMPLATE(find, hash_map)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK_TEMPLATE(erase, dictionary)->RangeMultiplier(8)->Range(8, 1 << 15);
+BENCHMARK_TEMPLATE(erase, hash_map)->RangeMultiplier(8)->Range(8, 1 << 15);
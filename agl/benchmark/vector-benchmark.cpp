@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+#include "agl/vector.hpp"
+
+template <typename TVector>
+void push_back_int(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		auto vec = TVector{};
+		for (auto i = 0; i < state.range(0); ++i)
+			vec.push_back(i);
+
+		benchmark::DoNotOptimize(vec.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TVector>
+void push_back_string(benchmark::State& state)
+{
+	auto const value = std::string(32, 'x');
+	for (auto _ : state)
+	{
+		auto vec = TVector{};
+		for (auto i = 0; i < state.range(0); ++i)
+			vec.push_back(value);
+
+		benchmark::DoNotOptimize(vec.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Reserving must not construct anything.
+template <typename TVector>
+void reserve_string(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		auto vec = TVector{};
+		vec.reserve(state.range(0));
+		benchmark::DoNotOptimize(vec.data());
+	}
+}
+
+template <typename TVector>
+void insert_front_int(benchmark::State& state)
+{
+	for (auto _ : state)
+	{
+		auto vec = TVector{};
+		for (auto i = 0; i < state.range(0); ++i)
+			vec.insert(vec.cbegin(), i);
+
+		benchmark::DoNotOptimize(vec.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename TVector>
+void erase_front_string(benchmark::State& state)
+{
+	auto const value = std::string(32, 'x');
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		auto vec = TVector{};
+		vec.reserve(state.range(0));
+		for (auto i = 0; i < state.range(0); ++i)
+			vec.push_back(value);
+		state.ResumeTiming();
+
+		while (!vec.empty())
+			vec.erase(vec.cbegin());
+
+		benchmark::DoNotOptimize(vec.data());
+	}
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(push_back_int, agl::vector<int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(push_back_int, std::vector<int>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(push_back_string, agl::vector<std::string>)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(push_back_string, std::vector<std::string>)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(reserve_string, agl::vector<std::string>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(reserve_string, std::vector<std::string>)->Range(1 << 10, 1 << 20);
+BENCHMARK_TEMPLATE(insert_front_int, agl::vector<int>)->Range(1 << 8, 1 << 12);
+BENCHMARK_TEMPLATE(insert_front_int, std::vector<int>)->Range(1 << 8, 1 << 12);
+BENCHMARK_TEMPLATE(erase_front_string, agl::vector<std::string>)->Range(1 << 8, 1 << 12);
+BENCHMARK_TEMPLATE(erase_front_string, std::vector<std::string>)->Range(1 << 8, 1 << 12);
@@ -1,4 +1,7 @@
 #pragma once
+#include <atomic>
+#include <limits>
+#include <mutex>
 #include "agl/util/async.hpp"
 #include "agl/dictionary.hpp"
 #include "agl/util/typeid.hpp"
@@ -13,17 +16,26 @@ class application;
 class resource_base
 {
 public:
-	resource_base(type_id_t id = {});
+	static std::uint32_t invalid_index()
+	{
+		return std::numeric_limits<std::uint32_t>::max();
+	}
+
+public:
+	resource_base(type_id_t id = {}, std::uint32_t index = invalid_index());
 	resource_base(resource_base&&) = default;
 	resource_base& operator=(resource_base&&) = default;
 	virtual ~resource_base() = default;
 	virtual void on_attach(application*) = 0;
 	virtual void on_detach(application*) = 0;
 	virtual void on_update(application*) = 0;
+	// Dense 'type_index' of the resource type in the 'resource_base' family, 'invalid_index()' if not given.
+	std::uint32_t index() const;
 	type_id_t type() const;
 
 private:
 	type_id_t m_id;
+	std::uint32_t m_index;
 };
 
 template <typename T>
@@ -31,10 +43,14 @@ class resource
 	: public resource_base
 {
 public:
-	using resource_base::resource_base;
 	resource()
-		: resource_base{ type_id<T>::get_id() }
+		: resource<T>{ type_id<T>::get_id() }
+	{
+	}
+	resource(type_id_t id)
+		: resource_base{ id, type_index<T, resource_base>::get() }
 	{
+		AGL_ASSERT(id == type_id<T>::get_id(), "resource registered under the id of another type");
 	}
 };
 
@@ -49,8 +65,8 @@ public:
 	};
 
 public:
-	application() = default;
-	application(application&&) = default;
+	application();
+	application(application&& other);
 	application(application const&) = delete;
 	application& operator=(application&&) = delete;
 	application& operator=(application const&) = delete;
@@ -78,18 +94,41 @@ public:
 	template <typename T>
 	void remove_resource();
 
+	// Frees the resource tables replaced before the previous call, so a table stays alive for at least one full frame after it got replaced. Called at the end of every frame and by 'close'.
+	void reclaim_tables();
+	// Number of resource tables alive, the current one included.
+	std::size_t resource_tables();
+
 private:
 	friend int ::main(int, char**);
 
 private:
+	/**
+	 * @brief
+	 * Immutable snapshot of 'm_resources' by 'resource_base::index', nullptr for absent resources.
+	 * Never changed once published, adding or removing a resource publishes a copy instead so that readers need no lock.
+	 */
+	struct resource_table
+	{
+		vector<resource_base*> resources;
+	};
+
+private:
+	// Publishes a copy of the current table with 'resource' at 'index' and retires the replaced one, must be called with 'm_mutex' held.
+	void publish_resource(std::uint32_t index, resource_base* resource);
+	// Entry of the current table at 'index', nullptr if out of range.
+	resource_base* read_table(std::uint32_t index) const;
 	void run();
 
 private:
 	bool m_good;
-	unique_ptr<std::mutex> m_mutex;
+	unique_ptr<std::recursive_mutex> m_mutex; // guards structural changes, recursive since resources look other resources up from 'on_detach', which runs with it held. 'get_resource<T>' does not take it
 	properties m_properties;
 	dictionary<type_id_t, unique_ptr<resource_base>> m_resources;
 	vector<type_id_t> m_resources_order;
+	std::atomic<resource_table const*> m_table{ nullptr }; // current snapshot, owned
+	vector<resource_table const*> m_retired; // replaced since the last 'reclaim_tables', readers may still hold them
+	vector<resource_table const*> m_retiring; // replaced before the last 'reclaim_tables', freed by the next one
 };
 
 template <typename T>
@@ -106,9 +145,11 @@ void application::remove_resource()
 template <typename T>
 T& application::get_resource()
 {
-	auto* ptr = get_resource(type_id<T>::get_id());
+	auto* ptr = read_table(type_index<T, resource_base>::get());
 
-	std::lock_guard<std::mutex> lock{ *m_mutex };
+	// resources not made through 'resource<T>' have no index
+	if (ptr == nullptr)
+		ptr = get_resource(type_id<T>::get_id());
 
 	auto* cast = reinterpret_cast<T*>(ptr);
 
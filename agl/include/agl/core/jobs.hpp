@@ -0,0 +1,272 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include "agl/core/application.hpp"
+#include "agl/memory/object-pool.hpp"
+#include "agl/unique-ptr.hpp"
+#include "agl/vector.hpp"
+
+namespace agl
+{
+class jobs;
+
+namespace impl
+{
+struct job
+{
+	// Callables up to this size are stored in the job itself, larger ones in a 'std::function'.
+	static constexpr std::uint64_t function_size = 64;
+
+	alignas(std::max_align_t) std::byte function[function_size];
+	void (*invoke)(job& j);
+	void (*destroy)(job& j); // destructs the stored callable
+	job* parent;
+	std::atomic<std::uint32_t> references; // handles plus one released once the job is done
+	std::atomic<std::uint32_t> unfinished; // the job itself plus its unfinished children
+	std::mutex mutex; // guards 'continuations'
+	vector<job*> continuations;
+};
+
+template <typename TFun>
+void store_function(job& j, TFun&& fun)
+{
+	using function_type = std::decay_t<TFun>;
+	if constexpr (sizeof(function_type) <= job::function_size && alignof(function_type) <= alignof(std::max_align_t))
+	{
+		new (j.function) function_type(std::forward<TFun>(fun));
+		j.invoke = [](job& self) { (*reinterpret_cast<function_type*>(self.function))(); };
+		j.destroy = [](job& self) { reinterpret_cast<function_type*>(self.function)->~function_type(); };
+	}
+	else
+	{
+		static_assert(sizeof(std::function<void()>) <= job::function_size, "std::function does not fit into a job");
+		store_function(j, std::function<void()>{ std::forward<TFun>(fun) });
+	}
+}
+
+/**
+ * @brief
+ * Fixed capacity Chase-Lev work-stealing deque. Only the owning worker pushes and pops at the bottom, any other thread steals from the top without taking a lock.
+ */
+class job_deque
+{
+public:
+	// Power of two, positions are wrapped with 'capacity - 1'.
+	static constexpr std::int64_t capacity = 4096;
+
+public:
+	job_deque();
+	job_deque(job_deque const&) = delete;
+	job_deque& operator=(job_deque const&) = delete;
+
+	// Owner only. Returns false if the deque is full.
+	bool push(job* j);
+	// Owner only.
+	job* pop();
+	// May fail spuriously when racing with another thief or the owner.
+	job* steal();
+
+private:
+	std::atomic<std::int64_t> m_bottom;
+	std::atomic<job*> m_buffer[capacity];
+	std::atomic<std::int64_t> m_top;
+};
+}
+
+/**
+ * @brief
+ * Reference to a job queued in 'jobs'. Handles can be copied and discarded freely, the job is released once it is done and no handle refers to it.
+ */
+class job_handle
+{
+public:
+	job_handle();
+	job_handle(jobs* owner, impl::job* job);
+	job_handle(job_handle const& other);
+	job_handle(job_handle&& other);
+	job_handle& operator=(job_handle const& other);
+	job_handle& operator=(job_handle&& other);
+	~job_handle();
+
+	// The job and all of its children have finished.
+	bool is_done() const;
+	bool is_valid() const;
+	// Executes other queued jobs on the calling thread until the job is done.
+	void wait() const;
+
+private:
+	friend class jobs;
+
+	void reset();
+
+private:
+	impl::job* m_job;
+	jobs* m_jobs;
+};
+
+/**
+ * @brief
+ * Shared worker pool of the application, meant to be used instead of spinning dedicated threads.
+ * Every worker owns a lock-free deque it pushes its own jobs to, idle workers steal from the others. Jobs queued from any other thread go through a shared queue.
+ * Threads waiting for a job (see 'job_handle::wait' and 'parallel_for') execute queued jobs meanwhile, so waiting from inside a job does not deadlock.
+ * Until the resource is attached, or if it has no workers, jobs are executed immediately on the calling thread.
+ *
+ * @dependencies
+ * - 'application'
+ */
+class jobs final
+	: public resource<jobs>
+{
+public:
+	static std::uint64_t default_worker_count();
+	static std::uint64_t invalid_worker()
+	{
+		return std::numeric_limits<std::uint64_t>::max();
+	}
+
+public:
+	jobs(std::uint64_t worker_count = default_worker_count());
+	jobs(jobs&& other);
+	jobs(jobs const&) = delete;
+	jobs& operator=(jobs const&) = delete;
+	~jobs();
+
+	// Index of the calling worker, 'invalid_worker()' if called from any other thread.
+	std::uint64_t current_worker() const;
+
+	// Runs one queued job on the calling thread. Returns false if there was none.
+	bool execute_one();
+
+	// Calls 'fun(first, last)' for consecutive subranges of at most 'grain' elements of [first, last) in parallel, returns once all of them are done.
+	template <typename TFun>
+	void parallel_for(std::uint64_t first, std::uint64_t last, std::uint64_t grain, TFun&& fun);
+
+	// Queues 'fun', the handle may be discarded.
+	template <typename TFun>
+	job_handle run(TFun&& fun);
+
+	// Queues 'fun' as a child of 'parent', which is not done until all of its children are.
+	template <typename TFun>
+	job_handle run(job_handle const& parent, TFun&& fun);
+
+	// Queues 'fun' once 'job' is done.
+	template <typename TFun>
+	job_handle then(job_handle const& job, TFun&& fun);
+
+	// Number of running workers, zero until the resource is attached.
+	std::uint64_t worker_count() const;
+
+private:
+	friend class job_handle;
+
+	virtual void on_attach(application* app) override;
+	virtual void on_detach(application* app) override;
+	virtual void on_update(application* app) override;
+
+	void execute(impl::job* j);
+	void finish(impl::job* j);
+	// Takes a job from 'm_job_pool', the callable is stored by 'make_job'.
+	impl::job* allocate_job(impl::job* parent);
+	template <typename TFun>
+	impl::job* make_job(TFun&& fun, impl::job* parent);
+	void release(impl::job* j);
+	void submit(impl::job* j);
+	impl::job* take();
+	void worker_loop(std::uint64_t index);
+
+private:
+	std::condition_variable m_cond_var;
+	vector<unique_ptr<impl::job_deque>> m_deques; // one per worker
+	std::atomic<std::uint64_t> m_injected_count; // jobs in 'm_injected' not taken yet, read without 'm_mutex'
+	std::uint64_t m_injected_head;
+	vector<impl::job*> m_injected; // jobs queued by non-worker threads, guarded by 'm_mutex'
+	mem::object_pool<impl::job> m_job_pool; // jobs are made and released on every thread, guarded by 'm_job_pool_mutex'
+	std::mutex m_job_pool_mutex;
+	std::mutex m_mutex;
+	std::atomic<std::uint64_t> m_queued;
+	std::atomic<std::uint64_t> m_sleeping;
+	std::atomic<bool> m_stop;
+	std::uint64_t m_worker_count;
+	vector<std::thread> m_workers;
+};
+
+template <typename TFun>
+void jobs::parallel_for(std::uint64_t first, std::uint64_t last, std::uint64_t grain, TFun&& fun)
+{
+	AGL_ASSERT(grain > 0, "invalid grain");
+
+	if (first >= last)
+		return;
+
+	if (m_workers.empty() || last - first <= grain)
+	{
+		fun(first, last);
+		return;
+	}
+
+	auto root = job_handle{ this, make_job([]() {}, nullptr) };
+	for (auto begin = first; begin < last; begin += grain)
+	{
+		auto const end = std::min(begin + grain, last);
+		run(root, [&fun, begin, end]() { fun(begin, end); });
+	}
+
+	// the root has no work of its own
+	finish(root.m_job);
+	root.wait();
+}
+template <typename TFun>
+impl::job* jobs::make_job(TFun&& fun, impl::job* parent)
+{
+	auto* j = allocate_job(parent);
+	impl::store_function(*j, std::forward<TFun>(fun));
+	return j;
+}
+template <typename TFun>
+job_handle jobs::run(TFun&& fun)
+{
+	auto* j = make_job(std::forward<TFun>(fun), nullptr);
+	auto handle = job_handle{ this, j };
+	submit(j);
+	return handle;
+}
+template <typename TFun>
+job_handle jobs::run(job_handle const& parent, TFun&& fun)
+{
+	AGL_ASSERT(parent.is_valid() && !parent.is_done(), "parent job already done");
+
+	auto* j = make_job(std::forward<TFun>(fun), parent.m_job);
+	auto handle = job_handle{ this, j };
+	submit(j);
+	return handle;
+}
+template <typename TFun>
+job_handle jobs::then(job_handle const& job, TFun&& fun)
+{
+	AGL_ASSERT(job.is_valid(), "invalid job");
+
+	auto* j = make_job(std::forward<TFun>(fun), nullptr);
+	auto handle = job_handle{ this, j };
+	auto ready = false;
+	{
+		std::lock_guard<std::mutex> lock{ job.m_job->mutex };
+		if (job.m_job->unfinished.load() == 0)
+			ready = true;
+		else
+			job.m_job->continuations.push_back(j);
+	}
+
+	if (ready)
+		submit(j);
+
+	return handle;
+}
+}
@@ -1,16 +1,143 @@
 #pragma once
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <string_view>
 #include <tuple>
 #include <sstream>
 #include "date/date.h"
 #include "agl/core/application.hpp"
 #include "agl/util/async.hpp"
+#include "agl/util/mpsc-ring.hpp"
 #include "agl/deque.hpp"
+#include "agl/memory/stack-arena.hpp"
+
+// Static 'log_format' of a call site, for the deferred overloads of 'logger', e.g. 'log.info(AGL_LOG_FORMAT("{} jobs done"), count);'.
+#define AGL_LOG_FORMAT(text) \
+		([]() -> ::agl::log_format const& \
+		{ \
+			static constexpr auto format = ::agl::log_format{ text }; \
+			return format; \
+		}())
 
 namespace agl
 {
 class thread;
 
+/**
+ * @brief
+ * Format of a deferred log message. Must outlive the logger, which only keeps a pointer to it, see 'AGL_LOG_FORMAT'.
+ */
+class log_format
+{
+public:
+	constexpr explicit log_format(char const* text)
+		: m_text{ text }
+	{
+	}
+	constexpr char const* text() const
+	{
+		return m_text;
+	}
+
+private:
+	char const* m_text;
+};
+
+namespace impl
+{
+/**
+ * @brief
+ * Copies an argument of a deferred log message into the message slot and reads it back on the logger thread.
+ * Trivially copyable arguments are copied as they are, strings by value, pointers to characters are read as strings.
+ * @tparam T decayed type of the argument
+ */
+template <typename T>
+struct log_argument
+{
+	static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>, "deferred log arguments must be trivially copyable or strings");
+
+	using decoded_type = T;
+
+	static decoded_type read(std::byte const*& src)
+	{
+		auto result = T{};
+		std::memcpy(&result, src, sizeof(T));
+		src += sizeof(T);
+		return result;
+	}
+	static std::uint64_t size(T const&)
+	{
+		return sizeof(T);
+	}
+	static std::byte* write(std::byte* dest, T const& value)
+	{
+		std::memcpy(dest, &value, sizeof(T));
+		return dest + sizeof(T);
+	}
+};
+
+struct log_string_argument
+{
+	using decoded_type = std::string_view;
+
+	static decoded_type read(std::byte const*& src)
+	{
+		auto length = std::uint32_t{};
+		std::memcpy(&length, src, sizeof(length));
+		auto const result = std::string_view{ reinterpret_cast<char const*>(src + sizeof(length)), length };
+		src += sizeof(length) + length;
+		return result;
+	}
+	static std::uint64_t size(std::string_view value)
+	{
+		return sizeof(std::uint32_t) + value.size();
+	}
+	static std::uint64_t size(char const* value)
+	{
+		return size(view(value));
+	}
+	static std::byte* write(std::byte* dest, std::string_view value)
+	{
+		auto const length = static_cast<std::uint32_t>(value.size());
+		std::memcpy(dest, &length, sizeof(length));
+		std::memcpy(dest + sizeof(length), value.data(), value.size());
+		return dest + sizeof(length) + value.size();
+	}
+	static std::byte* write(std::byte* dest, char const* value)
+	{
+		return write(dest, view(value));
+	}
+
+private:
+	// A null string is written as "(null)", 'std::string_view' may not be made from it.
+	static std::string_view view(char const* value)
+	{
+		return value != nullptr ? std::string_view{ value } : std::string_view{ "(null)" };
+	}
+};
+template <>
+struct log_argument<std::string>
+	: log_string_argument
+{
+};
+template <>
+struct log_argument<std::string_view>
+	: log_string_argument
+{
+};
+template <>
+struct log_argument<char const*>
+	: log_string_argument
+{
+};
+template <>
+struct log_argument<char*>
+	: log_string_argument
+{
+};
+}
+
 
 /**
  * @brief 
@@ -27,6 +154,11 @@ class thread;
  * 
  * Output streams are initiated in 'on_attach' method and are controlled by the AGL itself.
  * 
+ * Messages are passed to the listening thread through a bounded 'mpsc_ring', logging does not take a lock. What happens when the ring is full is given by the 'overflow_policy', 'get_dropped_count' tells how many messages were lost.
+ * 
+ * Every output has an overload taking a 'log_format' instead of a string, which defers the work to the listening thread. The caller only copies the time, a pointer to the format and the raw bytes of the arguments into the ring, the message and its date are rendered when written.
+ * Arguments must then be trivially copyable or strings. If they need more than 'max_argument_bytes()' the message is formatted right away instead.
+ * 
  * @dependencies
  * - 'application'
  * - 'threads' resource
@@ -35,10 +167,20 @@ class logger final
 	: public resource<logger>
 {
 public:
+	static std::uint64_t default_capacity()
+	{
+		return 1024;
+	}
+	static constexpr std::uint64_t max_argument_bytes()
+	{
+		return sizeof(message::arguments);
+	}
+
 	template <typename... TArgs>
 	static std::string combine_message(std::string str, TArgs&&... args);
 	
 	logger();
+	explicit logger(std::uint64_t capacity, overflow_policy policy = BLOCK_WHEN_FULL);
 	logger(logger&& other);
 	logger(logger const&) = delete;
 	logger& operator=(logger const&) = delete;
@@ -46,18 +188,31 @@ public:
 
 	template <typename... TArgs>
 	void debug(std::string const& message, TArgs&&... args);
+	template <typename... TArgs>
+	void debug(log_format const& format, TArgs&&... args);
 
 	template <typename... TArgs>
 	void error(std::string const& message, TArgs&&... args);
+	template <typename... TArgs>
+	void error(log_format const& format, TArgs&&... args);
+
+	// Messages lost to the overflow policy so far.
+	std::uint64_t get_dropped_count() const;
 
 	template <typename... TArgs>
 	void info(std::string const& message, TArgs&&... args);
+	template <typename... TArgs>
+	void info(log_format const& format, TArgs&&... args);
 
 	template <typename... TArgs>
 	void trace(std::string const& message, TArgs&&... args);
+	template <typename... TArgs>
+	void trace(log_format const& format, TArgs&&... args);
 
 	template <typename... TArgs>
 	void warning(std::string const& message, TArgs&&... args);
+	template <typename... TArgs>
+	void warning(log_format const& format, TArgs&&... args);
 
 private:
 	enum instance_index
@@ -79,13 +234,19 @@ private:
 	struct message
 	{
 		instance_index destination;
-		std::string message;
+		std::string message; // slots are reused, the string only grows until it fits the longest message
+		log_format const* format; // set only for deferred messages, whose text is rendered from 'arguments' by 'render'
+		std::string (*render)(char const* format, std::byte const* arguments);
+		std::chrono::system_clock::time_point time;
+		std::byte arguments[128];
 	};
 
 private:
 	static std::string get_date();
+	static std::string get_date(std::chrono::system_clock::time_point time);
 	static const char* get_logger_name(instance_index index);
 	bool is_active() const;
+	void notify();
 	virtual void on_attach(application* app) override;
 	virtual void on_detach(application* app) override;
 	virtual void on_update(application* app) override;
@@ -95,17 +256,24 @@ private:
 
 	template <typename... TArgs> 
 	void log(instance_index index, std::string const& message, TArgs&&... args);
+	template <typename... TArgs>
+	void log(instance_index index, log_format const& format, TArgs&&... args);
+
+	// Decodes the arguments written by the deferred 'log' and formats them.
+	template <typename... TArgs>
+	static std::string render(char const* format, std::byte const* arguments);
+	void write(message& msg);
 
 	template <typename... TArgs>
 	static std::string produce_message(instance_index index, std::string message, TArgs&&... args);
 
 	template <typename TTuple, std::uint64_t... TSequence>
-	static vector<std::string> parse_arguments(TTuple&& tuple, std::index_sequence<TSequence...>);
+	static mem::stack_vector<std::string> parse_arguments(mem::stack_arena& stack, TTuple&& tuple, std::index_sequence<TSequence...>);
 
 private:
-	std::atomic<std::uint64_t> m_messages_count;
-	vector<message> m_messages;
 	condition_variable* m_cond_var;
+	std::atomic<bool> m_consumer_waiting; // set while the listening thread waits, the producer clearing it notifies 'm_cond_var'
+	mpsc_ring<message> m_messages;
 	vector<instance> m_loggers;
 	thread* m_thread;
 	mutex* m_mutex;
@@ -118,25 +286,50 @@ void logger::debug(std::string const& message, TArgs&&... args)
 	log(DEBUG, message, std::forward<TArgs>(args)...);
 }
 template <typename... TArgs>
+void logger::debug(log_format const& format, TArgs&&... args)
+{
+	log(DEBUG, format, std::forward<TArgs>(args)...);
+}
+template <typename... TArgs>
 void logger::error(std::string const& message, TArgs&&... args)
 {
 	log(ERROR, message, std::forward<TArgs>(args)...);
 }
 template <typename... TArgs>
+void logger::error(log_format const& format, TArgs&&... args)
+{
+	log(ERROR, format, std::forward<TArgs>(args)...);
+}
+template <typename... TArgs>
 void logger::info(std::string const& message, TArgs&&... args)
 {
 	log(INFO, message, std::forward<TArgs>(args)...);
 }
 template <typename... TArgs>
+void logger::info(log_format const& format, TArgs&&... args)
+{
+	log(INFO, format, std::forward<TArgs>(args)...);
+}
+template <typename... TArgs>
 void logger::trace(std::string const& message, TArgs&&... args)
 {
 	log(TRACE, message, std::forward<TArgs>(args)...);
 }
 template <typename... TArgs>
+void logger::trace(log_format const& format, TArgs&&... args)
+{
+	log(TRACE, format, std::forward<TArgs>(args)...);
+}
+template <typename... TArgs>
 void logger::warning(std::string const& message, TArgs&&... args)
 {
 	log(WARNING, message, std::forward<TArgs>(args)...);
 }
+template <typename... TArgs>
+void logger::warning(log_format const& format, TArgs&&... args)
+{
+	log(WARNING, format, std::forward<TArgs>(args)...);
+}
 
 template <typename T>
 std::string logger::to_string(T&& v)
@@ -154,19 +347,63 @@ void logger::log(instance_index index, std::string const& message, TArgs&&... ar
 	AGL_ASSERT(is_active(), "logger is inactive");
 
 	auto const msg = get_date() + " " + produce_message(index, message, std::forward<TArgs>(args)...);
-	auto time = std::chrono::system_clock::now();
+	auto const pushed = m_messages.push([&](logger::message& slot)
+		{
+			slot.destination = index;
+			slot.message.assign(msg); // keeps the capacity of the slot
+			slot.format = nullptr;
+		});
+
+	if (pushed)
+		notify();
+}
+template <typename... TArgs>
+void logger::log(instance_index index, log_format const& format, TArgs&&... args)
+{
+	AGL_ASSERT(m_mutex != nullptr, "operation on uninitialized object");
+	AGL_ASSERT(m_cond_var != nullptr, "operation on uninitialized object");
+	AGL_ASSERT(is_active(), "logger is inactive");
+
+	auto const size = (std::uint64_t{ 0 } + ... + impl::log_argument<std::decay_t<TArgs>>::size(args));
+	if (size > max_argument_bytes())
 	{
-		std::lock_guard<std::mutex> lock{ *m_mutex };
-		m_messages.push_back({ index, msg });
+		log(index, std::string{ format.text() }, std::forward<TArgs>(args)...);
+		return;
 	}
-	++m_messages_count;
-	m_cond_var->notify_one();
+
+	auto const time = std::chrono::system_clock::now();
+	auto const pushed = m_messages.push([&](logger::message& slot)
+		{
+			slot.destination = index;
+			slot.format = &format;
+			slot.render = &render<std::decay_t<TArgs>...>;
+			slot.time = time;
+
+			auto* dest = slot.arguments;
+			((dest = impl::log_argument<std::decay_t<TArgs>>::write(dest, args)), ...);
+		});
+
+	if (pushed)
+		notify();
+}
+template <typename... TArgs>
+std::string logger::render(char const* format, std::byte const* arguments)
+{
+	// the elements of a braced list are evaluated in order, which is the order they were written in
+	auto const decoded = std::tuple<typename impl::log_argument<TArgs>::decoded_type...>{ impl::log_argument<TArgs>::read(arguments)... };
+	return std::apply([format](auto const&... args)
+		{
+			return combine_message(format, args...);
+		}, decoded);
 }
 
 template <typename... TArgs>
 std::string logger::combine_message(std::string message, TArgs&&... args)
 {
-	auto const parsed = parse_arguments(std::forward_as_tuple(std::forward<TArgs>(args)...), std::make_index_sequence<sizeof... (TArgs)>{});
+	// the parsed arguments only live for this call
+	auto& stack = mem::stack_arena::get_thread_stack();
+	auto const scope = mem::stack_arena::scope{ stack };
+	auto const parsed = parse_arguments(stack, std::forward_as_tuple(std::forward<TArgs>(args)...), std::make_index_sequence<sizeof... (TArgs)>{});
 	auto found_l = std::uint64_t{};
 	auto arg_index = std::uint64_t{};
 	auto current_index = std::uint64_t{};
@@ -203,9 +440,10 @@ std::string logger::produce_message(instance_index index, std::string message, T
 	return message;
 }
 template <typename TTuple, std::uint64_t... TSequence>
-vector<std::string> logger::parse_arguments(TTuple&& tuple, std::index_sequence<TSequence...>)
+mem::stack_vector<std::string> logger::parse_arguments(mem::stack_arena& stack, TTuple&& tuple, std::index_sequence<TSequence...>)
 {
-	auto vec = vector<std::string>{};
+	auto vec = mem::stack_vector<std::string>{ stack.make_allocator<std::string>() };
+	vec.reserve(sizeof...(TSequence));
 	(vec.push_back(to_string(std::get<TSequence>(tuple))), ...);
 
 	return vec;
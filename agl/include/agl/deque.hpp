@@ -1,4 +1,5 @@
 #pragma once
+#include <cstring>
 #include "agl/vector.hpp"
 
 namespace agl
@@ -25,17 +26,29 @@ public:
 	}
 	void push(difference_type index, difference_type size = 1)
 	{
-		constexpr auto const comp = [](space const& s, difference_type index) { return s.index >= index; };
+		constexpr auto const comp = [](difference_type index, space const& s) { return index < static_cast<difference_type>(s.index); };
 
-		// check if any space overlaps with this and merge it
-		// TODO: maybe it might be necessary to find just the first occurrence of the overlap
+		// spaces are sorted by index, merge the new one with its neighbours if they touch
+		auto it = std::upper_bound(m_spaces.begin(), m_spaces.end(), index, comp);
+		if (it != m_spaces.begin())
+		{
+			auto prev = it - 1;
+			if (static_cast<difference_type>(prev->index + prev->size) == index)
+			{
+				prev->size += static_cast<std::uint32_t>(size);
+				if (it != m_spaces.end() && static_cast<difference_type>(prev->index + prev->size) == static_cast<difference_type>(it->index))
+				{
+					prev->size += it->size;
+					m_spaces.erase(it);
+				}
+				return;
+			}
+		}
 
-		// check for overlap
-		auto it = std::lower_bound(m_spaces.begin(), m_spaces.end(), index + size, comp);
-		if (it != m_spaces.end())
+		if (it != m_spaces.end() && index + size == static_cast<difference_type>(it->index))
 		{
+			it->index = static_cast<std::uint32_t>(index);
 			it->size += static_cast<std::uint32_t>(size);
-			it->index -= static_cast<std::uint32_t>(size);
 		}
 		else
 			m_spaces.insert(it, space{ static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(size) });
@@ -111,9 +124,7 @@ public:
 		, m_free_spaces{ other.m_free_spaces }
 		, m_size{ other.m_size }
 	{
-		reserve(block_size());
-		for (auto i = 0; i < block_size(); ++i)
-			make_copy(m_memory + i, *(other.m_memory + i));
+		copy_slots(other);
 	}
 	block& operator=(block&& other)
 	{
@@ -141,11 +152,7 @@ public:
 		m_block_size = other.m_block_size;
 		m_free_spaces = other.m_free_spaces;
 		m_size = other.m_size;
-		
-		reserve(block_size());
-		for (auto i = 0; i < block_size(); ++i)
-			make_copy(m_memory + i, *(other.m_memory + i));
-
+		copy_slots(other);
 		return *this;
 	}
 	~block()
@@ -234,6 +241,7 @@ public:
 			reserve(block_size());
 
 		auto const index = m_free_spaces.pop();
+		m_allocator.destruct(m_memory + index);
 		make_move(m_memory + index, std::forward<value_type&&>(value));
 		++m_size;
 
@@ -247,6 +255,7 @@ public:
 			reserve(block_size());
 
 		auto const index = m_free_spaces.pop();
+		m_allocator.destruct(m_memory + index);
 		make_copy(m_memory + index, value);
 		++m_size;
 
@@ -293,6 +302,21 @@ public:
 	}
 
 private:
+	// Allocates the block and copies every slot of 'other', the free spaces are left to the caller.
+	void copy_slots(block const& other)
+	{
+		if (other.m_memory == nullptr)
+			return;
+
+		m_memory = m_allocator.allocate(block_size());
+		if constexpr (std::is_trivially_copyable_v<value_type>)
+			std::memcpy(static_cast<void*>(m_memory), other.m_memory, block_size() * sizeof(value_type));
+		else
+		{
+			for (auto i = size_type{ 0 }; i < block_size(); ++i)
+				make_copy(m_memory + i, *(other.m_memory + i));
+		}
+	}
 	void make_copy(pointer dest, const_reference src)
 	{
 		if constexpr (std::is_copy_constructible_v<value_type>)
@@ -325,6 +349,19 @@ private:
 };
 }
 
+template <typename TAlloc>
+struct is_trivially_relocatable<impl::free_spaces<TAlloc>>
+	: is_trivially_relocatable<typename impl::free_spaces<TAlloc>::spaces_t>
+{
+};
+
+// Blocks are moved around by the vector holding them, the elements stay in place.
+template <typename T, typename TAlloc>
+struct is_trivially_relocatable<impl::block<T, TAlloc>>
+	: is_trivially_relocatable<typename TAlloc::template rebind<T>>
+{
+};
+
 template <typename T>
 class deque_iterator;
 
@@ -651,6 +688,12 @@ private:
 	index_vector m_indexes;
 };
 
+template <typename T, typename TAlloc>
+struct is_trivially_relocatable<deque<T, TAlloc>>
+	: is_trivially_relocatable<typename TAlloc::template rebind<T>>
+{
+};
+
 template <typename T>
 class deque_iterator
 {
@@ -8,6 +8,7 @@ namespace agl
 /**
  * @brief 
  * Shares properties with 'std::map'. Search algorithm is 'std::lower_bound'.
+ * Insertions shift the following pairs with 'std::memmove' when both the key and the value are trivially relocatable, see 'is_trivially_relocatable'.
  * @tparam TKey 
  * @tparam TValue 
  * @tparam TComp 
@@ -265,4 +266,10 @@ private:
 	key_value_comp_type m_comp;
 	vector_type m_data;
 };
+
+template <typename TKey, typename TValue, typename TComp, typename TAlloc>
+struct is_trivially_relocatable<dictionary<TKey, TValue, TComp, TAlloc>>
+	: std::bool_constant<is_trivially_relocatable_v<TComp> && is_trivially_relocatable_v<typename dictionary<TKey, TValue, TComp, TAlloc>::vector_type>>
+{
+};
 }
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+#include <limits>
+#include "agl/ecs/components.hpp"
+#include "agl/memory/dictionary.hpp"
+#include "agl/memory/vector.hpp"
+#include "agl/util/type-mask.hpp"
+#include "agl/util/typeid.hpp"
+
+namespace agl
+{
+namespace ecs
+{
+/**
+ * @brief
+ * Type erased description of a component type. Lets the archetype storage move and destroy components without knowing their static type.
+ */
+struct component_info
+{
+	type_id_t id;
+	std::uint32_t index; // see 'component_index'
+	std::uint64_t size;
+	std::uint64_t alignment;
+	void (*move)(std::byte* dest, std::byte* src); // move-constructs 'dest' from 'src'
+	void (*destruct)(std::byte* ptr);
+
+	template <typename T>
+	static component_info make();
+};
+
+/**
+ * @brief
+ * Stores every entity that owns exactly the same set of components.
+ * Rows are grouped in chunks of 'chunk_size' bytes, each chunk holding one contiguous array (column) per component, so iterating a component over all entities of the archetype streams linearly through memory.
+ * A component type attached several times to one entity occupies several adjacent columns, ordered by the index of the component.
+ */
+class archetype
+{
+public:
+	using allocator_type = mem::pool::allocator<std::byte>;
+
+	static std::uint64_t invalid_column()
+	{
+		return std::numeric_limits<std::uint64_t>::max();
+	}
+	static std::uint64_t default_chunk_size()
+	{
+		return 16 * 1024;
+	}
+
+public:
+	archetype(allocator_type const& allocator, mem::vector<component_info> const& columns, std::uint64_t chunk_size = default_chunk_size());
+	archetype(archetype&& other);
+	archetype(archetype const&) = delete;
+	archetype& operator=(archetype&& other);
+	archetype& operator=(archetype const&) = delete;
+	~archetype();
+
+	std::uint64_t chunk_capacity() const;
+	std::uint64_t chunk_count() const;
+	std::uint64_t chunk_size(std::uint64_t chunk) const;
+	std::uint64_t column_count() const;
+	std::uint64_t count(type_id_t type) const;
+	void destruct(std::uint64_t row);
+	std::uint64_t find_column(type_id_t type, std::uint64_t index = 0) const;
+	std::byte* get(std::uint64_t column, std::uint64_t row);
+	std::byte const* get(std::uint64_t column, std::uint64_t row) const;
+	std::byte* get_column(std::uint64_t chunk, std::uint64_t column);
+	component_info const& get_column_info(std::uint64_t column) const;
+	mem::vector<component_info> const& get_columns() const;
+	type_mask const& get_mask() const;
+	std::uint32_t get_entity(std::uint64_t row) const;
+	bool has_component(type_id_t type) const;
+	template <typename... TArgs>
+	bool has_components() const;
+	bool empty() const;
+	std::uint64_t size() const;
+
+	// Reserves a row for the entity of slot 'index'. Components of the row are left uninitialized and must be constructed by the caller.
+	std::uint64_t push_entity(std::uint32_t index);
+	// Releases 'row', whose components must already be destroyed or moved out. The last row is moved into its place, the index of the entity that got moved is returned ('entity::invalid_index()' if 'row' was the last one).
+	std::uint32_t pop_entity(std::uint64_t row);
+
+	archetype* get_add_edge(type_id_t type) const;
+	archetype* get_remove_edge(type_id_t type) const;
+	void set_add_edge(type_id_t type, archetype* target);
+	void set_remove_edge(type_id_t type, archetype* target);
+
+private:
+	void clear();
+	std::byte* get_chunk(std::uint64_t chunk) const;
+
+private:
+	mem::dictionary<type_id_t, archetype*> m_add_edges;
+	allocator_type m_allocator;
+	std::uint64_t m_alignment;
+	std::uint64_t m_chunk_bytes;
+	std::uint64_t m_chunk_capacity;
+	mem::vector<std::byte*> m_chunks;
+	mem::vector<component_info> m_columns;
+	mem::vector<std::uint32_t> m_entities; // entity table index of each row
+	type_mask m_mask; // component index of every column
+	mem::vector<std::uint64_t> m_offsets;
+	mem::dictionary<type_id_t, archetype*> m_remove_edges;
+};
+
+template <typename T>
+component_info component_info::make()
+{
+	auto result = component_info{};
+	result.id = type_id<T>::get_id();
+	result.index = component_index<T>();
+	result.size = sizeof(T);
+	result.alignment = alignof(T);
+	result.move = [](std::byte* dest, std::byte* src)
+		{
+			new (dest) T(std::move(*reinterpret_cast<T*>(src)));
+		};
+	result.destruct = [](std::byte* ptr)
+		{
+			reinterpret_cast<T*>(ptr)->~T();
+		};
+	return result;
+}
+template <typename... TArgs>
+bool archetype::has_components() const
+{
+	return m_mask.test_all<component_storage_base, TArgs...>();
+}
+}
+}
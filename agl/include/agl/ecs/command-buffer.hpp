@@ -0,0 +1,154 @@
+#pragma once
+#include <limits>
+#include "agl/ecs/entity.hpp"
+#include "agl/memory/pool.hpp"
+#include "agl/util/typeid.hpp"
+#include "agl/vector.hpp"
+
+namespace agl
+{
+namespace ecs
+{
+class organizer;
+
+/**
+ * @brief
+ * Records structural changes (making and destroying entities, pushing and popping components) which the organizer applies later at a sync point, see 'organizer::play_commands'.
+ * Systems running in parallel record into the buffer of their own thread (see 'organizer::get_command_buffer') instead of modifying the organizer others are iterating.
+ * On play back entities are made first, then components are pushed and popped grouped by component type and entity, so every storage is updated in one pass. Commands of an entity on a single component type keep the order they were recorded in. Entities are destroyed last. Commands targeting an entity which is no longer alive are dropped.
+ * Payloads of pushed components are stored in pages taken from the pool.
+ */
+class command_buffer
+{
+public:
+	/**
+	 * @brief
+	 * Entity made by 'make_entity', it is only made when the buffer is played back.
+	 */
+	struct pending_entity
+	{
+		std::uint32_t index;
+	};
+
+public:
+	command_buffer(mem::pool::allocator<std::byte> allocator);
+	command_buffer(command_buffer&& other);
+	command_buffer(command_buffer const&) = delete;
+	command_buffer& operator=(command_buffer&& other);
+	command_buffer& operator=(command_buffer const&) = delete;
+	~command_buffer();
+
+	void destroy_entity(entity const& ent);
+	bool empty() const;
+	pending_entity make_entity();
+
+	template <typename T>
+	void pop_component(entity const& ent, std::uint64_t index);
+
+	template <typename T>
+	void pop_components(entity const& ent);
+
+	template <typename T, typename... TArgs>
+	void push_component(entity const& ent, TArgs&&... args);
+
+	template <typename T, typename... TArgs>
+	void push_component(pending_entity ent, TArgs&&... args);
+
+	std::uint64_t size() const;
+
+private:
+	friend class organizer;
+
+	enum command_type
+	{
+		MAKE_ENTITY,
+		PUSH_COMPONENT,
+		POP_COMPONENT,
+		POP_COMPONENTS,
+		DESTROY_ENTITY,
+	};
+
+	struct command
+	{
+		static std::uint32_t not_pending()
+		{
+			return std::numeric_limits<std::uint32_t>::max();
+		}
+
+		command_type type;
+		type_id_t component;
+		entity target;
+		std::uint32_t pending; // index in 'm_made' if the target is made by this buffer
+		std::uint64_t index; // component index of 'POP_COMPONENT'
+		std::uint64_t sequence; // position among the commands gathered for play back
+		std::byte* payload; // component of 'PUSH_COMPONENT'
+		void (*push)(organizer&, entity&, std::byte*);
+		void (*destroy)(std::byte*);
+	};
+
+	static std::uint64_t page_size()
+	{
+		return 4096;
+	}
+
+private:
+	// Defined in 'ecs.hpp', the organizer is incomplete here.
+	template <typename T>
+	static void push_payload(organizer& org, entity& target, std::byte* component);
+
+	struct page
+	{
+		std::byte* memory;
+		std::uint64_t size;
+	};
+
+	std::byte* allocate(std::uint64_t size, std::uint64_t alignment);
+	void clear();
+	// Gives the pages back to the pool, but the one being filled if 'keep_current'.
+	void free_pages(bool keep_current);
+	void record(command const& cmd);
+	template <typename T, typename... TArgs>
+	void record_push(entity const& ent, std::uint32_t pending, TArgs&&... args);
+
+private:
+	mem::pool::allocator<std::byte> m_allocator;
+	vector<command> m_commands;
+	vector<entity> m_made; // entities made on play back, indexed by 'pending_entity::index'
+	std::uint32_t m_pending_count;
+	std::uint64_t m_page_offset;
+	vector<page> m_pages; // payloads never move once recorded, the last page is being filled
+};
+
+template <typename T>
+void command_buffer::pop_component(entity const& ent, std::uint64_t index)
+{
+	record(command{ POP_COMPONENT, type_id<T>::get_id(), ent, command::not_pending(), index, 0, nullptr, nullptr, nullptr });
+}
+template <typename T>
+void command_buffer::pop_components(entity const& ent)
+{
+	record(command{ POP_COMPONENTS, type_id<T>::get_id(), ent, command::not_pending(), 0, 0, nullptr, nullptr, nullptr });
+}
+template <typename T, typename... TArgs>
+void command_buffer::push_component(entity const& ent, TArgs&&... args)
+{
+	record_push<T>(ent, command::not_pending(), std::forward<TArgs>(args)...);
+}
+template <typename T, typename... TArgs>
+void command_buffer::push_component(pending_entity ent, TArgs&&... args)
+{
+	AGL_ASSERT(ent.index < m_pending_count, "entity was not made by this buffer");
+
+	record_push<T>(entity{}, ent.index, std::forward<TArgs>(args)...);
+}
+template <typename T, typename... TArgs>
+void command_buffer::record_push(entity const& ent, std::uint32_t pending, TArgs&&... args)
+{
+	auto* payload = allocate(sizeof(T), alignof(T));
+	new (payload) T(std::forward<TArgs>(args)...);
+
+	auto const destroy = [](std::byte* component) { reinterpret_cast<T*>(component)->~T(); };
+	record(command{ PUSH_COMPONENT, type_id<T>::get_id(), ent, pending, 0, 0, payload, &push_payload<T>, destroy });
+}
+}
+}
@@ -1,65 +1,208 @@
 #pragma once
-#include "agl/memory/deque.hpp"
-#include "agl/memory/set.hpp"
+#include <limits>
+#include "agl/memory/vector.hpp"
 #include "agl/util/typeid.hpp"
 
 namespace agl
 {
 namespace ecs
 {
+/**
+ * @brief
+ * Identifies which component of which entity occupies a slot of a 'component_storage'.
+ */
+struct component_owner
+{
+	static std::uint32_t invalid_entity()
+	{
+		return std::numeric_limits<std::uint32_t>::max();
+	}
+
+	std::uint32_t entity; // entity table index
+	std::uint32_t instance; // index of the component among the components of the same type of the entity
+};
+
+/**
+ * @brief
+ * Reference to a component kept by its entity, 'slot' is the position of the component in its storage.
+ */
+struct component_ref
+{
+	std::byte* ptr;
+	std::uint64_t slot;
+};
+
 // make this CRTP
 class component_storage_base
 {
 public:
-	component_storage_base() = default;
+	explicit component_storage_base(std::uint32_t index)
+		: m_index{ index }
+	{
+	}
 	component_storage_base(component_storage_base&&) = default;
 	component_storage_base& operator=(component_storage_base&&) = default;
 	virtual ~component_storage_base() = default;
-	virtual void pop_component(std::byte* ptr) = 0;
+
+	virtual std::byte* get(std::uint64_t slot) = 0;
+	virtual component_owner get_owner(std::uint64_t slot) const = 0;
+	// Destroys the component in 'slot' and moves the last one in its place. Returns the owner of the moved component, its entity is 'component_owner::invalid_entity()' if nothing was moved.
+	virtual component_owner pop_component(std::uint64_t slot) = 0;
+	virtual void set_owner(std::uint64_t slot, component_owner owner) = 0;
 	virtual std::uint64_t size() const = 0;
+
+	// Component index of the stored type.
+	std::uint32_t index() const
+	{
+		return m_index;
+	}
+
+private:
+	std::uint32_t m_index;
 };
 
+// Dense index of the component type 'T', used for flat lookup tables and 'type_mask'.
+template <typename T>
+std::uint32_t component_index()
+{
+	return type_index<T, component_storage_base>::get();
+}
+
+/**
+ * @brief
+ * Dense array of components of type 'T' split into pages of 'page_size' elements, so growing the storage never moves existing components.
+ * Every slot remembers its owner, which lets removal swap the last component into the freed slot in constant time and tell the organizer whose reference must be fixed up.
+ * @tparam T
+ */
 template <typename T>
 class component_storage
 	: public component_storage_base
 {
 public:
-	component_storage() {}
-	component_storage(typename mem::deque<T>::allocator_type const& allocator)
-		: m_storage{ allocator }
+	using allocator_type = mem::pool::allocator<T>;
+
+	static std::uint64_t default_page_size()
 	{
+		return std::max<std::uint64_t>(4096 / sizeof(T), 1);
 	}
-	component_storage(typename mem::deque<T>::allocator_type const& allocator, std::uint64_t block_size)
-		: m_storage{ allocator, block_size }
+
+public:
+	component_storage(allocator_type const& allocator = {}, std::uint64_t page_size = default_page_size())
+		: component_storage_base{ component_index<T>() }
+		, m_allocator{ allocator }
+		, m_owners{ allocator }
+		, m_page_size{ page_size }
+		, m_pages{ allocator }
 	{
+		AGL_ASSERT(page_size > 0, "invalid page size");
 	}
 	component_storage(component_storage&& other)
-		: m_storage{ std::move(other.m_storage) }
+		: component_storage_base{ std::move(other) }
+		, m_allocator{ std::move(other.m_allocator) }
+		, m_owners{ std::move(other.m_owners) }
+		, m_page_size{ other.m_page_size }
+		, m_pages{ std::move(other.m_pages) }
 	{
 	}
 	component_storage& operator=(component_storage&& other)
 	{
-		m_storage = std::move(other.m_storage);
+		if (this == &other)
+			return *this;
+
+		clear();
+
+		m_allocator = std::move(other.m_allocator);
+		m_owners = std::move(other.m_owners);
+		m_page_size = other.m_page_size;
+		m_pages = std::move(other.m_pages);
 		return *this;
 	}
-	~component_storage() {}
-	template <typename... TArgs> 
-	T* push_component(TArgs&&... args)
+	~component_storage()
+	{
+		clear();
+	}
+	template <typename... TArgs>
+	std::uint64_t push_component(component_owner owner, TArgs&&... args)
 	{
-		return &(*m_storage.emplace_back(std::forward<TArgs>(args)...));
+		auto const slot = size();
+		if (slot == m_pages.size() * m_page_size)
+			m_pages.push_back(m_allocator.allocate(m_page_size));
+
+		m_owners.push_back(owner);
+		new (get_typed(slot)) T(std::forward<TArgs>(args)...);
+		return slot;
 	}
-	virtual void pop_component(std::byte* ptr) override
+	virtual std::byte* get(std::uint64_t slot) override
 	{
-		m_storage.erase(reinterpret_cast<T*>(ptr));
+		return reinterpret_cast<std::byte*>(get_typed(slot));
 	}
+	virtual component_owner get_owner(std::uint64_t slot) const override
+	{
+		AGL_ASSERT(slot < size(), "index out of bounds");
 
+		return m_owners[slot];
+	}
+	virtual component_owner pop_component(std::uint64_t slot) override
+	{
+		AGL_ASSERT(slot < size(), "index out of bounds");
+
+		auto moved = component_owner{ component_owner::invalid_entity(), 0 };
+		auto const last = size() - 1;
+
+		get_typed(slot)->~T();
+		if (slot != last)
+		{
+			new (get_typed(slot)) T(std::move(*get_typed(last)));
+			get_typed(last)->~T();
+
+			moved = m_owners[last];
+			m_owners[slot] = moved;
+		}
+		m_owners.pop_back();
+
+		// release the trailing page as soon as it holds no components
+		if (m_pages.size() > (size() + m_page_size - 1) / m_page_size)
+		{
+			m_allocator.deallocate(m_pages.back(), m_page_size);
+			m_pages.pop_back();
+		}
+		return moved;
+	}
+	virtual void set_owner(std::uint64_t slot, component_owner owner) override
+	{
+		AGL_ASSERT(slot < size(), "index out of bounds");
+
+		m_owners[slot] = owner;
+	}
 	virtual std::uint64_t size() const override
 	{
-		return m_storage.size();
+		return m_owners.size();
+	}
+
+private:
+	void clear()
+	{
+		for (auto slot = std::uint64_t{ 0 }; slot < size(); ++slot)
+			get_typed(slot)->~T();
+
+		for (auto* page : m_pages)
+			m_allocator.deallocate(page, m_page_size);
+
+		m_owners.clear();
+		m_pages.clear();
+	}
+	T* get_typed(std::uint64_t slot) const
+	{
+		AGL_ASSERT(slot / m_page_size < m_pages.size(), "index out of bounds");
+
+		return m_pages[slot / m_page_size] + slot % m_page_size;
 	}
 
 private:
-	mem::deque<T> m_storage;
+	allocator_type m_allocator;
+	mem::vector<component_owner> m_owners;
+	std::uint64_t m_page_size;
+	mem::vector<T*> m_pages;
 };
 }
-}
\ No newline at end of file
+}
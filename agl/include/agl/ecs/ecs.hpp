@@ -1,10 +1,20 @@
 #pragma once
 #include <any>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "agl/core/application.hpp"
+#include "agl/ecs/archetype.hpp"
+#include "agl/ecs/command-buffer.hpp"
 #include "agl/ecs/components.hpp"
 #include "agl/ecs/entity.hpp"
+#include "agl/ecs/query.hpp"
+#include "agl/ecs/scheduler.hpp"
 #include "agl/ecs/system.hpp"
+#include "agl/memory/hash-map.hpp"
 #include "agl/memory/unique-ptr.hpp"
+#include "agl/unique-ptr.hpp"
 #include "agl/util/typeid.hpp"
 #include "agl/util/type-traits.hpp"
 
@@ -12,7 +22,19 @@ namespace agl
 {
 namespace ecs
 {
+enum storage_type : std::uint64_t
+{
+	SPARSE_STORAGE, // every component type lives in its own 'component_storage'
+	ARCHETYPE_STORAGE, // entities sharing the same set of components share contiguous column chunks, see 'archetype'
+};
 
+/**
+ * @brief
+ * Owns entities, their components and the systems operating on them.
+ * Systems are updated by a 'scheduler', which runs systems that declared non-conflicting component access in parallel on the application's 'jobs' resource.
+ * Systems running in parallel must not make, destroy or change entities directly, they record the changes into 'get_command_buffer' instead. The commands are played back after every stage.
+ * The way components are stored is chosen per organizer with 'storage_type'. The component API is the same for both, 'ARCHETYPE_STORAGE' favours iterating with 'for_each' over large amounts of entities at the cost of moving the entity between archetypes every time a component is pushed or popped.
+ */
 class organizer
 	: public resource<organizer>
 {
@@ -24,7 +46,8 @@ private:
 	using is_system_t = std::enable_if_t<std::is_base_of_v<system_base, remove_cvref_t<T>>>;
 
 public:
-	organizer(mem::pool::allocator<organizer> allocator);
+	organizer(mem::pool::allocator<organizer> allocator, storage_type storage = SPARSE_STORAGE, std::uint64_t chunk_size = archetype::default_chunk_size());
+	// Queries, systems, recorded commands and 'entity' handles follow the organizer.
 	organizer(organizer&& other);
 	organizer& operator=(organizer&& other);
 	~organizer() = default;
@@ -37,7 +60,14 @@ public:
 	bool has_system() const;
 	bool has_system(type_id_t id) const;
 	entity make_entity();
+	// Destroys the entity and resets 'ent', other handles to it become invalid.
 	void destroy_entity(entity& ent);
+	bool is_alive(entity const& ent) const;
+
+	// Command buffer of the calling thread. Recording into it needs no locking as long as the thread is a worker of the organizer's job system.
+	command_buffer& get_command_buffer();
+	// Applies and clears the commands recorded by every thread, must not be called while systems are running.
+	void play_commands();
 
 	template <typename T>
 	void pop_components(entity& ent);
@@ -50,29 +80,101 @@ public:
 	template <typename T>
 	std::uint64_t get_component_count() const;
 	std::uint64_t get_component_count(type_id_t type_id) const;
+	// Number of components of the type held by 'ent'.
+	template <typename T>
+	std::uint64_t get_component_count(entity const& ent) const;
+	std::uint64_t get_component_count(type_id_t type_id, entity const& ent) const;
+
+	template <typename T>
+	T& get_component(entity const& ent, std::uint64_t index);
+	template <typename T>
+	T const& get_component(entity const& ent, std::uint64_t index) const;
+	vector<type_id_t> get_component_ids(entity const& ent) const;
+	// Whether 'ent' has every type of 'TArgs', in constant time per type.
+	template <typename... TArgs>
+	bool has_component(entity const& ent) const;
+	bool has_component(type_id_t type_id, entity const& ent) const;
 
 	template <typename... TArgs>
 	mem::vector<entity> view();
 
+	// Returns the query of 'TArgs', registering it on first use. The reference stays valid until the organizer is detached.
+	template <typename... TArgs>
+	query<TArgs...>& get_query();
+
+	// Calls 'fun' with the first component of each type in 'TArgs' for every entity that has all of them.
+	template <typename... TArgs, typename TFun>
+	void for_each(TFun&& fun);
+
+	// Same as 'for_each', but processes chunks of entities concurrently on the organizer's job system, see 'query::for_each_parallel'. Runs on the calling thread if there is no job system.
+	template <typename... TArgs, typename TFun>
+	void for_each_parallel(TFun&& fun, parallel_mode mode = BALANCED);
+
+	storage_type get_storage_type() const;
+
 	template <typename T>
 	void remove_system(application* app);
 
+	// Job system the systems are scheduled on, picked from the application on attach. Without one every system runs on the updating thread.
+	void set_jobs(jobs* workers);
+
 	allocator_type get_allocator() const;
 
 private:
+	static constexpr std::uint32_t query_block_size = 64;
+	static constexpr std::uint32_t query_block_count = 64;
+
+	// Registered queries by 'type_index<query<...>, impl::query_base>'. Blocks never move, so queries are looked up without locking.
+	struct query_block
+	{
+		std::array<std::atomic<impl::query_base*>, query_block_size> queries{};
+	};
+
+	// Called with 'm_queries_mutex' held.
+	impl::query_base& add_query(std::uint32_t index, mem::unique_ptr<impl::query_base> q);
+	// Slot of a live entity, asserts the handle is not expired.
+	impl::entity_data& get_data(entity const& ent);
+	impl::entity_data const& get_data(entity const& ent) const;
+	void relink();
+	void play_command(command_buffer::command& cmd);
+	impl::query_base* find_query(std::uint32_t index) const;
+	void clear_queries();
+	void take_query_blocks(organizer& other);
+	void on_component_pushed(impl::entity_data& data, type_id_t type);
+	void on_component_popped(impl::entity_data& data, type_id_t type);
 	system_base* get_system_impl(type_id_t id);
 	system_base const* get_system_impl(type_id_t id) const;
 	template <typename T>
 	component_storage<T>& get_storage();
+	archetype& get_archetype(mem::vector<component_info> const& columns);
+	archetype& get_add_target(archetype& source, component_info const& info);
+	archetype& get_remove_target(archetype& source, type_id_t type);
+	void move_entity(impl::entity_data& data, archetype& target, type_id_t removed_type, std::uint64_t removed_index);
+	void pop_storage_component(component_storage_base& storage, type_id_t type_id, std::uint64_t slot);
+	std::byte* push_archetype_component(impl::entity_data& data, component_info const& info);
 	virtual void on_attach(application*) override;
 	virtual void on_detach(application*) override;
 	virtual void on_update(application*) override;
 
 private:
 	allocator_type m_allocator;
-	mem::dictionary<type_id_t, mem::unique_ptr<component_storage_base>> m_components;
-	mem::deque<impl::entity_data> m_entities;
+	mem::vector<mem::unique_ptr<archetype>> m_archetypes;
+	std::uint64_t m_chunk_size;
+	vector<command_buffer::command*> m_command_order; // commands of every buffer sorted for play back
+	vector<unique_ptr<command_buffer>> m_command_buffers; // one per worker of the job system
+	mem::hash_map<type_id_t, mem::unique_ptr<component_storage_base>> m_components; // looked up on every component access
+	mem::unique_ptr<impl::entity_table> m_entities; // does not move with the organizer, 'entity' handles point to it
+	mem::vector<mem::unique_ptr<impl::query_base>> m_queries;
+	std::array<std::atomic<query_block*>, query_block_count> m_query_blocks{}; // filled in under 'm_queries_mutex', read without it
+	mem::vector<mem::unique_ptr<query_block>> m_query_block_storage;
+	std::mutex m_queries_mutex; // systems running in parallel may register queries
+	scheduler m_scheduler;
+	storage_type m_storage_type;
+	mem::vector<component_storage_base*> m_storages; // 'm_components' by component index, nullptr for types without storage
 	mem::vector<mem::unique_ptr<system_base>> m_systems;
+	vector<unique_ptr<command_buffer>> m_thread_commands; // buffers of threads outside of the job system, guarded by 'm_thread_commands_mutex'
+	std::mutex m_thread_commands_mutex;
+	vector<std::thread::id> m_thread_ids; // owner of each of 'm_thread_commands'
 };
 template <typename T, typename>
 T& organizer::get_system()
@@ -93,48 +195,111 @@ void organizer::pop_components(entity& ent)
 template <typename T, typename... TArgs>
 void organizer::push_component(entity& ent, TArgs... args)
 {
-	AGL_ASSERT(!ent.empty(), "entity is uninitialized");
+	AGL_ASSERT(is_alive(ent), "entity is uninitialized or destroyed");
+
+	auto& data = get_data(ent);
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		auto* ptr = push_archetype_component(data, component_info::make<T>());
+		new (ptr) T(std::forward<TArgs>(args)...);
+		return;
+	}
 
 	auto& storage = get_storage<T>();
-	auto* ptr = storage.push_component(std::forward<TArgs>(args)...);
-	ent.m_data->push_component<T>(ptr);
+	auto const owner = component_owner{ ent.index(), static_cast<std::uint32_t>(data.size(type_id<T>::get_id())) };
+	auto const slot = storage.push_component(owner, std::forward<TArgs>(args)...);
+	data.push_component(type_id<T>::get_id(), storage.index(), component_ref{ storage.get(slot), slot });
+	on_component_pushed(data, type_id<T>::get_id());
 }
 template <typename T>
 void organizer::pop_component(entity& ent, std::uint64_t index)
 {
-	AGL_ASSERT(!ent.empty(), "entity is uninitialized");
-
 	pop_component(type_id<T>::get_id(), ent, index);
 }
 template <typename... TArgs>
 mem::vector<entity> organizer::view()
 {
-	auto result = mem::vector<entity>{};
-	for (auto& e : m_entities)
-		if (e.has_component<TArgs...>())
-			result.push_back(entity{ &e });
+	auto& q = get_query<TArgs...>();
+	auto result = mem::vector<entity>{ get_allocator() };
+	result.reserve(q.size());
 
+	q.for_each_entity([&result](entity ent, TArgs&...)
+		{
+			result.push_back(ent);
+		});
 	return result;
 }
+template <typename... TArgs>
+query<TArgs...>& organizer::get_query()
+{
+	auto const index = type_index<query<TArgs...>, impl::query_base>::get();
+	if (auto* found = find_query(index))
+		return *static_cast<query<TArgs...>*>(found);
+
+	std::lock_guard<std::mutex> lock{ m_queries_mutex };
+
+	auto* found = find_query(index);
+	if (found == nullptr)
+		found = &add_query(index, mem::make_unique<impl::query_base>(get_allocator(), query<TArgs...>{ get_allocator(), *m_entities }));
+
+	return *static_cast<query<TArgs...>*>(found);
+}
+template <typename... TArgs, typename TFun>
+void organizer::for_each(TFun&& fun)
+{
+	get_query<TArgs...>().for_each(std::forward<TFun>(fun));
+}
+template <typename... TArgs, typename TFun>
+void organizer::for_each_parallel(TFun&& fun, parallel_mode mode)
+{
+	get_query<TArgs...>().for_each_parallel(m_scheduler.get_jobs(), std::forward<TFun>(fun), mode);
+}
 template <typename T>
 std::uint64_t organizer::get_component_count() const
 {
 	return get_component_count(type_id<T>::get_id());
 }
+template <typename T>
+std::uint64_t organizer::get_component_count(entity const& ent) const
+{
+	return get_component_count(type_id<T>::get_id(), ent);
+}
+template <typename T>
+T& organizer::get_component(entity const& ent, std::uint64_t index)
+{
+	return get_data(ent).get_component<T>(index);
+}
+template <typename T>
+T const& organizer::get_component(entity const& ent, std::uint64_t index) const
+{
+	return get_data(ent).get_component<T>(index);
+}
+template <typename... TArgs>
+bool organizer::has_component(entity const& ent) const
+{
+	return get_data(ent).has_component<TArgs...>();
+}
 template <typename T, typename>
 bool organizer::has_system() const
 {
-	return has_system(type_id_t<T>::get_id());
+	return has_system(type_id<T>::get_id());
 }
 template <typename T>
 component_storage<T>& organizer::get_storage()
 {
+	auto const index = component_index<T>();
+	if (index < m_storages.size() && m_storages[index] != nullptr)
+		return *static_cast<component_storage<T>*>(m_storages[index]);
+
 	auto& ptr = m_components[type_id<T>::get_id()];
 	if (ptr == nullptr)
 		ptr = mem::make_unique<component_storage_base>(get_allocator(), component_storage<T>{get_allocator()});
 
-	auto& storage = *dynamic_cast<component_storage<T>*>(ptr.get());
-	return storage;
+	if (index >= m_storages.size())
+		m_storages.resize(index + 1);
+
+	m_storages[index] = ptr.get();
+	return *static_cast<component_storage<T>*>(ptr.get());
 }
 template <typename T>
 void organizer::remove_system(application* app)
@@ -144,10 +309,17 @@ void organizer::remove_system(application* app)
 		{
 			(*it)->on_detach(app);
 			m_systems.erase(it);
+			m_scheduler.invalidate();
 			return;
 		}
 
 	AGL_ASSERT(false, "system not present");
 }
+
+template <typename T>
+void command_buffer::push_payload(organizer& org, entity& target, std::byte* component)
+{
+	org.push_component<T>(target, std::move(*reinterpret_cast<T*>(component)));
+}
 }
 }
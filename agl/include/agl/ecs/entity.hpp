@@ -1,38 +1,51 @@
 #pragma once
+#include "agl/ecs/archetype.hpp"
+#include "agl/ecs/components.hpp"
 #include "agl/util/typeid.hpp"
 #include "agl/memory/dictionary.hpp"
+#include "agl/memory/small-vector.hpp"
 #include "agl/memory/vector.hpp"
+#include "agl/util/type-mask.hpp"
 
 namespace agl
 {
 namespace ecs
 {
+class entity;
 class organizer;
 
 namespace impl
 {
+class entity_table;
+class query_base;
+
 class entity_data
 {
 public:
-	entity_data(mem::dictionary<type_id_t, mem::vector<std::byte*>>::allocator_type const& allocator = {}, std::uint64_t index = std::numeric_limits<std::uint64_t>::max());
+	using component_refs = mem::small_vector<component_ref, 1>; // entities rarely hold more than one instance of a type
+
+public:
+	entity_data(mem::dictionary<type_id_t, component_refs>::allocator_type const& allocator = {}, std::uint64_t index = std::numeric_limits<std::uint64_t>::max());
 	entity_data(entity_data&&) = default;
 	entity_data& operator=(entity_data&&) = default;
 
 	bool has_component(type_id_t type_id) const;
+	template <typename... TArgs>
+	bool has_component() const;
 
 	vector<type_id_t> get_component_ids() const;
-	
+
 	template <typename T>
 	T& get_component(std::uint64_t index);
 
 	template <typename T>
 	T const& get_component(std::uint64_t index) const;
 
-	void pop_components(type_id_t type_id);
-	void pop_component(type_id_t type_id, std::uint64_t index);
+	// 'type_index' is the 'component_index' of the type.
+	void pop_components(type_id_t type_id, std::uint32_t type_index);
+	void pop_component(type_id_t type_id, std::uint32_t type_index, std::uint64_t index);
 
-	template <typename T>
-	void push_component(T* ptr);
+	void push_component(type_id_t type_id, std::uint32_t type_index, component_ref ref);
 
 	std::uint64_t size(type_id_t type_id) const;
 
@@ -40,23 +53,72 @@ public:
 
 private:
 	friend class ecs::organizer;
+	friend class entity_table;
+	friend class query_base;
 
 private:
-	template <typename TTuple, std::uint64_t... TSequence>
-	void has_component_impl(std::index_sequence<TSequence...>) const;
-
-private:
+	archetype* m_archetype; // set only if the organizer uses 'ARCHETYPE_STORAGE'
 	std::uint64_t m_index;
-	mem::dictionary<type_id_t, mem::vector<std::byte*>> m_components;
+	mem::dictionary<type_id_t, component_refs> m_components; // set only if the organizer uses 'SPARSE_STORAGE'
+	type_mask m_mask; // component index of every type in 'm_components', set only if the organizer uses 'SPARSE_STORAGE'
+	std::uint64_t m_row;
 
 };
+
+/**
+ * @brief
+ * Dense array of entity slots. Every slot carries a generation which is bumped when its entity gets destroyed, so handles of a destroyed entity are detected in O(1) even after the slot is reused.
+ * Freed slots are kept in a free list and reused before the table grows.
+ */
+class entity_table
+{
+public:
+	using allocator_type = mem::pool::allocator<entity_data>;
+
+public:
+	entity_table(allocator_type const& allocator);
+	entity_table(entity_table&& other);
+	entity_table& operator=(entity_table&& other);
+
+	std::uint64_t capacity() const;
+	void clear();
+	void destroy(std::uint32_t index);
+	bool empty() const;
+	entity_data& get(std::uint32_t index);
+	entity_data const& get(std::uint32_t index) const;
+	entity get_entity(std::uint32_t index);
+	bool is_alive(std::uint32_t index, std::uint32_t generation) const;
+	entity make();
+	std::uint64_t size() const;
+
+private:
+	allocator_type m_allocator;
+	mem::vector<entity_data> m_data;
+	mem::vector<std::uint32_t> m_free;
+	mem::vector<std::uint32_t> m_generations;
+	std::uint64_t m_size;
+};
 }
+
+/**
+ * @brief
+ * Handle to an entity made of a 32 bit slot index and a 32 bit generation. It stays cheap to copy and safe to keep around, 'is_valid' tells whether the entity it refers to is still alive.
+ * The handle also points to the entity table of its organizer, which does not move with the organizer, so components are reached from the handle alone.
+ */
 class entity
 {
 public:
-	entity(impl::entity_data* data = nullptr);
-	
-	template <typename T>
+	static std::uint32_t invalid_index()
+	{
+		return std::numeric_limits<std::uint32_t>::max();
+	}
+
+public:
+	entity();
+	entity(impl::entity_table* table, std::uint32_t index, std::uint32_t generation);
+
+	// Whether the entity has every type of 'TArgs', in constant time per type.
+	template <typename... TArgs>
 	bool has_component() const;
 	bool has_component(type_id_t type_id) const;
 
@@ -72,64 +134,79 @@ public:
 	std::uint64_t size(type_id_t type_id) const;
 
 	bool empty() const;
+	std::uint32_t generation() const;
+	std::uint64_t id() const; // generation in the upper, index in the lower 32 bits
+	std::uint32_t index() const;
+	bool is_valid() const;
+
+	bool operator==(entity const& other) const;
+	bool operator!=(entity const& other) const;
 
 private:
 	friend class organizer;
 
+	impl::entity_data& get_data() const;
+
 private:
-	impl::entity_data* m_data;
+	std::uint32_t m_generation;
+	std::uint32_t m_index;
+	impl::entity_table* m_table;
 };
 
 namespace impl
 {
+template <typename... TArgs>
+bool entity_data::has_component() const
+{
+	if (m_archetype != nullptr)
+		return m_archetype->has_components<TArgs...>();
+	return m_mask.test_all<component_storage_base, TArgs...>();
+}
 template <typename T>
 T& entity_data::get_component(std::uint64_t index)
 {
-	return *reinterpret_cast<T*>(m_components.at(type_id<T>::get_id())[index]);
+	if (m_archetype != nullptr)
+	{
+		auto const column = m_archetype->find_column(type_id<T>::get_id(), index);
+
+		AGL_ASSERT(column != archetype::invalid_column(), "index out of bounds");
+
+		return *reinterpret_cast<T*>(m_archetype->get(column, m_row));
+	}
+	return *reinterpret_cast<T*>(m_components.at(type_id<T>::get_id())[index].ptr);
 }
 
 template <typename T>
 T const& entity_data::get_component(std::uint64_t index) const
 {
-	return *reinterpret_cast<T*>(m_components.at(type_id<T>::get_id())[index]);
-}
-template <typename T>
-void entity_data::push_component(T* ptr)
-{
-	auto& components = m_components[type_id<T>::get_id()];
-
-	if (components.empty())
+	if (m_archetype != nullptr)
 	{
-		auto alloc = mem::pool::allocator<std::byte*>{ m_components.get_allocator() };
-		components = mem::vector<std::byte*>{ alloc };
-	}
+		auto const column = m_archetype->find_column(type_id<T>::get_id(), index);
 
-	m_components[type_id<T>::get_id()].push_back(reinterpret_cast<std::byte*>(ptr));
-}
+		AGL_ASSERT(column != archetype::invalid_column(), "index out of bounds");
 
-template <typename TTuple, std::uint64_t... TSequence>
-void entity_data::has_component_impl(std::index_sequence<TSequence...>) const
-{
-	return (... && (m_components.find(type_id<std::tuple_element_t<TSequence, TTuple>>::get_id()) != m_components.cend()));
+		return *reinterpret_cast<T const*>(m_archetype->get(column, m_row));
+	}
+	return *reinterpret_cast<T*>(m_components.at(type_id<T>::get_id())[index].ptr);
 }
 }
 
-template <typename T>
+template <typename... TArgs>
 bool entity::has_component() const
 {
-	return has_component(type_id<T>::get_id());
+	return get_data().has_component<TArgs...>();
 }
 
 template <typename T>
 T& entity::get_component(std::uint64_t index)
 {
-	return m_data->get_component<T>(index);
+	return get_data().get_component<T>(index);
 }
 
 template <typename T>
 T const& entity::get_component(std::uint64_t index) const
 {
-	return m_data->get_component<T>(index);
+	return get_data().get_component<T>(index);
 }
 
 template <typename T>
@@ -138,4 +215,4 @@ std::uint64_t entity::size() const
 	return size(type_id<T>::get_id());
 }
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,285 @@
+#pragma once
+#include <limits>
+#include <type_traits>
+#include "agl/core/jobs.hpp"
+#include "agl/ecs/archetype.hpp"
+#include "agl/ecs/entity.hpp"
+
+namespace agl
+{
+namespace ecs
+{
+/**
+ * @brief
+ * How 'query::for_each_parallel' splits the matching entities into chunks.
+ */
+enum parallel_mode
+{
+	BALANCED, // sparse entities are split according to the worker count, so there are just enough chunks to keep every worker busy
+	DETERMINISTIC, // chunk boundaries only depend on the matching entities, never on the worker count
+};
+
+namespace impl
+{
+/**
+ * @brief
+ * Non-template part of 'query'. Tracks every entity having all the components listed in 'get_types', or every matching archetype if the organizer uses 'ARCHETYPE_STORAGE'.
+ * The organizer keeps it up to date when components are pushed or popped and when entities are destroyed, so iterating it never scans unrelated entities.
+ */
+class query_base
+{
+public:
+	using allocator_type = mem::pool::allocator<query_base>;
+
+	static std::uint64_t invalid_position()
+	{
+		return std::numeric_limits<std::uint64_t>::max();
+	}
+
+public:
+	query_base(allocator_type const& allocator, entity_table& table, type_id_t id, mem::vector<type_id_t> const& types);
+	query_base(query_base&& other);
+	query_base& operator=(query_base&& other);
+	virtual ~query_base() = default;
+
+	bool contains(entity_data const& data) const;
+	bool empty() const;
+	mem::vector<type_id_t> const& get_types() const;
+	bool has_component(type_id_t type) const;
+	type_id_t id() const;
+	bool matches(archetype const& arch) const;
+	bool matches(entity_data const& data) const;
+	void pop_entity(entity_data const& data);
+	void push_archetype(archetype* arch);
+	void push_entity(entity_data const& data);
+	std::uint64_t size() const;
+
+private:
+	friend class ecs::organizer;
+
+protected:
+	mem::vector<archetype*> m_archetypes;
+	mem::vector<std::uint32_t> m_entities; // entity table indexes
+	type_id_t m_id;
+	mem::vector<std::uint64_t> m_positions; // entity index -> position in 'm_entities'
+	entity_table* m_table;
+	mem::vector<type_id_t> m_types;
+};
+}
+
+/**
+ * @brief
+ * Persistent view of the entities having all the components in 'TArgs'. Obtained once with 'organizer::get_query' and maintained incrementally by the organizer, iterating it does not allocate.
+ * @tparam TArgs
+ */
+template <typename... TArgs>
+class query final
+	: public impl::query_base
+{
+public:
+	query(allocator_type const& allocator, impl::entity_table& table);
+	query(query&& other);
+	query& operator=(query&& other);
+
+	// Calls 'fun(TArgs&...)' with the first component of each type for every matching entity.
+	template <typename TFun>
+	void for_each(TFun&& fun);
+
+	// Calls 'fun(entity, TArgs&...)' with the first component of each type for every matching entity.
+	template <typename TFun>
+	void for_each_entity(TFun&& fun);
+
+	/**
+	 * @brief
+	 * Calls 'fun(TArgs&...)', or 'fun(chunk, TArgs&...)' if it accepts the chunk index, for every matching entity. Chunks are processed concurrently by 'workers', or in order on the calling thread if it is null. Returns once all of them are done.
+	 * An archetype chunk is a chunk of its own, sparse entities are grouped so that their components take roughly one archetype chunk.
+	 * Entities and components must not be added or removed until it returns. In 'DETERMINISTIC' mode keeping per chunk state (random generators, partial sums) gives the same results on any machine.
+	 */
+	template <typename TFun>
+	void for_each_parallel(jobs* workers, TFun&& fun, parallel_mode mode = BALANCED);
+
+	// Number of chunks 'for_each_parallel' processes with the same arguments, for sizing per chunk state.
+	std::uint64_t parallel_chunk_count(jobs* workers, parallel_mode mode = BALANCED) const;
+
+private:
+	struct parallel_layout
+	{
+		std::uint64_t archetype_chunks;
+		std::uint64_t sparse_chunk; // sparse entities per chunk
+		std::uint64_t count;
+	};
+
+private:
+	static std::uint64_t sparse_chunk_size();
+
+	parallel_layout get_parallel_layout(jobs* workers, parallel_mode mode) const;
+
+	template <typename TFun>
+	static void invoke(TFun& fun, std::uint64_t chunk, TArgs&... components);
+
+	template <typename TFun>
+	static void invoke_chunk(std::uint64_t chunk, std::uint64_t size, TFun& fun, TArgs*... columns);
+
+	template <typename TFun>
+	void for_each_range(std::uint64_t first, std::uint64_t last, std::uint64_t archetype_chunks, std::uint64_t sparse_chunk, TFun& fun);
+
+	template <typename TFun, typename... TColumns>
+	static void for_each_chunk(std::uint64_t size, TFun& fun, TColumns*... columns);
+
+	template <typename TFun, typename... TColumns>
+	void for_each_entity_chunk(archetype const& arch, std::uint64_t first, std::uint64_t size, TFun& fun, TColumns*... columns);
+};
+
+template <typename... TArgs>
+query<TArgs...>::query(allocator_type const& allocator, impl::entity_table& table)
+	: impl::query_base{ allocator, table, type_id<query<TArgs...>>::get_id(), mem::vector<type_id_t>{ allocator } }
+{
+	m_types.reserve(sizeof...(TArgs));
+	(m_types.push_back(type_id<TArgs>::get_id()), ...);
+}
+template <typename... TArgs>
+query<TArgs...>::query(query&& other)
+	: impl::query_base{ std::move(other) }
+{
+}
+template <typename... TArgs>
+query<TArgs...>& query<TArgs...>::operator=(query&& other)
+{
+	this->impl::query_base::operator=(std::move(other));
+	return *this;
+}
+template <typename... TArgs>
+template <typename TFun>
+void query<TArgs...>::for_each(TFun&& fun)
+{
+	for (auto* arch : m_archetypes)
+		for (auto chunk = std::uint64_t{ 0 }; chunk < arch->chunk_count(); ++chunk)
+			for_each_chunk(arch->chunk_size(chunk), fun, reinterpret_cast<TArgs*>(arch->get_column(chunk, arch->find_column(type_id<TArgs>::get_id())))...);
+
+	for (auto index : m_entities)
+	{
+		auto& data = m_table->get(index);
+		fun(data.template get_component<TArgs>(0)...);
+	}
+}
+template <typename... TArgs>
+template <typename TFun>
+void query<TArgs...>::for_each_entity(TFun&& fun)
+{
+	for (auto* arch : m_archetypes)
+		for (auto chunk = std::uint64_t{ 0 }; chunk < arch->chunk_count(); ++chunk)
+			for_each_entity_chunk(*arch, chunk * arch->chunk_capacity(), arch->chunk_size(chunk), fun, reinterpret_cast<TArgs*>(arch->get_column(chunk, arch->find_column(type_id<TArgs>::get_id())))...);
+
+	for (auto index : m_entities)
+	{
+		auto& data = m_table->get(index);
+		fun(m_table->get_entity(index), data.template get_component<TArgs>(0)...);
+	}
+}
+template <typename... TArgs>
+template <typename TFun>
+void query<TArgs...>::for_each_parallel(jobs* workers, TFun&& fun, parallel_mode mode)
+{
+	auto const layout = get_parallel_layout(workers, mode);
+	if (workers == nullptr)
+	{
+		for_each_range(0, layout.count, layout.archetype_chunks, layout.sparse_chunk, fun);
+		return;
+	}
+
+	workers->parallel_for(0, layout.count, 1, [this, &layout, &fun](std::uint64_t first, std::uint64_t last)
+		{
+			for_each_range(first, last, layout.archetype_chunks, layout.sparse_chunk, fun);
+		});
+}
+template <typename... TArgs>
+std::uint64_t query<TArgs...>::parallel_chunk_count(jobs* workers, parallel_mode mode) const
+{
+	return get_parallel_layout(workers, mode).count;
+}
+template <typename... TArgs>
+std::uint64_t query<TArgs...>::sparse_chunk_size()
+{
+	return std::max<std::uint64_t>(archetype::default_chunk_size() / (sizeof(TArgs) + ...), 1);
+}
+template <typename... TArgs>
+typename query<TArgs...>::parallel_layout query<TArgs...>::get_parallel_layout(jobs* workers, parallel_mode mode) const
+{
+	auto result = parallel_layout{ 0, sparse_chunk_size(), 0 };
+	for (auto* arch : m_archetypes)
+		result.archetype_chunks += arch->chunk_count();
+
+	if (mode == BALANCED)
+	{
+		// a few chunks per thread, the calling thread helps as well
+		auto const chunk_count = ((workers != nullptr ? workers->worker_count() : 0) + 1) * 4;
+		result.sparse_chunk = std::max(result.sparse_chunk, (m_entities.size() + chunk_count - 1) / chunk_count);
+	}
+
+	result.count = result.archetype_chunks + (m_entities.size() + result.sparse_chunk - 1) / result.sparse_chunk;
+	return result;
+}
+template <typename... TArgs>
+template <typename TFun>
+void query<TArgs...>::invoke(TFun& fun, std::uint64_t chunk, TArgs&... components)
+{
+	if constexpr (std::is_invocable_v<TFun&, std::uint64_t, TArgs&...>)
+		fun(chunk, components...);
+	else
+		fun(components...);
+}
+template <typename... TArgs>
+template <typename TFun>
+void query<TArgs...>::invoke_chunk(std::uint64_t chunk, std::uint64_t size, TFun& fun, TArgs*... columns)
+{
+	for (auto row = std::uint64_t{ 0 }; row < size; ++row)
+		invoke(fun, chunk, columns[row]...);
+}
+template <typename... TArgs>
+template <typename TFun>
+void query<TArgs...>::for_each_range(std::uint64_t first, std::uint64_t last, std::uint64_t archetype_chunks, std::uint64_t sparse_chunk, TFun& fun)
+{
+	auto chunk = first;
+	auto arch_first = std::uint64_t{ 0 };
+	for (auto* arch : m_archetypes)
+	{
+		if (chunk >= last || chunk >= archetype_chunks)
+			break;
+
+		auto const arch_last = arch_first + arch->chunk_count();
+		for (; chunk < last && chunk < arch_last; ++chunk)
+		{
+			auto const local = chunk - arch_first;
+			invoke_chunk(chunk, arch->chunk_size(local), fun, reinterpret_cast<TArgs*>(arch->get_column(local, arch->find_column(type_id<TArgs>::get_id())))...);
+		}
+		arch_first = arch_last;
+	}
+
+	for (; chunk < last; ++chunk)
+	{
+		auto const begin = (chunk - archetype_chunks) * sparse_chunk;
+		auto const end = std::min<std::uint64_t>(begin + sparse_chunk, m_entities.size());
+
+		for (auto i = begin; i < end; ++i)
+		{
+			auto& data = m_table->get(m_entities[i]);
+			invoke(fun, chunk, data.template get_component<TArgs>(0)...);
+		}
+	}
+}
+template <typename... TArgs>
+template <typename TFun, typename... TColumns>
+void query<TArgs...>::for_each_chunk(std::uint64_t size, TFun& fun, TColumns*... columns)
+{
+	for (auto row = std::uint64_t{ 0 }; row < size; ++row)
+		fun(columns[row]...);
+}
+template <typename... TArgs>
+template <typename TFun, typename... TColumns>
+void query<TArgs...>::for_each_entity_chunk(archetype const& arch, std::uint64_t first, std::uint64_t size, TFun& fun, TColumns*... columns)
+{
+	for (auto row = std::uint64_t{ 0 }; row < size; ++row)
+		fun(m_table->get_entity(arch.get_entity(first + row)), columns[row]...);
+}
+}
+}
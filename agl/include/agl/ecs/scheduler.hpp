@@ -0,0 +1,64 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include "agl/ecs/system.hpp"
+#include "agl/memory/unique-ptr.hpp"
+#include "agl/memory/vector.hpp"
+#include "agl/vector.hpp"
+
+namespace agl
+{
+class application;
+class jobs;
+
+namespace ecs
+{
+/**
+ * @brief
+ * Runs the systems of an organizer stage by stage ('PRE_RENDER', 'RENDER', then 'POST_RENDER').
+ * Within a stage a system waits only for the previously added systems it conflicts with (see 'system_base::conflicts_with'), independent systems run concurrently as jobs of the 'jobs' resource.
+ * Exclusive systems always run on the thread calling 'run', which also helps executing queued jobs while waiting. Without a job system every system runs on the calling thread.
+ * 'sync' is called on the calling thread after every stage, once none of its systems is running.
+ */
+class scheduler
+{
+public:
+	scheduler();
+	scheduler(scheduler&& other);
+	scheduler& operator=(scheduler&& other);
+
+	jobs* get_jobs() const;
+	// Rebuilds the dependency graph on the next 'run', must be called whenever systems are added or removed.
+	void invalidate();
+	void run(application* app, mem::vector<mem::unique_ptr<system_base>>& systems, std::function<void()> const& sync);
+	void set_jobs(jobs* workers);
+
+private:
+	struct node
+	{
+		system_base* system;
+		std::uint64_t dependencies;
+		vector<std::uint64_t> successors;
+	};
+
+private:
+	void build(mem::vector<mem::unique_ptr<system_base>>& systems);
+	void dispatch(application* app, std::uint64_t index);
+	void execute(application* app, std::uint64_t index);
+	void run_stage(application* app, std::uint64_t begin, std::uint64_t end);
+
+private:
+	std::condition_variable m_cond_var;
+	bool m_dirty;
+	jobs* m_jobs;
+	std::uint64_t m_main_head;
+	vector<std::uint64_t> m_main_queue; // ready exclusive systems
+	std::mutex m_mutex;
+	vector<node> m_nodes; // sorted by stage, then by the order systems were added
+	vector<std::uint64_t> m_pending; // unfinished dependencies of each node during the current stage
+	std::uint64_t m_remaining;
+	vector<std::uint64_t> m_stages; // first node of every stage, plus the node count
+};
+}
+}
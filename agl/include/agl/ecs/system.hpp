@@ -3,6 +3,7 @@
 #include <string>
 #include "agl/util/typeid.hpp"
 #include "agl/memory/set.hpp"
+#include "agl/vector.hpp"
 
 namespace agl
 {
@@ -63,9 +64,23 @@ public:
 	void set_signal(std::uint64_t id, bool value);
 	organizer& get_organizer();
 
+	// True if both systems may not run at the same time, because one writes components the other one accesses or one of them is exclusive.
+	bool conflicts_with(system_base const& other) const;
+	vector<type_id_t> const& get_reads() const;
+	vector<type_id_t> const& get_writes() const;
+	// Systems that did not declare their component access with 'reads' / 'writes' are exclusive, they run alone and on the thread updating the organizer.
+	bool is_exclusive() const;
+
 protected:
 	void create_signal(std::uint64_t id, bool start_value);
 
+	// Declares that 'on_update' only reads the components in 'TArgs'.
+	template <typename... TArgs>
+	void reads();
+	// Declares that 'on_update' reads and writes the components in 'TArgs'.
+	template <typename... TArgs>
+	void writes();
+
 private:
 	friend class organizer;
 
@@ -73,13 +88,32 @@ private:
 	void set_organizer(organizer* org);
 
 private:
+	static bool intersects(vector<type_id_t> const& lhs, vector<type_id_t> const& rhs);
+
+private:
+	bool m_declared;
 	type_id_t m_id;
 	std::string m_name;
 	organizer* m_organizer;
+	vector<type_id_t> m_reads;
 	mem::set<signal, signal_comp> m_signals;
 	ecs::stage m_stage;
+	vector<type_id_t> m_writes;
 };
 
+template <typename... TArgs>
+void system_base::reads()
+{
+	m_declared = true;
+	(m_reads.push_back(type_id<TArgs>::get_id()), ...);
+}
+template <typename... TArgs>
+void system_base::writes()
+{
+	m_declared = true;
+	(m_writes.push_back(type_id<TArgs>::get_id()), ...);
+}
+
 template <typename T>
 class system
 	: public system_base
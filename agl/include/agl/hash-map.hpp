@@ -0,0 +1,599 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include "agl/core/debug.hpp"
+#include "agl/memory/allocator.hpp"
+#include "agl/util/type-traits.hpp"
+
+namespace agl
+{
+/**
+ * @brief
+ * Shares properties with 'std::unordered_map'. Open addressing with Robin Hood probing: an element is stored at most a few slots after its home slot,
+ * and lookups stop as soon as they meet an element closer to its home than the searched key would be. Erasing shifts the following elements back.
+ * Unlike 'dictionary', inserting and erasing are O(1) on average, but the elements are not sorted.
+ * Pointers and iterators are invalidated by every insertion and erasure. 'erase' returns the element following the erased one, though an element shifted back over the end of the table is then visited again.
+ * @tparam TKey
+ * @tparam TValue
+ * @tparam THash
+ * @tparam TEqual
+ * @tparam TAlloc
+ */
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TEqual = std::equal_to<TKey>, typename TAlloc = mem::allocator<std::pair<TKey, TValue>>>
+class hash_map
+{
+public:
+	using value_type = typename type_traits<std::pair<TKey, TValue>>::value_type;
+	using pointer = typename type_traits<std::pair<TKey, TValue>>::pointer;
+	using const_pointer = typename type_traits<std::pair<TKey, TValue>>::const_pointer;
+	using reference = typename type_traits<std::pair<TKey, TValue>>::reference;
+	using const_reference = typename type_traits<std::pair<TKey, TValue>>::const_reference;
+	using size_type = std::uint64_t;
+	using difference_type = std::ptrdiff_t;
+
+	using key_type = TKey;
+	using mapped_type = TValue;
+	using hasher = THash;
+	using key_equal = TEqual;
+	using allocator_type = typename TAlloc::template rebind<std::pair<TKey, TValue>>;
+
+	template <typename TMap, typename TPointer>
+	class basic_iterator;
+
+	using iterator = basic_iterator<hash_map, pointer>;
+	using const_iterator = basic_iterator<hash_map const, const_pointer>;
+
+	static constexpr size_type min_capacity()
+	{
+		return 8;
+	}
+
+public:
+	hash_map()
+		: hash_map{ allocator_type{} }
+	{
+	}
+	explicit hash_map(allocator_type const& allocator)
+		: m_allocator{ allocator }
+		, m_capacity{ 0 }
+		, m_distance_allocator{ allocator }
+		, m_distances{ nullptr }
+		, m_shift{ 0 }
+		, m_size{ 0 }
+		, m_slots{ nullptr }
+	{
+	}
+	hash_map(hash_map&& other)
+		: m_allocator{ std::move(other.m_allocator) }
+		, m_capacity{ other.m_capacity }
+		, m_distance_allocator{ std::move(other.m_distance_allocator) }
+		, m_distances{ other.m_distances }
+		, m_equal{ std::move(other.m_equal) }
+		, m_hash{ std::move(other.m_hash) }
+		, m_shift{ other.m_shift }
+		, m_size{ other.m_size }
+		, m_slots{ other.m_slots }
+	{
+		other.m_capacity = 0;
+		other.m_distances = nullptr;
+		other.m_size = 0;
+		other.m_slots = nullptr;
+	}
+	hash_map(hash_map const& other)
+		: m_allocator{ other.m_allocator }
+		, m_capacity{ 0 }
+		, m_distance_allocator{ other.m_distance_allocator }
+		, m_distances{ nullptr }
+		, m_equal{ other.m_equal }
+		, m_hash{ other.m_hash }
+		, m_shift{ 0 }
+		, m_size{ 0 }
+		, m_slots{ nullptr }
+	{
+		AGL_ALLOCATION_SITE();
+		copy_slots(other);
+	}
+	hash_map& operator=(hash_map&& other)
+	{
+		if (this == &other)
+			return *this;
+
+		release();
+
+		m_allocator = std::move(other.m_allocator);
+		m_capacity = other.m_capacity;
+		m_distance_allocator = std::move(other.m_distance_allocator);
+		m_distances = other.m_distances;
+		m_equal = std::move(other.m_equal);
+		m_hash = std::move(other.m_hash);
+		m_shift = other.m_shift;
+		m_size = other.m_size;
+		m_slots = other.m_slots;
+
+		other.m_capacity = 0;
+		other.m_distances = nullptr;
+		other.m_size = 0;
+		other.m_slots = nullptr;
+		return *this;
+	}
+	hash_map& operator=(hash_map const& other)
+	{
+		AGL_ALLOCATION_SITE();
+
+		if (this == &other)
+			return *this;
+
+		release();
+
+		m_allocator = other.m_allocator;
+		m_distance_allocator = other.m_distance_allocator;
+		m_equal = other.m_equal;
+		m_hash = other.m_hash;
+		copy_slots(other);
+		return *this;
+	}
+	~hash_map()
+	{
+		release();
+	}
+	mapped_type& at(key_type const& key)
+	{
+		auto const index = find_index(key);
+
+		AGL_ASSERT(index != m_capacity, "Index out of bounds");
+
+		return m_slots[index].second;
+	}
+	mapped_type const& at(key_type const& key) const
+	{
+		auto const index = find_index(key);
+
+		AGL_ASSERT(index != m_capacity, "Index out of bounds");
+
+		return m_slots[index].second;
+	}
+	iterator begin()
+	{
+		return make_iterator<iterator>(first_occupied(0));
+	}
+	const_iterator begin() const
+	{
+		return cbegin();
+	}
+	const_iterator cbegin() const
+	{
+		return make_iterator<const_iterator>(first_occupied(0));
+	}
+	iterator end()
+	{
+		return make_iterator<iterator>(m_capacity);
+	}
+	const_iterator end() const
+	{
+		return cend();
+	}
+	const_iterator cend() const
+	{
+		return make_iterator<const_iterator>(m_capacity);
+	}
+	size_type capacity() const
+	{
+		return m_capacity;
+	}
+	// Destructs the elements and releases the memory.
+	void clear()
+	{
+		release();
+	}
+	bool contains(key_type const& key) const
+	{
+		return find_index(key) != m_capacity;
+	}
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+	iterator emplace(value_type&& pair)
+	{
+		AGL_ALLOCATION_SITE();
+
+		AGL_ASSERT(!contains(pair.first), "Key already stored");
+
+		return make_iterator<iterator>(insert_unique(std::move(pair)));
+	}
+	// Returns the element following the erased one.
+	iterator erase(const_iterator pos)
+	{
+		AGL_ASSERT(pos.m_index < m_capacity && m_distances[pos.m_index] != 0, "Iterator out of bounds");
+
+		auto const index = pos.m_index;
+		erase_index(index);
+
+		// the slot now holds the element shifted back from the next one, unless it got empty
+		return make_iterator<iterator>(first_occupied(index));
+	}
+	bool erase(key_type const& key)
+	{
+		auto const index = find_index(key);
+		if (index == m_capacity)
+			return false;
+
+		erase_index(index);
+		return true;
+	}
+	iterator find(key_type const& key)
+	{
+		return make_iterator<iterator>(find_index(key));
+	}
+	const_iterator find(key_type const& key) const
+	{
+		return make_iterator<const_iterator>(find_index(key));
+	}
+	allocator_type get_allocator() const
+	{
+		return m_allocator;
+	}
+	hasher hash_function() const
+	{
+		return m_hash;
+	}
+	key_equal key_eq() const
+	{
+		return m_equal;
+	}
+	float load_factor() const
+	{
+		return m_capacity == 0 ? 0.f : static_cast<float>(m_size) / static_cast<float>(m_capacity);
+	}
+	mapped_type& operator[](key_type const& key)
+	{
+		AGL_ALLOCATION_SITE();
+
+		auto index = find_index(key);
+		if (index == m_capacity)
+			index = insert_unique(value_type{ key, mapped_type{} }); // may rehash, read 'm_slots' after
+
+		return m_slots[index].second;
+	}
+	mapped_type const& operator[](key_type const& key) const
+	{
+		return at(key);
+	}
+	// Makes room for 'n' elements without rehashing.
+	void reserve(size_type n)
+	{
+		AGL_ALLOCATION_SITE();
+
+		auto capacity = min_capacity();
+		while (!fits(n, capacity))
+			capacity *= 2;
+
+		if (capacity > m_capacity)
+			rehash(capacity);
+	}
+	size_type size() const
+	{
+		return m_size;
+	}
+
+public:
+	/**
+	 * @brief
+	 * Forward iterator skipping the empty slots.
+	 */
+	template <typename TMap, typename TPointer>
+	class basic_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = typename hash_map::value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = TPointer;
+		using reference = std::remove_pointer_t<TPointer>&;
+
+	public:
+		basic_iterator()
+			: m_index{ 0 }
+			, m_map{ nullptr }
+		{
+		}
+		basic_iterator(TMap* map, size_type index)
+			: m_index{ index }
+			, m_map{ map }
+		{
+		}
+		// iterator to const_iterator
+		template <typename UMap, typename UPointer, typename TEnable = std::enable_if_t<std::is_convertible_v<UPointer, TPointer>>>
+		basic_iterator(basic_iterator<UMap, UPointer> const& other)
+			: m_index{ other.m_index }
+			, m_map{ other.m_map }
+		{
+		}
+		reference operator*() const
+		{
+			AGL_ASSERT(m_map != nullptr && m_index < m_map->m_capacity, "Iterator out of bounds");
+
+			return m_map->m_slots[m_index];
+		}
+		pointer operator->() const
+		{
+			return &**this;
+		}
+		basic_iterator& operator++()
+		{
+			m_index = m_map->first_occupied(m_index + 1);
+			return *this;
+		}
+		basic_iterator operator++(int)
+		{
+			auto result = *this;
+			++*this;
+			return result;
+		}
+		template <typename UMap, typename UPointer>
+		bool operator==(basic_iterator<UMap, UPointer> const& other) const
+		{
+			return m_index == other.m_index && m_map == other.m_map;
+		}
+		template <typename UMap, typename UPointer>
+		bool operator!=(basic_iterator<UMap, UPointer> const& other) const
+		{
+			return !(*this == other);
+		}
+
+	private:
+		friend class hash_map;
+
+		template <typename UMap, typename UPointer>
+		friend class basic_iterator;
+
+	private:
+		size_type m_index;
+		TMap* m_map;
+	};
+
+private:
+	using distance_type = std::uint8_t;
+	using distance_allocator_type = typename TAlloc::template rebind<distance_type>;
+
+	// An element is stored at most 'max_distance() - 1' slots after its home slot, past that the table grows.
+	static constexpr distance_type max_distance()
+	{
+		return std::numeric_limits<distance_type>::max();
+	}
+	// Tables are kept at most 7/8 full.
+	static constexpr bool fits(size_type size, size_type capacity)
+	{
+		return size * 8 <= capacity * 7;
+	}
+
+private:
+	template <typename TIterator>
+	TIterator make_iterator(size_type index) const
+	{
+		using map_type = std::conditional_t<std::is_same_v<TIterator, iterator>, hash_map, hash_map const>;
+		return TIterator{ const_cast<map_type*>(this), index };
+	}
+	// Fibonacci hashing spreads the low quality hashes of 'std::hash' over the upper bits.
+	size_type home(key_type const& key) const
+	{
+		auto const hash = static_cast<std::uint64_t>(m_hash(key)) * std::uint64_t{ 0x9E3779B97F4A7C15 };
+		return static_cast<size_type>(hash >> (64 - m_shift));
+	}
+	size_type find_index(key_type const& key) const
+	{
+		if (m_size == 0)
+			return m_capacity;
+
+		auto const mask = m_capacity - 1;
+		auto index = home(key);
+		for (auto distance = distance_type{ 1 }; m_distances[index] >= distance; ++distance)
+		{
+			if (m_distances[index] == distance && m_equal(m_slots[index].first, key))
+				return index;
+
+			index = (index + 1) & mask;
+		}
+
+		return m_capacity;
+	}
+	size_type first_occupied(size_type index) const
+	{
+		while (index < m_capacity && m_distances[index] == 0)
+			++index;
+
+		return index;
+	}
+	// Returns the index 'pair' ended up at, the key must not be stored yet.
+	size_type insert_unique(value_type&& pair)
+	{
+		if (!fits(m_size + 1, m_capacity))
+			rehash(m_capacity == 0 ? min_capacity() : m_capacity * 2);
+
+		auto carried = std::move(pair);
+		auto result = m_capacity;
+		auto const mask = m_capacity - 1;
+		auto index = home(carried.first);
+		auto distance = distance_type{ 1 };
+		while (true)
+		{
+			if (m_distances[index] == 0)
+			{
+				m_allocator.construct(m_slots + index, std::move(carried));
+				m_distances[index] = distance;
+				++m_size;
+				return result != m_capacity ? result : index;
+			}
+
+			// takes the slot of an element closer to its home, which carries on in its place
+			if (m_distances[index] < distance)
+			{
+				std::swap(carried, m_slots[index]);
+				std::swap(distance, m_distances[index]);
+				if (result == m_capacity)
+					result = index;
+			}
+
+			index = (index + 1) & mask;
+			if (++distance == max_distance())
+				return grow_and_insert(std::move(carried), result);
+		}
+	}
+	// The probe sequence got too long. 'result' is the index the inserted element was stored at, if it is not the one carried.
+	size_type grow_and_insert(value_type&& carried, size_type result)
+	{
+		if (result == m_capacity)
+		{
+			rehash(m_capacity * 2);
+			return insert_unique(std::move(carried));
+		}
+
+		auto const key = m_slots[result].first;
+		rehash(m_capacity * 2);
+		insert_unique(std::move(carried));
+		return find_index(key);
+	}
+	// Shifts the following elements back one slot, until an empty slot or an element at its home.
+	void erase_index(size_type index)
+	{
+		auto const mask = m_capacity - 1;
+		m_allocator.destruct(m_slots + index);
+
+		auto next = (index + 1) & mask;
+		while (m_distances[next] > 1)
+		{
+			relocate(m_slots + index, m_slots + next);
+			m_distances[index] = m_distances[next] - 1;
+			index = next;
+			next = (next + 1) & mask;
+		}
+
+		m_distances[index] = 0;
+		--m_size;
+	}
+	void relocate(pointer dest, pointer src)
+	{
+		if constexpr (is_trivially_relocatable_v<value_type>)
+			std::memcpy(static_cast<void*>(dest), src, sizeof(value_type));
+		else
+		{
+			m_allocator.construct(dest, std::move(*src));
+			m_allocator.destruct(src);
+		}
+	}
+	// 'capacity' must be a power of two large enough for the elements.
+	void rehash(size_type capacity)
+	{
+		AGL_ASSERT((capacity & (capacity - 1)) == 0 && fits(m_size, capacity), "Invalid capacity");
+
+		auto* const old_distances = m_distances;
+		auto* const old_slots = m_slots;
+		auto const old_capacity = m_capacity;
+
+		allocate(capacity);
+		for (auto i = size_type{ 0 }; i < old_capacity; ++i)
+		{
+			if (old_distances[i] == 0)
+				continue;
+
+			insert_relocated(old_slots + i);
+		}
+
+		if (old_capacity != 0)
+		{
+			m_allocator.deallocate(old_slots, old_capacity);
+			m_distance_allocator.deallocate(old_distances, old_capacity);
+		}
+	}
+	// Moves 'src' into the table during a rehash, where no key repeats. A larger table never lengthens a probe sequence, so the distances stay below 'max_distance' as they did in the previous table.
+	void insert_relocated(pointer src)
+	{
+		auto const mask = m_capacity - 1;
+		auto index = home(src->first);
+		auto distance = distance_type{ 1 };
+		while (m_distances[index] != 0)
+		{
+			// the resident element is carried on through 'src'
+			if (m_distances[index] < distance)
+			{
+				std::swap(*src, m_slots[index]);
+				std::swap(distance, m_distances[index]);
+			}
+
+			index = (index + 1) & mask;
+			++distance;
+
+			AGL_ASSERT(distance < max_distance(), "Probe sequence too long");
+		}
+
+		relocate(m_slots + index, src);
+		m_distances[index] = distance;
+	}
+	// Allocates an empty table, the previous one is left to the caller.
+	void allocate(size_type capacity)
+	{
+		m_slots = m_allocator.allocate(capacity);
+		m_distances = m_distance_allocator.allocate(capacity);
+		std::memset(m_distances, 0, capacity * sizeof(distance_type));
+		m_capacity = capacity;
+		m_shift = 0;
+		while ((size_type{ 1 } << m_shift) < capacity)
+			++m_shift;
+	}
+	// Same capacity and layout as 'other', so no element needs to be rehashed.
+	void copy_slots(hash_map const& other)
+	{
+		if (other.m_capacity == 0)
+			return;
+
+		allocate(other.m_capacity);
+		std::memcpy(m_distances, other.m_distances, m_capacity * sizeof(distance_type));
+		for (auto i = size_type{ 0 }; i < m_capacity; ++i)
+			if (m_distances[i] != 0)
+				m_allocator.construct(m_slots + i, other.m_slots[i]);
+
+		m_size = other.m_size;
+	}
+	void release()
+	{
+		if (m_capacity == 0)
+			return;
+
+		if constexpr (!std::is_trivially_destructible_v<value_type>)
+		{
+			for (auto i = size_type{ 0 }; i < m_capacity; ++i)
+				if (m_distances[i] != 0)
+					m_allocator.destruct(m_slots + i);
+		}
+
+		m_allocator.deallocate(m_slots, m_capacity);
+		m_distance_allocator.deallocate(m_distances, m_capacity);
+		m_capacity = 0;
+		m_distances = nullptr;
+		m_size = 0;
+		m_slots = nullptr;
+	}
+
+private:
+	allocator_type m_allocator;
+	size_type m_capacity; // 0 or a power of two
+	distance_allocator_type m_distance_allocator;
+	distance_type* m_distances; // per slot, 0 when empty, otherwise 1 + the distance from the home slot of its element
+	key_equal m_equal;
+	hasher m_hash;
+	std::uint32_t m_shift; // log2 of the capacity
+	size_type m_size;
+	pointer m_slots;
+};
+
+template <typename TKey, typename TValue, typename THash, typename TEqual, typename TAlloc>
+struct is_trivially_relocatable<hash_map<TKey, TValue, THash, TEqual, TAlloc>>
+	: std::bool_constant<is_trivially_relocatable_v<THash> && is_trivially_relocatable_v<TEqual> && is_trivially_relocatable_v<typename TAlloc::template rebind<std::pair<TKey, TValue>>>>
+{
+};
+}
@@ -4,6 +4,8 @@
 #include <cstdlib>
 #include <memory>
 #include "agl/core/debug.hpp"
+#include "agl/memory/tracker.hpp"
+#include "agl/util/type-traits.hpp"
 
 namespace agl
 {
@@ -118,6 +120,7 @@ public:
 		auto i = size;
 		std::align(alignment, size, ptr, i);
 		m_alloc_count += count;
+		AGL_TRACK_ALLOCATION(T, ptr, size);
 		return reinterpret_cast<pointer>(ptr);
 	}
 	void deallocate(pointer ptr, size_type count = 1)
@@ -125,6 +128,7 @@ public:
 		AGL_ASSERT(m_alloc_count > 0, "invalid deallocation call");
 
 		m_alloc_count -= count;
+		AGL_TRACK_DEALLOCATION(ptr);
 		std::free(ptr);
 	}
 	template <typename... TArgs>
@@ -160,4 +164,10 @@ bool operator==(allocator<T> const& lhs, allocator<U> const& rhs) { return true;
 template <typename T, typename U>
 bool operator!=(allocator<T> const& lhs, allocator<U> const& rhs) { return false; }
 }
+
+template <typename T>
+struct is_trivially_relocatable<mem::allocator<T>>
+	: std::true_type
+{
+};
 }
\ No newline at end of file
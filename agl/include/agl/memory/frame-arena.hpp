@@ -0,0 +1,230 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include "agl/core/application.hpp"
+#include "agl/deque.hpp"
+#include "agl/dictionary.hpp"
+#include "agl/unique-ptr.hpp"
+#include "agl/vector.hpp"
+
+namespace agl
+{
+namespace mem
+{
+namespace impl
+{
+/**
+ * @brief
+ * Bump allocator over a list of blocks, nothing is freed until 'reset'. Allocating is thread-safe, resetting is not.
+ */
+class linear_buffer
+{
+public:
+	linear_buffer(std::uint64_t block_size);
+	linear_buffer(linear_buffer&& other);
+	linear_buffer(linear_buffer const&) = delete;
+	linear_buffer& operator=(linear_buffer&&) = delete;
+	linear_buffer& operator=(linear_buffer const&) = delete;
+	~linear_buffer();
+
+	std::byte* allocate(std::uint64_t size, std::uint64_t alignment);
+	std::uint64_t occupancy() const;
+	// Frees everything at once. Once the buffer had to grow, its blocks are replaced with a single one holding all of them.
+	void reset();
+	std::uint64_t size() const;
+
+private:
+	struct block
+	{
+		std::byte* memory;
+		std::uint64_t size;
+		std::atomic<std::uint64_t> offset;
+	};
+
+private:
+	block* add_block(block* full, std::uint64_t size, std::uint64_t alignment);
+	void free_blocks();
+
+private:
+	std::uint64_t m_block_size;
+	vector<unique_ptr<block>> m_blocks; // guarded by 'm_mutex'
+	std::atomic<block*> m_current;
+	mutable std::mutex m_mutex;
+};
+}
+
+/**
+ * @brief
+ * Linear memory for data that only lives for the frame, freeing it costs nothing. Everything allocated is released at once by 'reset', which 'application::run' calls at the start of every frame.
+ * 'DOUBLE_FRAME' allocations survive one more reset, the arena alternates between two buffers for them.
+ * Allocating is thread-safe, systems running in parallel may share the arena. Deallocating does nothing.
+ *
+ * @dependencies
+ * - 'application'
+ */
+class frame_arena final
+	: public resource<frame_arena>
+{
+public:
+	template <typename T>
+	class allocator;
+
+	enum lifetime
+	{
+		SINGLE_FRAME,
+		DOUBLE_FRAME,
+	};
+
+	static std::uint64_t default_block_size()
+	{
+		return 1024 * 1024;
+	}
+
+public:
+	frame_arena(std::uint64_t block_size = default_block_size());
+	frame_arena(frame_arena&& other);
+	frame_arena(frame_arena const&) = delete;
+	frame_arena& operator=(frame_arena&&) = delete;
+	frame_arena& operator=(frame_arena const&) = delete;
+
+	// The memory is valid until the next 'reset', or the one after for 'DOUBLE_FRAME'.
+	std::byte* allocate(std::uint64_t size, std::uint64_t alignment, lifetime life = SINGLE_FRAME);
+	// Number of resets so far.
+	std::uint64_t frame() const;
+	template <typename T>
+	allocator<T> make_allocator(lifetime life = SINGLE_FRAME);
+	std::uint64_t occupancy() const;
+	// No allocation may be made meanwhile.
+	void reset();
+	std::uint64_t size() const;
+
+public:
+	template <typename T>
+	class allocator
+	{
+	public:
+		static_assert(!std::is_const_v<T>, "allocator<const T> is ill-formed");
+		static_assert(!std::is_function_v<T>, "[allocator.requirements]");
+		static_assert(!std::is_reference_v<T>, "[allocator.requirements]");
+
+	public:
+		template <typename U>
+		using rebind = allocator<U>;
+		using value_type = T;
+		using pointer = T*;
+		using const_pointer = T const*;
+		using reference = T&;
+		using const_reference = T const&;
+		using size_type = std::uint64_t;
+		using difference_type = std::ptrdiff_t;
+
+		allocator(frame_arena* arena = nullptr, lifetime life = SINGLE_FRAME);
+		template <typename U>
+		allocator(allocator<U> const& other);
+		[[nodiscard]] pointer allocate(size_type count = 1, std::uint64_t alignment = alignof(value_type));
+		template <typename... TArgs>
+		void construct(pointer buffer, TArgs&&... args);
+		// Does nothing, see 'frame_arena::reset'.
+		void deallocate(pointer ptr, size_type count = 1);
+		void destruct(pointer ptr);
+		template <typename U>
+		allocator<U> rebind_copy() const;
+
+	private:
+		template <typename U>
+		friend class allocator;
+
+		template <typename U, typename W>
+		friend bool operator==(allocator<U> const&, allocator<W> const&);
+
+		template <typename U, typename W>
+		friend bool operator!=(allocator<U> const&, allocator<W> const&);
+
+	private:
+		frame_arena* m_arena;
+		lifetime m_lifetime;
+	};
+
+private:
+	virtual void on_attach(application* app) override;
+	virtual void on_detach(application* app) override;
+	virtual void on_update(application* app) override;
+
+private:
+	impl::linear_buffer m_double[2]; // 'DOUBLE_FRAME' allocations of the current frame go to 'm_double[m_frame % 2]'
+	std::uint64_t m_frame;
+	impl::linear_buffer m_single;
+};
+
+template <typename T>
+using frame_vector = agl::vector<T, frame_arena::allocator<T>>;
+
+template <typename T>
+using frame_deque = agl::deque<T, frame_arena::allocator<T>>;
+
+template <typename TKey, typename TValue, typename TComp = std::less<TKey>>
+using frame_dictionary = agl::dictionary<TKey, TValue, TComp, frame_arena::allocator<std::pair<TKey, TValue>>>;
+
+template <typename T>
+frame_arena::allocator<T> frame_arena::make_allocator(lifetime life)
+{
+	return allocator<T>{ this, life };
+}
+template <typename T>
+frame_arena::allocator<T>::allocator(frame_arena* arena, lifetime life)
+	: m_arena{ arena }
+	, m_lifetime{ life }
+{
+}
+template <typename T>
+template <typename U>
+frame_arena::allocator<T>::allocator(allocator<U> const& other)
+	: m_arena{ other.m_arena }
+	, m_lifetime{ other.m_lifetime }
+{
+}
+template <typename T>
+[[nodiscard]] typename frame_arena::allocator<T>::pointer frame_arena::allocator<T>::allocate(size_type count, std::uint64_t alignment)
+{
+	AGL_ASSERT(m_arena != nullptr, "arena handle is nullptr");
+
+	return reinterpret_cast<T*>(m_arena->allocate(count * sizeof(T), alignment, m_lifetime));
+}
+template <typename T>
+template <typename... TArgs>
+void frame_arena::allocator<T>::construct(pointer buffer, TArgs&&... args)
+{
+	AGL_ASSERT(buffer != nullptr, "buffer handle is nullptr");
+
+	new (buffer) T(std::forward<TArgs>(args)...);
+}
+template <typename T>
+void frame_arena::allocator<T>::deallocate(pointer ptr, size_type count)
+{
+}
+template <typename T>
+void frame_arena::allocator<T>::destruct(pointer ptr)
+{
+	AGL_ASSERT(ptr != nullptr, "ptr handle is nullptr");
+
+	ptr->~T();
+}
+template <typename T>
+template <typename U>
+frame_arena::allocator<U> frame_arena::allocator<T>::rebind_copy() const
+{
+	return allocator<U>{ *this };
+}
+template <typename U, typename W>
+bool operator==(frame_arena::allocator<U> const& lhs, frame_arena::allocator<W> const& rhs)
+{
+	return lhs.m_arena == rhs.m_arena && lhs.m_lifetime == rhs.m_lifetime;
+}
+template <typename U, typename W>
+bool operator!=(frame_arena::allocator<U> const& lhs, frame_arena::allocator<W> const& rhs)
+{
+	return !(lhs == rhs);
+}
+}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "agl/hash-map.hpp"
+#include "agl/memory/pool.hpp"
+
+namespace agl
+{
+namespace mem
+{
+/**
+ * @brief
+ * Shares properties with 'hash_map', but is using 'pool::allocator' instead.
+ * @tparam TKey
+ * @tparam TValue
+ * @tparam THash
+ * @tparam TEqual
+ */
+template <typename TKey, typename TValue, typename THash = std::hash<TKey>, typename TEqual = std::equal_to<TKey>>
+using hash_map = agl::hash_map<TKey, TValue, THash, TEqual, pool::allocator<std::pair<TKey, TValue>>>;
+}
+}
\ No newline at end of file
@@ -0,0 +1,313 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include "agl/vector.hpp"
+
+namespace agl
+{
+namespace mem
+{
+/**
+ * @brief
+ * Pool of equally sized slots for objects of type 'T', allocating and deallocating is a constant time operation on an intrusive free list.
+ * Slots are carved from slabs allocated on demand, each slab twice as large as the previous one up to 'max_slab_size'. Slabs are only freed with the pool.
+ * Not thread-safe.
+ * @tparam T
+ */
+template <typename T>
+class object_pool
+{
+public:
+	template <typename U>
+	class allocator;
+
+	// Number of objects of the first slab.
+	static std::uint64_t default_slab_size()
+	{
+		return 64;
+	}
+	static std::uint64_t max_slab_size()
+	{
+		return 4096;
+	}
+
+public:
+	object_pool(std::uint64_t slab_size = default_slab_size());
+	object_pool(object_pool&& other);
+	object_pool(object_pool const&) = delete;
+	object_pool& operator=(object_pool&&) = delete;
+	object_pool& operator=(object_pool const&) = delete;
+	~object_pool();
+
+	// Uninitialized slot, see 'make' to construct the object as well.
+	[[nodiscard]] T* allocate();
+	// Number of slots in all slabs.
+	std::uint64_t capacity() const;
+	void deallocate(T* ptr);
+	// Destructs the object and returns its slot to the pool.
+	void destroy(T* ptr);
+	template <typename... TArgs>
+	[[nodiscard]] T* make(TArgs&&... args);
+	template <typename U = T>
+	allocator<U> make_allocator();
+	// Number of slots in use.
+	std::uint64_t occupancy() const;
+	std::uint64_t slab_count() const;
+
+public:
+	/**
+	 * @brief
+	 * Serves single objects fitting a slot from the pool, anything else (arrays, larger types rebound from 'T') from the heap.
+	 * The same object must be deallocated with the type and count it was allocated with.
+	 */
+	template <typename U>
+	class allocator
+	{
+	public:
+		static_assert(!std::is_const_v<U>, "allocator<const T> is ill-formed");
+		static_assert(!std::is_function_v<U>, "[allocator.requirements]");
+		static_assert(!std::is_reference_v<U>, "[allocator.requirements]");
+
+	public:
+		template <typename W>
+		using rebind = allocator<W>;
+		using value_type = U;
+		using pointer = U*;
+		using const_pointer = U const*;
+		using reference = U&;
+		using const_reference = U const&;
+		using size_type = std::uint64_t;
+		using difference_type = std::ptrdiff_t;
+
+		allocator(object_pool* pool = nullptr);
+		template <typename W>
+		allocator(allocator<W> const& other);
+		[[nodiscard]] pointer allocate(size_type count = 1, std::uint64_t alignment = alignof(value_type));
+		template <typename... TArgs>
+		void construct(pointer buffer, TArgs&&... args);
+		void deallocate(pointer ptr, size_type count = 1);
+		void destruct(pointer ptr);
+		template <typename W>
+		allocator<W> rebind_copy() const;
+
+	private:
+		static bool fits_slot(size_type count)
+		{
+			return count == 1 && sizeof(U) <= sizeof(slot) && alignof(U) <= alignof(slot);
+		}
+
+	private:
+		template <typename W>
+		friend class allocator;
+
+		// defined here, the pool type cannot be deduced from a nested allocator
+		template <typename W>
+		friend bool operator==(allocator const& lhs, allocator<W> const& rhs)
+		{
+			return lhs.m_pool == rhs.m_pool;
+		}
+
+		template <typename W>
+		friend bool operator!=(allocator const& lhs, allocator<W> const& rhs)
+		{
+			return lhs.m_pool != rhs.m_pool;
+		}
+
+	private:
+		object_pool* m_pool;
+	};
+
+private:
+	// a free slot stores the next free slot in place of the object
+	union slot
+	{
+		slot* next;
+		alignas(T) std::byte storage[sizeof(T)];
+	};
+
+private:
+	void add_slab();
+
+private:
+	slot* m_end; // end of the slab 'm_next' carves from
+	slot* m_free; // head of the free list
+	slot* m_next; // first slot never handed out
+	std::uint64_t m_next_slab_size;
+	std::uint64_t m_capacity;
+	std::uint64_t m_occupancy;
+	vector<slot*> m_slabs;
+};
+
+template <typename T>
+object_pool<T>::object_pool(std::uint64_t slab_size)
+	: m_end{ nullptr }
+	, m_free{ nullptr }
+	, m_next{ nullptr }
+	, m_next_slab_size{ slab_size }
+	, m_capacity{ 0 }
+	, m_occupancy{ 0 }
+{
+	AGL_ASSERT(slab_size != 0, "cannot allocate slabs of 0 objects");
+}
+template <typename T>
+object_pool<T>::object_pool(object_pool&& other)
+	: m_end{ other.m_end }
+	, m_free{ other.m_free }
+	, m_next{ other.m_next }
+	, m_next_slab_size{ other.m_next_slab_size }
+	, m_capacity{ other.m_capacity }
+	, m_occupancy{ other.m_occupancy }
+	, m_slabs{ std::move(other.m_slabs) }
+{
+	other.m_end = nullptr;
+	other.m_free = nullptr;
+	other.m_next = nullptr;
+	other.m_capacity = 0;
+	other.m_occupancy = 0;
+}
+template <typename T>
+object_pool<T>::~object_pool()
+{
+	AGL_ASSERT(m_occupancy == 0, "objects still in use");
+
+	for (auto* slab : m_slabs)
+		delete[] slab;
+}
+template <typename T>
+[[nodiscard]] T* object_pool<T>::allocate()
+{
+	auto* s = m_free;
+	if (s != nullptr)
+		m_free = s->next;
+	else
+	{
+		if (m_next == m_end)
+			add_slab();
+
+		s = m_next++;
+	}
+
+	++m_occupancy;
+	return reinterpret_cast<T*>(s->storage);
+}
+template <typename T>
+std::uint64_t object_pool<T>::capacity() const
+{
+	return m_capacity;
+}
+template <typename T>
+void object_pool<T>::deallocate(T* ptr)
+{
+	AGL_ASSERT(ptr != nullptr, "ptr handle is nullptr");
+	AGL_ASSERT(m_occupancy > 0, "pool is empty");
+
+	auto* s = reinterpret_cast<slot*>(ptr);
+	s->next = m_free;
+	m_free = s;
+	--m_occupancy;
+}
+template <typename T>
+void object_pool<T>::destroy(T* ptr)
+{
+	AGL_ASSERT(ptr != nullptr, "ptr handle is nullptr");
+
+	ptr->~T();
+	deallocate(ptr);
+}
+template <typename T>
+template <typename... TArgs>
+[[nodiscard]] T* object_pool<T>::make(TArgs&&... args)
+{
+	auto* ptr = allocate();
+	return new (ptr) T(std::forward<TArgs>(args)...);
+}
+template <typename T>
+template <typename U>
+typename object_pool<T>::template allocator<U> object_pool<T>::make_allocator()
+{
+	return allocator<U>{ this };
+}
+template <typename T>
+std::uint64_t object_pool<T>::occupancy() const
+{
+	return m_occupancy;
+}
+template <typename T>
+std::uint64_t object_pool<T>::slab_count() const
+{
+	return m_slabs.size();
+}
+template <typename T>
+void object_pool<T>::add_slab()
+{
+	// slots are carved lazily, a new slab is never walked
+	auto const count = m_next_slab_size;
+	m_slabs.push_back(new slot[count]);
+	m_next = m_slabs.back();
+	m_end = m_next + count;
+	m_capacity += count;
+	m_next_slab_size = std::min(count * 2, std::max(count, max_slab_size()));
+}
+
+template <typename T>
+template <typename U>
+object_pool<T>::allocator<U>::allocator(object_pool* pool)
+	: m_pool{ pool }
+{
+}
+template <typename T>
+template <typename U>
+template <typename W>
+object_pool<T>::allocator<U>::allocator(allocator<W> const& other)
+	: m_pool{ other.m_pool }
+{
+}
+template <typename T>
+template <typename U>
+[[nodiscard]] typename object_pool<T>::template allocator<U>::pointer object_pool<T>::allocator<U>::allocate(size_type count, std::uint64_t alignment)
+{
+	AGL_ASSERT(m_pool != nullptr, "pool handle is nullptr");
+	AGL_ASSERT(alignment <= alignof(U), "alignment stronger than the type's is not supported");
+
+	if (fits_slot(count))
+		return reinterpret_cast<U*>(m_pool->allocate());
+
+	return reinterpret_cast<U*>(::operator new(count * sizeof(U), std::align_val_t{ alignof(U) }));
+}
+template <typename T>
+template <typename U>
+template <typename... TArgs>
+void object_pool<T>::allocator<U>::construct(pointer buffer, TArgs&&... args)
+{
+	AGL_ASSERT(buffer != nullptr, "buffer handle is nullptr");
+
+	new (buffer) U(std::forward<TArgs>(args)...);
+}
+template <typename T>
+template <typename U>
+void object_pool<T>::allocator<U>::deallocate(pointer ptr, size_type count)
+{
+	AGL_ASSERT(m_pool != nullptr, "pool handle is nullptr");
+
+	if (fits_slot(count))
+		m_pool->deallocate(reinterpret_cast<T*>(ptr));
+	else
+		::operator delete(ptr, std::align_val_t{ alignof(U) });
+}
+template <typename T>
+template <typename U>
+void object_pool<T>::allocator<U>::destruct(pointer ptr)
+{
+	AGL_ASSERT(ptr != nullptr, "ptr handle is nullptr");
+
+	ptr->~U();
+}
+template <typename T>
+template <typename U>
+template <typename W>
+typename object_pool<T>::template allocator<W> object_pool<T>::allocator<U>::rebind_copy() const
+{
+	return allocator<W>{ *this };
+}
+}
+}
@@ -1,12 +1,26 @@
 #pragma once
+#include <atomic>
 #include <cstddef>
+#include <limits>
+#include <mutex>
 #include "agl/core/application.hpp"
+#include "agl/memory/tracker.hpp"
 #include "agl/vector.hpp"
 
 namespace agl
 {
 namespace mem
 {
+/**
+ * @brief
+ * Memory pool made of chunks, a new chunk of at least 'get_chunk_size()' bytes is added whenever the existing ones cannot serve an allocation, until 'get_max_size()' is reached. Chunks left empty are given back, except the last one.
+ * Allocations of up to 'small_size_limit()' bytes are served in constant time from per size class free lists, the blocks of a class are carved from slabs of 'slab_size()' bytes.
+ * Larger allocations, and those needing a stronger alignment than their class provides, go through a best-fit search over the free spaces.
+ * Slabs are not given back to the best-fit path once made, freed blocks are kept for later allocations of the same class.
+ * Free spaces are merged with their free neighbours on deallocation, see 'get_fragmentation' for how scattered the remaining ones are.
+ * The pool is thread-safe. Every thread keeps a cache of small blocks per size class, refilled from and flushed to the shared free lists in batches, so only large blocks and cache misses take the lock. The caches of a thread are flushed when it exits.
+ * Chunks come from the heap by default, see 'backing' to map them from the system instead.
+ */
 class pool
 	: public resource<pool>
 {
@@ -14,20 +28,71 @@ public:
 	template <typename T>
 	class allocator;
 
+	/**
+	 * @brief
+	 * State of the free spaces of the best-fit path, the slabs of the size classes are not included.
+	 */
+	struct fragmentation
+	{
+		std::uint64_t free_block_count;
+		std::uint64_t free_size;
+		std::uint64_t largest_free_block;
+		double ratio; // external fragmentation, '1 - largest_free_block / free_size'
+	};
+
+	/**
+	 * @brief
+	 * Where chunks come from. Mapped chunks are only backed by physical memory once touched, and the pages of large freed blocks are given back to the system.
+	 */
+	enum backing : std::uint32_t
+	{
+		HEAP = 0,
+		MAPPED = 1 << 0,
+		HUGE_PAGES = 1 << 1 | MAPPED, // cuts TLB misses over large chunks
+		POPULATE = 1 << 2 | MAPPED, // commits chunks up front
+	};
+
+	struct chunk_usage
+	{
+		std::byte* memory;
+		std::uint64_t size;
+		std::uint64_t occupancy;
+	};
+
+	static std::uint64_t default_chunk_size()
+	{
+		return 10 * 1024 * 1024;
+	}
+	static std::uint64_t unlimited()
+	{
+		return std::numeric_limits<std::uint64_t>::max();
+	}
+
 public:
-	pool();
+	// 'backing' is a combination of 'backing' flags.
+	pool(std::uint64_t chunk_size = default_chunk_size(), std::uint64_t max_size = unlimited(), std::uint32_t backing = HEAP);
 	pool(pool&& other);
 	pool& operator=(pool&& other);
 	~pool() noexcept;
 
 	std::byte* allocate(std::uint64_t size, std::uint64_t alignment);
+	std::uint64_t chunk_count() const;
+	// Gives the blocks cached by the calling thread back to the shared free lists.
+	void flush_thread_cache();
+	// Makes the first chunk, of 'size' bytes.
 	void create(std::uint64_t size);
 	void destroy();
 	void deallocate(std::byte* ptr, std::uint64_t size);
+	// Every chunk is fully occupied and no other can be added.
 	bool full() const;
 	bool empty() const;
+	std::uint64_t get_chunk_size() const;
+	chunk_usage get_chunk_usage(std::uint64_t index) const;
+	fragmentation get_fragmentation() const;
+	std::uint64_t get_max_size() const;
 	template <typename T>
 	allocator<T> make_allocator();
+	// Bytes held by users, blocks cached by threads are not included.
 	std::uint64_t occupancy() const;
 	std::uint64_t size() const;
 	bool has_pointer(std::byte* ptr) const;
@@ -94,31 +159,137 @@ private:
 		std::byte* ptr;
 		std::uint64_t size;
 	};
+
+	struct chunk
+	{
+		std::byte* memory;
+		std::uint64_t size;
+		std::uint64_t occupancy;
+		std::uintptr_t slab_base; // 'memory' rounded down to 'slab_size()'
+		vector<std::uint8_t> slabs; // size class plus one of every 'slab_size()' granule from 'slab_base', 0 if not a slab
+	};
+
+	struct size_class
+	{
+		std::byte* free; // intrusive list of freed blocks, each one stores the next
+		std::byte* next; // first block of the current slab never handed out
+		std::byte* end;
+	};
+
+	struct chunk_range
+	{
+		std::byte* begin;
+		std::byte* end;
+		chunk* ch;
+	};
+
+	struct cached_class
+	{
+		std::byte* free; // intrusive list, as in 'size_class'
+		std::uint64_t count;
+	};
+
+	/**
+	 * @brief
+	 * Small blocks owned by a single thread. Blocks in the cache are still counted as occupied by the shared pool and its chunks.
+	 */
+	struct thread_cache
+	{
+		vector<cached_class> classes;
+		std::atomic<std::uint64_t> cached; // bytes, written by the owning thread only
+		std::uint64_t chunks_version;
+		vector<chunk_range> chunks; // copy of the chunk table, refreshed whenever 'm_chunks_version' changes
+	};
+
+	static std::uint64_t slab_size()
+	{
+		return 16 * 1024;
+	}
+	static std::uint64_t small_size_limit()
+	{
+		return 512;
+	}
+	static std::uint64_t size_class_count()
+	{
+		return 33;
+	}
+	// Blocks moved between a thread cache and the shared free lists at once.
+	static std::uint64_t cache_batch_size()
+	{
+		return 32;
+	}
+	// Freed blocks of mapped chunks from this size on give their pages back, see 'get_discard_size'.
+	static std::uint64_t discard_threshold()
+	{
+		return 64 * 1024;
+	}
 	
 private:
 	static bool free_space_comparator(std::uint64_t size, pool::space const& space);
 	static bool occupied_space_comparator(std::byte* ptr, pool::space const& space);
 
-
-	space pop_free_space(std::uint64_t size);
+	// Class 0 holds 8 byte blocks, the others multiples of 16 bytes up to 'small_size_limit()'.
+	static std::uint64_t get_size_class(std::uint64_t size);
+	static std::uint64_t get_class_size(std::uint64_t size_class);
+	static std::uint64_t get_class_alignment(std::uint64_t size_class);
+
+	std::byte* allocate_small(std::uint64_t size_class);
+	void deallocate_small(std::byte* ptr, std::uint64_t size_class);
+	// Returns 'size_class_count()' if 'ptr' does not lie in a slab of 'ch'.
+	std::uint64_t find_slab_class(chunk const& ch, std::byte* ptr) const;
+
+	// Called with 'm_mutex' held.
+	void flush_cache(thread_cache& cache, std::uint64_t size_class, std::uint64_t count);
+	thread_cache& get_thread_cache();
+	// Flushes 'cache' and drops it, called when its thread exits.
+	void release_thread_cache(thread_cache& cache);
+	// Returns the size class of 'ptr' without locking, 'size_class_count()' if it is not a small block.
+	std::uint64_t find_cached_class(thread_cache& cache, std::byte* ptr);
+
+	void add_chunk(std::uint64_t size);
+	void free_chunk(chunk const& ch) const;
+	// Smallest freed block whose pages are discarded, 0 if chunks are not mapped.
+	std::uint64_t get_discard_size() const;
+	// Returns 'm_chunks.size()' if 'ptr' does not belong to the pool.
+	std::uint64_t find_chunk(std::byte* ptr) const;
+	// Adds a chunk able to hold 'size' bytes aligned to 'alignment', returns false if the maximum size would be exceeded.
+	bool grow(std::uint64_t size, std::uint64_t alignment);
+	void release_chunk(std::uint64_t index);
+
+	void erase_free_space(pool::space space);
+	space pop_free_space(std::uint64_t size, std::uint64_t alignment);
+	// Merges 'space' with the adjacent free spaces.
 	void push_free_space(pool::space space);
 	void pop_occupied_space(std::byte* ptr);
 	void push_occupied_space(pool::space space);
 
+	agl::vector<space>::const_iterator find_free_address(std::byte* ptr) const;
 	agl::vector<space>::const_iterator find_free_space(std::uint64_t size) const;
 	agl::vector<space>::const_iterator find_occupied_space(std::byte* ptr) const;
 
+	// Caches of the calling thread by pool id, given back to their pools when the thread exits.
+	struct thread_cache_owner;
+	static thread_cache_owner& get_cache_owner();
 
 	virtual void on_attach(application* app) override;
 	virtual void on_detach(application* app) override;
 	virtual void on_update(application* app) override;
 
 private:
-	std::byte* m_memory;
+	std::uint32_t m_backing;
+	vector<unique_ptr<thread_cache>> m_caches;
+	std::uint64_t m_chunk_size;
+	vector<unique_ptr<chunk>> m_chunks; // sorted by address, chunks never move so that thread caches can refer to them
+	std::atomic<std::uint64_t> m_chunks_version;
+	vector<space> m_free_addresses; // same as 'm_free_spaces', sorted by address
+	vector<space> m_free_spaces; // sorted by size, then address
+	std::uint64_t m_id; // tells the thread caches of a pool apart from those of a destroyed one at the same address
+	std::uint64_t m_max_size;
+	mutable std::mutex m_mutex; // guards everything but the thread caches
 	std::uint64_t m_occupancy;
-	std::uint64_t m_size;
-	vector<space> m_free_spaces;
 	vector<space> m_occupied_spaces;
+	std::uint64_t m_size;
+	vector<size_class> m_size_classes;
 };
 
 template <typename T>
@@ -211,7 +382,9 @@ template <typename T>
 	AGL_ASSERT(m_pool != nullptr, "pool handle is nullptr");
 
 	m_alloc_count += count;
-	return reinterpret_cast<T*>(m_pool->allocate(count * sizeof(T), alignment));
+	auto* ptr = m_pool->allocate(count * sizeof(T), alignment);
+	AGL_TRACK_ALLOCATION(T, ptr, count * sizeof(T));
+	return reinterpret_cast<T*>(ptr);
 }
 template <typename T>
 template <typename... TArgs>
@@ -230,6 +403,7 @@ void pool::allocator<T>::deallocate(pointer ptr, size_type count)
 	AGL_ASSERT(m_alloc_count > 0, "invalid deallocation call");
 
 	m_alloc_count -= count;
+	AGL_TRACK_DEALLOCATION(ptr);
 	m_pool->deallocate(reinterpret_cast<std::byte*>(ptr), count * sizeof(T));
 }
 template <typename T>
@@ -259,6 +433,12 @@ bool operator!=(pool::allocator<U> const& lhs, pool::allocator<W> const& rhs)
 	return lhs.m_pool != rhs.m_pool;
 }
 }
+
+template <typename T>
+struct is_trivially_relocatable<mem::pool::allocator<T>>
+	: std::true_type
+{
+};
 }
 
 /*
@@ -0,0 +1,18 @@
+#pragma once
+#include "agl/memory/pool.hpp"
+#include "agl/small-vector.hpp"
+
+namespace agl
+{
+namespace mem
+{
+/**
+ * @brief
+ * Shares properties with 'small_vector', but is using 'pool::allocator' instead.
+ * @tparam T
+ * @tparam N
+ */
+template <typename T, std::uint64_t N>
+using small_vector = agl::small_vector<T, N, pool::allocator<T>>;
+}
+}
\ No newline at end of file
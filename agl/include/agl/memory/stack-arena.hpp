@@ -0,0 +1,192 @@
+#pragma once
+#include <cstddef>
+#include "agl/set.hpp"
+#include "agl/vector.hpp"
+
+namespace agl
+{
+namespace mem
+{
+/**
+ * @brief
+ * LIFO allocator over a fixed buffer, meant for short-lived containers whose lifetimes are strictly nested.
+ * 'get_marker' remembers the top of the stack and 'rewind' releases everything allocated after it with a single reset, 'scope' does both for a block of code.
+ * Deallocating the top allocation pops it, any other deallocation is deferred until the stack is rewound below it.
+ * Once the buffer is exhausted, allocations fall back to the heap and are released the same way.
+ */
+class stack_arena
+{
+public:
+	template <typename T>
+	class allocator;
+
+	struct marker
+	{
+		std::uint64_t offset;
+		std::uint64_t overflow_count;
+	};
+
+	/**
+	 * @brief
+	 * Rewinds the arena to where it was on construction.
+	 */
+	class scope
+	{
+	public:
+		scope(stack_arena& arena);
+		scope(scope const&) = delete;
+		scope& operator=(scope const&) = delete;
+		~scope();
+
+	private:
+		stack_arena& m_arena;
+		marker m_marker;
+	};
+
+	static std::uint64_t default_size()
+	{
+		return 64 * 1024;
+	}
+
+	// Scratch stack of the calling thread, made on first use.
+	static stack_arena& get_thread_stack();
+
+public:
+	stack_arena(std::uint64_t size = default_size());
+	stack_arena(stack_arena&& other);
+	stack_arena(stack_arena const&) = delete;
+	stack_arena& operator=(stack_arena&&) = delete;
+	stack_arena& operator=(stack_arena const&) = delete;
+	~stack_arena();
+
+	std::byte* allocate(std::uint64_t size, std::uint64_t alignment);
+	void deallocate(std::byte* ptr, std::uint64_t size);
+	marker get_marker() const;
+	template <typename T>
+	allocator<T> make_allocator();
+	// Bytes of the buffer in use, the heap fallback is not included.
+	std::uint64_t occupancy() const;
+	void rewind(marker const& m);
+	std::uint64_t size() const;
+
+public:
+	template <typename T>
+	class allocator
+	{
+	public:
+		static_assert(!std::is_const_v<T>, "allocator<const T> is ill-formed");
+		static_assert(!std::is_function_v<T>, "[allocator.requirements]");
+		static_assert(!std::is_reference_v<T>, "[allocator.requirements]");
+
+	public:
+		template <typename U>
+		using rebind = allocator<U>;
+		using value_type = T;
+		using pointer = T*;
+		using const_pointer = T const*;
+		using reference = T&;
+		using const_reference = T const&;
+		using size_type = std::uint64_t;
+		using difference_type = std::ptrdiff_t;
+
+		allocator(stack_arena* arena = nullptr);
+		template <typename U>
+		allocator(allocator<U> const& other);
+		[[nodiscard]] pointer allocate(size_type count = 1, std::uint64_t alignment = alignof(value_type));
+		template <typename... TArgs>
+		void construct(pointer buffer, TArgs&&... args);
+		void deallocate(pointer ptr, size_type count = 1);
+		void destruct(pointer ptr);
+		template <typename U>
+		allocator<U> rebind_copy() const;
+
+	private:
+		template <typename U>
+		friend class allocator;
+
+		template <typename U, typename W>
+		friend bool operator==(allocator<U> const&, allocator<W> const&);
+
+		template <typename U, typename W>
+		friend bool operator!=(allocator<U> const&, allocator<W> const&);
+
+	private:
+		stack_arena* m_arena;
+	};
+
+private:
+	std::byte* m_memory;
+	std::uint64_t m_offset;
+	vector<std::byte*> m_overflow; // heap allocations in allocation order, nullptr once deallocated
+	std::uint64_t m_size;
+};
+
+template <typename T>
+using stack_vector = agl::vector<T, stack_arena::allocator<T>>;
+
+template <typename T, typename TComp = std::less<T>>
+using stack_set = agl::set<T, TComp, stack_arena::allocator<T>>;
+
+template <typename T>
+stack_arena::allocator<T> stack_arena::make_allocator()
+{
+	return allocator<T>{ this };
+}
+template <typename T>
+stack_arena::allocator<T>::allocator(stack_arena* arena)
+	: m_arena{ arena }
+{
+}
+template <typename T>
+template <typename U>
+stack_arena::allocator<T>::allocator(allocator<U> const& other)
+	: m_arena{ other.m_arena }
+{
+}
+template <typename T>
+[[nodiscard]] typename stack_arena::allocator<T>::pointer stack_arena::allocator<T>::allocate(size_type count, std::uint64_t alignment)
+{
+	AGL_ASSERT(m_arena != nullptr, "arena handle is nullptr");
+
+	return reinterpret_cast<T*>(m_arena->allocate(count * sizeof(T), alignment));
+}
+template <typename T>
+template <typename... TArgs>
+void stack_arena::allocator<T>::construct(pointer buffer, TArgs&&... args)
+{
+	AGL_ASSERT(buffer != nullptr, "buffer handle is nullptr");
+
+	new (buffer) T(std::forward<TArgs>(args)...);
+}
+template <typename T>
+void stack_arena::allocator<T>::deallocate(pointer ptr, size_type count)
+{
+	AGL_ASSERT(m_arena != nullptr, "arena handle is nullptr");
+
+	m_arena->deallocate(reinterpret_cast<std::byte*>(ptr), count * sizeof(T));
+}
+template <typename T>
+void stack_arena::allocator<T>::destruct(pointer ptr)
+{
+	AGL_ASSERT(ptr != nullptr, "ptr handle is nullptr");
+
+	ptr->~T();
+}
+template <typename T>
+template <typename U>
+stack_arena::allocator<U> stack_arena::allocator<T>::rebind_copy() const
+{
+	return allocator<U>{ *this };
+}
+template <typename U, typename W>
+bool operator==(stack_arena::allocator<U> const& lhs, stack_arena::allocator<W> const& rhs)
+{
+	return lhs.m_arena == rhs.m_arena;
+}
+template <typename U, typename W>
+bool operator!=(stack_arena::allocator<U> const& lhs, stack_arena::allocator<W> const& rhs)
+{
+	return lhs.m_arena != rhs.m_arena;
+}
+}
+}
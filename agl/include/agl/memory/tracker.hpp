@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "agl/util/typeid.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AGL_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define AGL_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+// Reports to 'mem::tracker::get()', compiled out unless 'AGL_TRACK_ALLOCATIONS' is defined.
+// 'AGL_ALLOCATION_SITE' goes first in the public functions of containers and pools, it makes their caller the call site of what they allocate.
+#ifdef AGL_TRACK_ALLOCATIONS
+#define AGL_ALLOCATION_SITE() \
+		::agl::mem::tracker::site_scope const agl_allocation_site{ AGL_RETURN_ADDRESS() }
+#define AGL_TRACK_ALLOCATION(type, ptr, size) \
+		::agl::mem::tracker::get().on_allocate(::agl::type_id<type>::get_id(), (ptr), (size), ::agl::mem::tracker::get_site(AGL_RETURN_ADDRESS()))
+#define AGL_TRACK_DEALLOCATION(ptr) \
+		::agl::mem::tracker::get().on_deallocate((ptr))
+#else
+#define AGL_ALLOCATION_SITE() \
+		do { \
+		} while(false)
+#define AGL_TRACK_ALLOCATION(type, ptr, size) \
+		do { \
+		} while(false)
+#define AGL_TRACK_DEALLOCATION(ptr) \
+		do { \
+		} while(false)
+#endif
+
+namespace agl
+{
+namespace mem
+{
+/**
+ * @brief
+ * Records the live allocations per type and per call site. A call site is the caller of the outermost container or pool function marked with 'AGL_ALLOCATION_SITE', or else the caller of the allocator. Sites are exact in builds that do not inline these functions.
+ * 'mem::allocator' and 'pool::allocator' report to 'get()' when the library is built with 'AGL_TRACK_ALLOCATIONS' (CMake option of the same name).
+ * Thread-safe. Uses the standard containers, the tracked allocators cannot be used from within.
+ */
+class tracker
+{
+public:
+	struct type_stats
+	{
+		type_id_t type;
+		std::int64_t count; // live allocations
+		std::int64_t bytes; // live bytes
+		std::int64_t peak_bytes;
+		std::int64_t total_count; // allocations made so far
+	};
+
+	struct site_stats
+	{
+		void const* site;
+		type_id_t type;
+		std::int64_t count;
+		std::int64_t bytes;
+		std::int64_t total_count;
+	};
+
+	/**
+	 * @brief
+	 * State of the tracker at one point in time. Types are sorted by id, sites by address then type id.
+	 */
+	class snapshot
+	{
+	public:
+		// Changes since 'earlier', entries that did not change are left out. Peaks are kept as they are.
+		snapshot diff(snapshot const& earlier) const;
+		// Writes the snapshot as CSV: 'kind,type,site,count,bytes,peak_bytes,total_count', one line per type then per site.
+		bool dump(std::string const& path) const;
+		type_stats const* find(type_id_t type) const;
+		std::int64_t get_bytes() const;
+		std::int64_t get_peak_bytes() const;
+		std::vector<site_stats> const& get_sites() const;
+		std::vector<type_stats> const& get_types() const;
+
+	private:
+		friend class tracker;
+
+	private:
+		std::int64_t m_bytes;
+		std::int64_t m_peak_bytes;
+		std::vector<site_stats> m_sites;
+		std::vector<type_stats> m_types;
+	};
+
+	/**
+	 * @brief
+	 * Makes 'site' the call site of the allocations of the current thread while it lives, unless an enclosing scope already set one. See 'AGL_ALLOCATION_SITE'.
+	 */
+	class site_scope
+	{
+	public:
+		explicit site_scope(void const* site);
+		site_scope(site_scope const&) = delete;
+		site_scope& operator=(site_scope const&) = delete;
+		~site_scope();
+
+	private:
+		void const* m_previous;
+	};
+
+	// Instance the allocators report to, never destroyed so that allocations freed during static destruction are still recorded.
+	static tracker& get();
+	// Site of the outermost 'site_scope' of the current thread, 'fallback' outside of any.
+	static void const* get_site(void const* fallback);
+
+public:
+	tracker();
+	tracker(tracker const&) = delete;
+	tracker& operator=(tracker const&) = delete;
+
+	void on_allocate(type_id_t type, void const* ptr, std::uint64_t size, void const* site);
+	// Unknown pointers are ignored, they were allocated before tracking started.
+	void on_deallocate(void const* ptr);
+	snapshot take_snapshot() const;
+
+private:
+	struct allocation
+	{
+		type_id_t type;
+		void const* site;
+		std::uint64_t size;
+	};
+
+private:
+	std::unordered_map<void const*, allocation> m_allocations;
+	std::int64_t m_bytes;
+	mutable std::mutex m_mutex;
+	std::int64_t m_peak_bytes;
+	std::map<std::pair<void const*, std::uint64_t>, site_stats> m_sites;
+	std::map<std::uint64_t, type_stats> m_types;
+};
+}
+}
@@ -17,6 +17,7 @@ using unique_ptr = ::agl::unique_ptr<T, pool::allocator<T>>;
 template <typename T, typename U, typename W>
 mem::unique_ptr<T> make_unique(pool::allocator<W> allocator, U&& value)
 {
+	AGL_ALLOCATION_SITE();
 	using type = remove_cvref_t<U>;
 	auto true_allocator = allocator.rebind_copy<type>();
 	auto* ptr = true_allocator.allocate();
@@ -26,6 +27,7 @@ mem::unique_ptr<T> make_unique(pool::allocator<W> allocator, U&& value)
 template <typename T, typename U>
 mem::unique_ptr<T> make_unique(pool::allocator<U> allocator)
 {
+	AGL_ALLOCATION_SITE();
 	using type = remove_cvref_t<T>;
 	auto true_allocator = allocator.rebind_copy<type>();
 	auto* ptr = true_allocator.allocate();
@@ -35,6 +37,7 @@ mem::unique_ptr<T> make_unique(pool::allocator<U> allocator)
 template <typename T, typename U>
 mem::unique_ptr<T> make_unique(mem::pool& pool, U&& value)
 {
+	AGL_ALLOCATION_SITE();
 	using type = remove_cvref_t<U>;
 	auto allocator = pool.make_allocator<type>();
 	auto* ptr = allocator.allocate();
@@ -44,6 +47,7 @@ mem::unique_ptr<T> make_unique(mem::pool& pool, U&& value)
 template <typename T>
 mem::unique_ptr<T> make_unique(mem::pool& pool)
 {
+	AGL_ALLOCATION_SITE();
 	auto allocator = pool.make_allocator<T>();
 	auto* ptr = allocator.allocate();
 	allocator.construct(ptr);
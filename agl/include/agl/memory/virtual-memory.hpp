@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace agl
+{
+namespace mem
+{
+/**
+ * @brief
+ * Anonymous memory mapped straight from the system, page aligned and zeroed. Physical pages are only committed once touched.
+ */
+namespace virtual_memory
+{
+enum flags : std::uint32_t
+{
+	NONE = 0,
+	HUGE_PAGES = 1 << 0, // transparent huge pages where available, the mapping is aligned to 'huge_page_size()'
+	POPULATE = 1 << 1, // commits every page up front
+};
+
+std::uint64_t page_size();
+std::uint64_t huge_page_size();
+
+// Returns nullptr on failure.
+std::byte* map(std::uint64_t size, std::uint32_t flags);
+// 'size' and 'flags' must be those given to 'map'.
+void unmap(std::byte* ptr, std::uint64_t size, std::uint32_t flags);
+// Gives the pages lying entirely within the range back to the system, they stay mapped but their content is lost.
+void discard(std::byte* ptr, std::uint64_t size);
+}
+}
+}
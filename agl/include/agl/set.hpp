@@ -234,4 +234,10 @@ private:
 	comp_type m_comp;
 	data_type m_data;
 };
+
+template <typename T, typename TComp, typename TAlloc>
+struct is_trivially_relocatable<set<T, TComp, TAlloc>>
+	: std::bool_constant<is_trivially_relocatable_v<TComp> && is_trivially_relocatable_v<typename set<T, TComp, TAlloc>::data_type>>
+{
+};
 }
\ No newline at end of file
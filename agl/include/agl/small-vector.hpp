@@ -0,0 +1,629 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <type_traits>
+#include "agl/core/debug.hpp"
+#include "agl/util/iterator.hpp"
+#include "agl/util/type-traits.hpp"
+#include "agl/memory/allocator.hpp"
+#include "agl/vector.hpp"
+
+namespace agl
+{
+/**
+ * @brief
+ * Shares the interface of 'vector', but stores up to 'N' elements inline and only allocates once it grows past them.
+ * Moving it back under 'N' elements keeps the allocation, 'clear' and 'shrink_to_fit' go back to the inline storage.
+ * The buffer in use is derived from the capacity rather than pointed to, so the container stays trivially relocatable when its elements are.
+ * @tparam T
+ * @tparam N number of inline elements
+ * @tparam TAlloc
+ */
+template <typename T, std::uint64_t N, typename TAlloc = mem::allocator<T>>
+class small_vector
+{
+public:
+	static_assert(N > 0, "use 'vector' for no inline storage");
+
+public:
+	using allocator_type = typename TAlloc::template rebind<T>;
+	using value_type = typename type_traits<T>::value_type;
+	using pointer = typename type_traits<T>::pointer;
+	using const_pointer = typename type_traits<T>::const_pointer;
+	using reference = typename type_traits<T>::reference;
+	using const_reference = typename type_traits<T>::const_reference;
+	using size_type = typename type_traits<T>::size_type;
+	using difference_type = typename type_traits<T>::difference_type;
+
+	using iterator = vector_iterator<T, impl::iterator_traits<T>>;
+	using const_iterator = vector_iterator<T, impl::const_iterator_traits<T>>;
+	using reverse_iterator = vector_reverse_iterator<T, impl::iterator_traits<T>>;
+	using reverse_const_iterator = vector_reverse_iterator<T, impl::const_iterator_traits<T>>;
+
+	static constexpr size_type inline_capacity()
+	{
+		return N;
+	}
+
+	small_vector()
+		: m_allocator{ }
+		, m_capacity{ N }
+		, m_size{ 0 }
+	{
+	}
+	explicit small_vector(allocator_type const& alloc)
+		: m_allocator{ alloc }
+		, m_capacity{ N }
+		, m_size{ 0 }
+	{
+	}
+	template <typename TInputIt, typename TEnable = impl::is_iterator<TInputIt>>
+	small_vector(TInputIt first, TInputIt last)
+		: small_vector{}
+	{
+		AGL_ALLOCATION_SITE();
+		assign(first, last);
+	}
+	small_vector(std::initializer_list<T> list)
+		: small_vector{}
+	{
+		AGL_ALLOCATION_SITE();
+		assign(list.begin(), list.end());
+	}
+	small_vector(small_vector&& other)
+		: m_allocator{ std::move(other.m_allocator) }
+		, m_capacity{ N }
+		, m_size{ 0 }
+	{
+		take(other);
+	}
+	small_vector(small_vector const& other)
+		: small_vector{ other.m_allocator }
+	{
+		AGL_ALLOCATION_SITE();
+
+		reserve(other.size());
+		construct_range(0, other.data(), other.size());
+		m_size = other.size();
+	}
+	small_vector& operator=(small_vector&& other)
+	{
+		if (this == &other)
+			return *this;
+
+		clear();
+		m_allocator = std::move(other.m_allocator);
+		take(other);
+		return *this;
+	}
+	small_vector& operator=(small_vector const& other)
+	{
+		AGL_ALLOCATION_SITE();
+
+		if (this == &other)
+			return *this;
+
+		clear();
+		m_allocator = other.m_allocator;
+
+		reserve(other.size());
+		construct_range(0, other.data(), other.size());
+		m_size = other.size();
+		return *this;
+	}
+	~small_vector()
+	{
+		clear();
+	}
+	reference at(size_type index)
+	{
+		AGL_ASSERT(index < size(), "Index out of bounds");
+
+		return data()[index];
+	}
+	const_reference at(size_type index) const
+	{
+		AGL_ASSERT(index < size(), "Index out of bounds");
+
+		return data()[index];
+	}
+	void assign(size_type count, const_reference value)
+	{
+		AGL_ALLOCATION_SITE();
+
+		// 'value' may be one of the elements about to be destructed
+		if (data() <= &value && &value < data() + size())
+		{
+			auto const copy = value_type(value);
+			assign(count, copy);
+			return;
+		}
+
+		destruct_from(0);
+		reserve(count);
+		fill(0, count, value);
+		m_size = count;
+	}
+	template <typename TInputIt, typename TEnable = impl::is_iterator_t<TInputIt>>
+	void assign(TInputIt first, TInputIt last)
+	{
+		AGL_ALLOCATION_SITE();
+
+		auto const count = static_cast<size_type>(last - first);
+		destruct_from(0);
+		reserve(count);
+		construct_range(0, first, count);
+		m_size = count;
+	}
+	iterator begin()
+	{
+		return make_iterator<iterator>(data());
+	}
+	const_iterator begin() const
+	{
+		return cbegin();
+	}
+	const_iterator cbegin() const
+	{
+		return make_iterator<const_iterator>(data());
+	}
+	iterator end()
+	{
+		return make_iterator<iterator>(data() + size());
+	}
+	const_iterator end() const
+	{
+		return cend();
+	}
+	const_iterator cend() const
+	{
+		return make_iterator<const_iterator>(data() + size());
+	}
+	reverse_iterator rbegin()
+	{
+		if (empty())
+			return make_iterator<reverse_iterator>(nullptr);
+		return make_iterator<reverse_iterator>(data() + size() - 1);
+	}
+	reverse_const_iterator rbegin() const
+	{
+		return crbegin();
+	}
+	reverse_const_iterator crbegin() const
+	{
+		if (empty())
+			return make_iterator<reverse_const_iterator>(nullptr);
+		return make_iterator<reverse_const_iterator>(data() + size() - 1);
+	}
+	reverse_iterator rend()
+	{
+		if (empty())
+			return make_iterator<reverse_iterator>(nullptr);
+		return make_iterator<reverse_iterator>(data() - 1);
+	}
+	reverse_const_iterator rend() const
+	{
+		return crend();
+	}
+	reverse_const_iterator crend() const
+	{
+		if (empty())
+			return make_iterator<reverse_const_iterator>(nullptr);
+		return make_iterator<reverse_const_iterator>(data() - 1);
+	}
+	reference operator[](size_type index)
+	{
+		return data()[index];
+	}
+	const_reference operator[](size_type index) const
+	{
+		return data()[index];
+	}
+	reference front()
+	{
+		AGL_ASSERT(!empty(), "Index out of bounds");
+
+		return *data();
+	}
+	const_reference front() const
+	{
+		AGL_ASSERT(!empty(), "Index out of bounds");
+
+		return *data();
+	}
+	reference back()
+	{
+		AGL_ASSERT(!empty(), "Index out of bounds");
+
+		return data()[size() - 1];
+	}
+	const_reference back() const
+	{
+		AGL_ASSERT(!empty(), "Index out of bounds");
+
+		return data()[size() - 1];
+	}
+	pointer data()
+	{
+		return is_inline() ? reinterpret_cast<pointer>(m_storage.local) : m_storage.heap;
+	}
+	const_pointer data() const
+	{
+		return is_inline() ? reinterpret_cast<const_pointer>(m_storage.local) : m_storage.heap;
+	}
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+	allocator_type get_allocator() const
+	{
+		return m_allocator;
+	}
+	// Whether the elements live in the inline storage.
+	bool is_inline() const
+	{
+		return m_capacity == N;
+	}
+	size_type size() const
+	{
+		return m_size;
+	}
+	// New elements are value-initialized.
+	void resize(size_type n)
+	{
+		AGL_ALLOCATION_SITE();
+
+		if (n > capacity())
+			realloc(grow_capacity(n));
+
+		if constexpr (std::is_trivially_copyable_v<value_type> && std::is_default_constructible_v<value_type>)
+		{
+			if (n > size())
+				fill(size(), n - size(), value_type{});
+		}
+		else
+		{
+			for (auto i = size(); i < n; ++i)
+				construct(data() + i);
+		}
+
+		destruct_from(n);
+		m_size = n;
+	}
+	size_type capacity() const
+	{
+		return m_capacity;
+	}
+	void reserve(size_type n)
+	{
+		AGL_ALLOCATION_SITE();
+
+		if (n <= capacity())
+			return;
+		realloc(n);
+	}
+	// Moves the elements back inline when they fit.
+	void shrink_to_fit()
+	{
+		AGL_ALLOCATION_SITE();
+
+		if (is_inline() || capacity() == size())
+			return;
+
+		realloc(std::max(size(), N));
+	}
+	// Releases the allocated memory as well.
+	void clear()
+	{
+		destruct_from(0);
+		if (is_inline())
+			return;
+
+		m_allocator.deallocate(m_storage.heap, capacity());
+		m_capacity = N;
+	}
+	iterator insert(const_iterator pos, const_reference value)
+	{
+		AGL_ALLOCATION_SITE();
+		return emplace(pos, value);
+	}
+	iterator insert(const_iterator pos, value_type&& value)
+	{
+		AGL_ALLOCATION_SITE();
+		return emplace(pos, std::move(value));
+	}
+	// The range may not come from the container itself.
+	template <typename TInputIt, typename TEnable = impl::is_iterator<TInputIt>>
+	iterator insert(const_iterator pos, TInputIt first, TInputIt last)
+	{
+		AGL_ALLOCATION_SITE();
+
+		AGL_ASSERT(cbegin() <= pos && pos <= cend(), "Index out of bounds");
+
+		auto const index = static_cast<size_type>(pos - cbegin());
+		auto const count = static_cast<size_type>(last - first);
+		if (size() + count > capacity())
+			realloc(grow_capacity(size() + count));
+
+		open_gap(index, count);
+		construct_range(index, first, count);
+		m_size += count;
+		return make_iterator<iterator>(data() + index);
+	}
+	template <typename... TArgs>
+	iterator emplace(const_iterator pos, TArgs&&... args)
+	{
+		AGL_ALLOCATION_SITE();
+
+		AGL_ASSERT(cbegin() <= pos && pos <= cend(), "Index out of bounds");
+
+		auto const index = static_cast<size_type>(pos - cbegin());
+		if (index == size())
+			return emplace_back(std::forward<TArgs>(args)...);
+
+		// the arguments may refer to elements that are about to move
+		auto value = value_type(std::forward<TArgs>(args)...);
+		if (size() == capacity())
+			realloc(grow_capacity(size() + 1));
+
+		open_gap(index, 1);
+		construct(data() + index, std::move(value));
+		++m_size;
+		return make_iterator<iterator>(data() + index);
+	}
+	template <typename... TArgs>
+	iterator emplace_back(TArgs&&... args)
+	{
+		AGL_ALLOCATION_SITE();
+
+		if (size() == capacity())
+		{
+			// the arguments may refer to elements, construct the new one before moving them
+			auto const n = grow_capacity(size() + 1);
+			auto* buffer = m_allocator.allocate(n);
+			construct(buffer + size(), std::forward<TArgs>(args)...);
+			relocate_to(buffer, n);
+		}
+		else
+			construct(data() + size(), std::forward<TArgs>(args)...);
+
+		++m_size;
+		return make_iterator<iterator>(data() + size() - 1);
+	}
+	template <typename... TArgs>
+	iterator emplace_front(TArgs&&... args)
+	{
+		AGL_ALLOCATION_SITE();
+		return emplace(cbegin(), std::forward<TArgs>(args)...);
+	}
+	iterator erase(const_iterator pos)
+	{
+		AGL_ASSERT(cbegin() <= pos && pos < cend(), "Iterator out of bounds");
+
+		return erase(pos, pos + 1);
+	}
+	iterator erase(const_iterator first, const_iterator last)
+	{
+		AGL_ASSERT(cbegin() <= first && first <= last && last <= cend(), "Iterator out of bounds");
+
+		auto const index = static_cast<size_type>(first - cbegin());
+		auto const count = static_cast<size_type>(last - first);
+		for (auto i = index; i < index + count; ++i)
+			destruct(data() + i);
+
+		close_gap(index, count);
+		m_size -= count;
+		return make_iterator<iterator>(data() + index);
+	}
+	void push_back(value_type&& value)
+	{
+		AGL_ALLOCATION_SITE();
+		emplace_back(std::move(value));
+	}
+	void push_back(const_reference value)
+	{
+		AGL_ALLOCATION_SITE();
+		emplace_back(value);
+	}
+	void push_front(value_type&& value)
+	{
+		AGL_ALLOCATION_SITE();
+		insert(cbegin(), std::move(value));
+	}
+	void push_front(const_reference value)
+	{
+		AGL_ALLOCATION_SITE();
+		insert(cbegin(), value);
+	}
+	void pop_back()
+	{
+		AGL_ASSERT(!empty(), "Index out of bounds");
+
+		destruct(data() + m_size - 1);
+		--m_size;
+	}
+	void pop_front()
+	{
+		erase(cbegin());
+	}
+
+private:
+	template <typename TIterator>
+	TIterator make_iterator(const_pointer ptr) const
+	{
+		// the iterators hold mutable pointers, constness comes from their traits
+		auto* memory = const_cast<pointer>(data());
+		return TIterator{ const_cast<pointer>(ptr), memory, memory + size() };
+	}
+	size_type grow_capacity(size_type n) const
+	{
+		return std::max(n, capacity() * 2);
+	}
+	// The allocators only construct in memory they handed out, which the inline storage is not.
+	template <typename... TArgs>
+	void construct(pointer ptr, TArgs&&... args)
+	{
+		new (ptr) value_type(std::forward<TArgs>(args)...);
+	}
+	void destruct(pointer ptr)
+	{
+		ptr->~value_type();
+	}
+	// Steals the allocation of 'other', or moves its inline elements. Expects this container to be empty and inline.
+	void take(small_vector& other)
+	{
+		if (!other.is_inline())
+		{
+			m_storage.heap = other.m_storage.heap;
+			m_capacity = other.m_capacity;
+			m_size = other.m_size;
+			other.m_capacity = N;
+			other.m_size = 0;
+			return;
+		}
+
+		for (auto i = size_type{ 0 }; i < other.size(); ++i)
+			relocate(data() + i, other.data() + i);
+
+		m_size = other.m_size;
+		other.m_size = 0;
+	}
+	// Copies 'count' elements from 'first' to the uninitialized slots from 'index' on.
+	template <typename TInputIt>
+	void construct_range(size_type index, TInputIt first, size_type count)
+	{
+		if constexpr (std::is_trivially_copyable_v<value_type> && std::is_same_v<TInputIt, const_pointer>)
+		{
+			if (count > 0)
+				std::memcpy(data() + index, first, count * sizeof(value_type));
+		}
+		else if constexpr (std::is_trivially_copyable_v<value_type> && std::is_same_v<TInputIt, pointer>)
+			construct_range(index, const_pointer{ first }, count);
+		else
+		{
+			for (auto i = size_type{ 0 }; i < count; ++i, ++first)
+				construct(data() + index + i, *first);
+		}
+	}
+	// Copies 'value' to the uninitialized slots ['index', 'index' + 'count').
+	void fill(size_type index, size_type count, const_reference value)
+	{
+		if constexpr (std::is_trivially_copyable_v<value_type>)
+			std::fill_n(data() + index, count, value);
+		else
+		{
+			for (auto i = index; i < index + count; ++i)
+				construct(data() + i, value);
+		}
+	}
+	// Destructs the elements from 'index' on.
+	void destruct_from(size_type index)
+	{
+		if constexpr (!std::is_trivially_destructible_v<value_type>)
+		{
+			for (auto i = index; i < size(); ++i)
+				destruct(data() + i);
+		}
+		m_size = std::min(m_size, index);
+	}
+	void relocate(pointer dest, pointer src)
+	{
+		if constexpr (is_trivially_relocatable_v<value_type>)
+			std::memcpy(static_cast<void*>(dest), src, sizeof(value_type));
+		else
+		{
+			construct(dest, std::move(*src));
+			destruct(src);
+		}
+	}
+	// Moves the elements from 'index' on 'count' slots to the right, leaving uninitialized slots behind. The capacity must suffice.
+	void open_gap(size_type index, size_type count)
+	{
+		AGL_ASSERT(size() + count <= capacity(), "Index out of bounds");
+
+		if (count == 0 || index == size())
+			return;
+
+		auto* memory = data();
+		if constexpr (is_trivially_relocatable_v<value_type>)
+			std::memmove(static_cast<void*>(memory + index + count), memory + index, (size() - index) * sizeof(value_type));
+		else
+		{
+			for (auto i = size(); i > index; --i)
+				relocate(memory + i - 1 + count, memory + i - 1);
+		}
+	}
+	// Moves the elements after the destructed slots ['index', 'index' + 'count') to the left, over them.
+	void close_gap(size_type index, size_type count)
+	{
+		if (count == 0 || index + count == size())
+			return;
+
+		auto* memory = data();
+		if constexpr (is_trivially_relocatable_v<value_type>)
+			std::memmove(static_cast<void*>(memory + index), memory + index + count, (size() - index - count) * sizeof(value_type));
+		else
+		{
+			for (auto i = index + count; i < size(); ++i)
+				relocate(memory + i - count, memory + i);
+		}
+	}
+	// 'n' of 'N' moves the elements back inline.
+	void realloc(size_type n)
+	{
+		AGL_ASSERT(n >= size(), "Index out of bounds");
+
+		relocate_to(n == N ? nullptr : m_allocator.allocate(n), n);
+	}
+	// Moves the elements to 'buffer', which holds 'n' elements, or inline when 'buffer' is nullptr, and releases the current memory.
+	void relocate_to(pointer buffer, size_type n)
+	{
+		if (buffer == nullptr)
+		{
+			// the inline storage overlaps the heap pointer, keep it aside
+			auto* heap = m_storage.heap;
+			auto const heap_capacity = m_capacity;
+			for (auto i = size_type{ 0 }; i < size(); ++i)
+				relocate(reinterpret_cast<pointer>(m_storage.local) + i, heap + i);
+
+			m_allocator.deallocate(heap, heap_capacity);
+			m_capacity = N;
+			return;
+		}
+
+		auto* memory = data();
+		for (auto i = size_type{ 0 }; i < size(); ++i)
+			relocate(buffer + i, memory + i);
+
+		if (!is_inline())
+			m_allocator.deallocate(m_storage.heap, capacity());
+
+		m_storage.heap = buffer;
+		m_capacity = n;
+	}
+
+private:
+	union storage
+	{
+		pointer heap;
+		alignas(T) std::byte local[N * sizeof(T)];
+	};
+
+private:
+	allocator_type m_allocator;
+	size_type m_capacity; // 'N' while the elements are inline
+	size_type m_size;
+	storage m_storage;
+};
+
+// The buffer in use is found from the capacity, nothing points into the object.
+template <typename T, std::uint64_t N, typename TAlloc>
+struct is_trivially_relocatable<small_vector<T, N, TAlloc>>
+	: std::bool_constant<is_trivially_relocatable_v<T> && is_trivially_relocatable_v<typename TAlloc::template rebind<T>>>
+{
+};
+}
@@ -169,9 +169,16 @@ private:
 	pointer m_data;
 };
 
+template <typename T, typename TAlloc>
+struct is_trivially_relocatable<unique_ptr<T, TAlloc>>
+	: is_trivially_relocatable<typename TAlloc::template rebind<T>>
+{
+};
+
 template <typename T>
 unique_ptr<T> make_unique()
 {
+	AGL_ALLOCATION_SITE();
 	static_assert(!std::is_reference_v<T>, "invalid type");
 	
 	using type = std::remove_const_t<T>;
@@ -184,6 +191,7 @@ unique_ptr<T> make_unique()
 template <typename T, typename U>
 unique_ptr<T> make_unique(U&& value)
 {
+	AGL_ALLOCATION_SITE();
 	using type = std::remove_cv_t<std::remove_reference_t<U>>;
 	auto allocator = mem::allocator<type>{};
 	auto* ptr = allocator.allocate();
@@ -0,0 +1,184 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "agl/core/debug.hpp"
+
+namespace agl
+{
+enum overflow_policy : std::uint64_t
+{
+	BLOCK_WHEN_FULL, // producers wait for the consumer to free a slot
+	DROP_NEWEST, // the element being pushed is dropped
+	DROP_OLDEST, // the oldest element is dropped to make room
+};
+
+/**
+ * @brief
+ * Bounded ring of preallocated slots, filled by any number of producers and drained by one consumer without taking a lock.
+ * Every slot carries a sequence number telling whether it is free for the producer of a given lap or ready for the consumer, so producers only contend on one counter and never on the consumer.
+ * Elements are written and read in place through callbacks, slots are reused as they are, e.g. strings keep their capacity.
+ * Drops are counted whatever the policy, 'DROP_OLDEST' evicts the element in the slot the producer needs if the consumer has not claimed it yet, otherwise the producer yields until the consumer is done with it.
+ * @tparam T
+ */
+template <typename T>
+class mpsc_ring
+{
+public:
+	// 'capacity' is rounded up to a power of two.
+	mpsc_ring(std::uint64_t capacity, overflow_policy policy = BLOCK_WHEN_FULL)
+		: m_dropped{ 0 }
+		, m_head{ 0 }
+		, m_mask{ 0 }
+		, m_policy{ policy }
+		, m_slots{ nullptr }
+		, m_tail{ 0 }
+	{
+		AGL_ASSERT(capacity > 0, "invalid capacity");
+
+		auto size = std::uint64_t{ 1 };
+		while (size < capacity)
+			size *= 2;
+
+		m_mask = size - 1;
+		m_slots = std::make_unique<slot[]>(size);
+		for (auto i = std::uint64_t{ 0 }; i < size; ++i)
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	// Not thread-safe, neither ring may be in use.
+	mpsc_ring(mpsc_ring&& other)
+		: m_dropped{ other.m_dropped.load(std::memory_order_relaxed) }
+		, m_head{ other.m_head.load(std::memory_order_relaxed) }
+		, m_mask{ other.m_mask }
+		, m_policy{ other.m_policy }
+		, m_slots{ std::move(other.m_slots) }
+		, m_tail{ other.m_tail.load(std::memory_order_relaxed) }
+	{
+		other.m_head.store(0, std::memory_order_relaxed);
+		other.m_mask = 0;
+		other.m_tail.store(0, std::memory_order_relaxed);
+	}
+	mpsc_ring(mpsc_ring const&) = delete;
+	mpsc_ring& operator=(mpsc_ring const&) = delete;
+
+	std::uint64_t capacity() const
+	{
+		return m_slots != nullptr ? m_mask + 1 : 0;
+	}
+	// Number of elements dropped on overflow so far.
+	std::uint64_t dropped() const
+	{
+		return m_dropped.load(std::memory_order_relaxed);
+	}
+	// Exact only when no producer is running.
+	bool empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+	overflow_policy get_policy() const
+	{
+		return m_policy;
+	}
+	// Consumer only. Calls 'fun' with the oldest element, returns false if the ring is empty. The slot stays taken until 'fun' returns, producers needing it wait meanwhile.
+	template <typename TFun>
+	bool pop(TFun&& fun)
+	{
+		auto position = m_head.load(std::memory_order_relaxed);
+		auto* target = static_cast<slot*>(nullptr);
+		while (true)
+		{
+			target = &m_slots[position & m_mask];
+			auto const sequence = target->sequence.load(std::memory_order_acquire);
+			auto const distance = static_cast<std::int64_t>(sequence - (position + 1));
+			if (distance < 0)
+				return false;
+
+			if (distance == 0 && m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+
+			if (distance > 0)
+				position = m_head.load(std::memory_order_relaxed);
+		}
+
+		fun(target->value);
+		// free for the producers of the next lap
+		target->sequence.store(position + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+	// Calls 'fun' with a free slot to write the element into. Returns false if the element was dropped.
+	template <typename TFun>
+	bool push(TFun&& fun)
+	{
+		auto position = m_tail.load(std::memory_order_relaxed);
+		auto* target = static_cast<slot*>(nullptr);
+		while (true)
+		{
+			target = &m_slots[position & m_mask];
+			auto const sequence = target->sequence.load(std::memory_order_acquire);
+			auto const distance = static_cast<std::int64_t>(sequence - position);
+			if (distance == 0)
+			{
+				if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+				continue;
+			}
+
+			if (distance < 0 && !make_room(*target, position))
+				return false;
+
+			position = m_tail.load(std::memory_order_relaxed);
+		}
+
+		fun(target->value);
+		// ready for the consumer
+		target->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct slot
+	{
+		std::atomic<std::uint64_t> sequence;
+		T value;
+	};
+
+private:
+	// Called by a producer finding 'target' still taken for 'position', returns false if the element must be dropped.
+	bool make_room(slot& target, std::uint64_t position)
+	{
+		switch (m_policy)
+		{
+		case BLOCK_WHEN_FULL:
+			std::this_thread::yield();
+			return true;
+		case DROP_NEWEST:
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		case DROP_OLDEST:
+		{
+			// only the element of the previous lap in 'target' is evicted, and only while the consumer has not claimed it
+			// once claimed the consumer may still be reading it, newer elements are kept and the producer waits for the slot
+			auto oldest = position - (m_mask + 1);
+			if (target.sequence.load(std::memory_order_acquire) == oldest + 1 && m_head.compare_exchange_strong(oldest, oldest + 1, std::memory_order_relaxed))
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				target.sequence.store(position, std::memory_order_release);
+			}
+			else
+				std::this_thread::yield();
+			return true;
+		}
+		}
+		return false;
+	}
+
+private:
+	std::atomic<std::uint64_t> m_dropped;
+	alignas(64) std::atomic<std::uint64_t> m_head; // next element to pop, kept apart from 'm_tail' so the consumer does not share its cache line with producers
+	std::uint64_t m_mask;
+	overflow_policy m_policy;
+	std::unique_ptr<slot[]> m_slots;
+	alignas(64) std::atomic<std::uint64_t> m_tail; // next slot to push
+};
+}
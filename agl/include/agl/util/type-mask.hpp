@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include "agl/memory/small-vector.hpp"
+#include "agl/util/typeid.hpp"
+
+namespace agl
+{
+/**
+ * @brief
+ * Set of 'type_index' values of one family, one bit per index. Testing a type is a single indexed load, whatever the number of types in the set.
+ * Grows with the largest index set, the first 128 indices need no allocation.
+ */
+class type_mask
+{
+public:
+	using allocator_type = mem::small_vector<std::uint64_t, 2>::allocator_type;
+
+	template <typename TFamily, typename... TArgs>
+	static type_mask make(allocator_type const& allocator = {});
+
+public:
+	type_mask(allocator_type const& allocator = {});
+
+	void clear();
+	// Whether every index of 'other' is set.
+	bool contains(type_mask const& other) const;
+	bool empty() const;
+	void reset(std::uint32_t index);
+	void set(std::uint32_t index);
+	bool test(std::uint32_t index) const;
+	template <typename TFamily, typename... TArgs>
+	bool test_all() const;
+
+	bool operator==(type_mask const& other) const;
+	bool operator!=(type_mask const& other) const;
+
+private:
+	static constexpr std::uint32_t word_bits()
+	{
+		return 64;
+	}
+
+private:
+	mem::small_vector<std::uint64_t, 2> m_words;
+};
+
+template <typename TFamily, typename... TArgs>
+type_mask type_mask::make(allocator_type const& allocator)
+{
+	auto result = type_mask{ allocator };
+	(result.set(type_index<TArgs, TFamily>::get()), ...);
+	return result;
+}
+template <typename TFamily, typename... TArgs>
+bool type_mask::test_all() const
+{
+	return (... && test(type_index<TArgs, TFamily>::get()));
+}
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 #include <type_traits>
+#include <utility>
 
 namespace agl
 {
@@ -10,4 +11,25 @@ struct remove_cvref
 };
 template <typename T>
 using remove_cvref_t = typename remove_cvref<T>::type;
+
+/**
+ * @brief
+ * Whether moving an object to a new address and dropping the old one is the same as copying its bytes.
+ * Holds for trivially copyable types. Other types opt in by specializing it, e.g. types owning their resources through a pointer.
+ * Containers move such elements with 'std::memmove' and do not destruct the moved-from slots.
+ * @tparam T
+ */
+template <typename T>
+struct is_trivially_relocatable
+	: std::bool_constant<std::is_trivially_copyable_v<T>>
+{
+};
+template <typename T>
+constexpr auto is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+
+template <typename T, typename U>
+struct is_trivially_relocatable<std::pair<T, U>>
+	: std::bool_constant<is_trivially_relocatable_v<T> && is_trivially_relocatable_v<U>>
+{
+};
 }
\ No newline at end of file
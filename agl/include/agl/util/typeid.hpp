@@ -1,7 +1,9 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <string_view>
 #include "agl/core/debug.hpp"
+#include "agl/util/type-traits.hpp"
 
 namespace agl
 {
@@ -79,6 +81,12 @@ private:
 	std::string_view m_name;
 };
 
+template <>
+struct is_trivially_relocatable<type_id_t>
+	: std::true_type
+{
+};
+
 namespace impl {
 template <typename T>
 class type_id
@@ -131,6 +139,60 @@ public:
 	}
 };
 
+namespace impl {
+template <typename TFamily>
+class type_index_counter
+{
+public:
+	static std::uint32_t count()
+	{
+		return m_count.load(std::memory_order_relaxed);
+	}
+	static std::uint32_t next()
+	{
+		return m_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	static inline std::atomic<std::uint32_t> m_count{ 0 };
+};
+
+template <typename T, typename TFamily>
+class type_index
+{
+public:
+	static std::uint32_t get()
+	{
+		// initialization of function statics is thread-safe, later calls only check the guard
+		static auto const index = type_index_counter<TFamily>::next();
+		return index;
+	}
+};
+}
+/**
+ * @brief
+ * Dense counterpart of 'type_id'. Types of one 'TFamily' are numbered 0..N-1 in the order they are first queried, so the index can address flat arrays directly. Uses 'remove_cvref' on types.
+ * Not a compile time constant and not stable across runs, only use it in memory.
+ * @tparam T
+ * @tparam TFamily tag type, every family is numbered separately
+ */
+template <typename T, typename TFamily = void>
+class type_index
+{
+public:
+	using type = std::remove_reference_t<std::remove_const_t<T>>;
+
+	static std::uint32_t get()
+	{
+		return impl::type_index<type, TFamily>::get();
+	}
+	// Number of indices given out so far in 'TFamily'.
+	static std::uint32_t count()
+	{
+		return impl::type_index_counter<TFamily>::count();
+	}
+};
+
 }
 namespace std
 {
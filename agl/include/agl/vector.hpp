@@ -1,8 +1,12 @@
 #pragma once
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <initializer_list>
 #include <type_traits>
 #include "agl/core/debug.hpp"
 #include "agl/util/iterator.hpp"
+#include "agl/util/type-traits.hpp"
 #include "agl/memory/allocator.hpp"
 
 namespace agl
@@ -39,7 +43,7 @@ struct const_iterator_traits
 
 /**
  * @brief 
- * Shares properties with 'std::vector'.
+ * Shares properties with 'std::vector'. Only the first 'size()' slots hold objects, the rest of the capacity is left uninitialized.
  * @tparam T 
  * @tparam TAlloc 
  */
@@ -77,11 +81,15 @@ public:
 	}
 	template <typename TInputIt, typename TEnable = impl::is_iterator<TInputIt>>
 	vector(TInputIt first, TInputIt last)
+		: vector{}
 	{
+		AGL_ALLOCATION_SITE();
 		assign(first, last);
 	}
 	vector(std::initializer_list<T> list)
+		: vector{}
 	{
+		AGL_ALLOCATION_SITE();
 		assign(list.begin(), list.end());
 	}
 	vector(vector&& other)
@@ -97,12 +105,13 @@ public:
 	vector(vector const& other)
 		: vector{ other.m_allocator }
 	{
+		AGL_ALLOCATION_SITE();
+
 		if (other.m_memory == nullptr)
 			return;
 
 		reserve(other.size());
-		for (auto const& v : other)
-			push_back(v);
+		construct_copies(other.m_memory, other.size());
 	}
 	vector& operator=(vector&& other)
 	{
@@ -122,16 +131,16 @@ public:
 	}
 	vector& operator=(vector const& other)
 	{
+		AGL_ALLOCATION_SITE();
+
 		if (this == &other)
 			return *this;
 
 		clear();
 		m_allocator = other.m_allocator;
 
-		reserve(other.m_capacity);
-		for (auto const& v : other)
-			this->push_back(v);
-
+		reserve(other.size());
+		construct_copies(other.m_memory, other.size());
 		return *this;
 	}
 	~vector()
@@ -145,7 +154,7 @@ public:
 
 		return *(m_memory + index);
 	}
-	const_reference at() const
+	const_reference at(size_type index) const
 	{
 		AGL_ASSERT(index < size(), "Index out of bounds");
 		AGL_ASSERT(m_memory != nullptr, "Index out of bounds");
@@ -154,27 +163,31 @@ public:
 	}
 	void assign(size_type count, const_reference value)
 	{
-		if (count != size())
+		AGL_ALLOCATION_SITE();
+
+		// 'value' may be one of the elements about to be destructed
+		if (m_memory <= &value && &value < m_memory + size())
 		{
-			clear();
-			resize(count);
+			auto const copy = value_type(value);
+			assign(count, copy);
+			return;
 		}
-		
-		for (auto i = 0; i < count; ++i)
-			make_copy(m_memory + i, value);
+
+		destruct_from(0);
+		reserve(count);
+		fill(0, count, value);
+		m_size = count;
 	}
 	template <typename TInputIt, typename TEnable = impl::is_iterator_t<TInputIt>>
 	void assign(TInputIt first, TInputIt last)
 	{
-		auto const count = last - first;
-		if (count != size())
-		{
-			clear();
-			resize(count);
-		}
+		AGL_ALLOCATION_SITE();
 
-		for (auto i = 0; i < count; ++i, ++first)
-			make_copy(m_memory + i, *first);
+		auto const count = static_cast<size_type>(last - first);
+		destruct_from(0);
+		reserve(count);
+		construct_range(0, first, count);
+		m_size = count;
 	}
 	iterator begin()
 	{
@@ -274,7 +287,7 @@ public:
 	}
 	const_pointer data() const
 	{
-		return m_memory
+		return m_memory;
 	}
 	bool empty() const
 	{
@@ -288,10 +301,26 @@ public:
 	{
 		return m_size;
 	}
+	// New elements are value-initialized.
 	void resize(size_type n)
 	{
+		AGL_ALLOCATION_SITE();
+
 		if (n > capacity())
-			reserve(n);
+			realloc(grow_capacity(n));
+
+		if constexpr (std::is_trivially_copyable_v<value_type> && std::is_default_constructible_v<value_type>)
+		{
+			if (n > size())
+				fill(size(), n - size(), value_type{});
+		}
+		else
+		{
+			for (auto i = size(); i < n; ++i)
+				m_allocator.construct(m_memory + i);
+		}
+
+		destruct_from(n);
 		m_size = n;
 	}
 	size_type capacity() const
@@ -300,170 +329,147 @@ public:
 	}
 	void shrink_to_fit()
 	{
+		AGL_ALLOCATION_SITE();
+
 		if (capacity() == size())
 			return;
-		realloc(size());
+
+		if (empty())
+			clear();
+		else
+			realloc(size());
 	}
+	// Releases the memory as well.
 	void clear()
 	{
 		if (m_memory == nullptr)
 			return;
 
-		for (auto i = difference_type{ 0 }; i < static_cast<difference_type>(capacity()); ++i)
-			m_allocator.destruct(m_memory + i);
+		destruct_from(0);
 		m_allocator.deallocate(m_memory, capacity());
 		m_memory = nullptr;
-		m_size = 0;
 		m_capacity = 0;
 	}
 	iterator insert(const_iterator pos, const_reference value)
 	{
-		AGL_ASSERT(cbegin() <= pos && pos <= cend(), "Index out of bounds");
-
-		if (pos == cend() || empty())
-		{
-			push_back(value);
-			return make_iterator<iterator>(m_memory + m_size - 1);
-		}
-		auto const index = pos - begin();
-		reserve(size() + 1);
-		move_elements_right(begin() + index + 1, begin() + index);
-		make_copy(m_memory + index, value);
-		++m_size;
-		return make_iterator<iterator>(m_memory + index);
+		AGL_ALLOCATION_SITE();
+		return emplace(pos, value);
 	}
 	iterator insert(const_iterator pos, value_type&& value)
 	{
-		AGL_ASSERT(cbegin() <= pos && pos <= cend(), "Index out of bounds");
-
-		if (pos == cend() || empty())
-		{
-			push_back(std::move(value));
-			return make_iterator<iterator>(m_memory + m_size - 1);
-		}
-		auto const index = pos - begin();
-		reserve(size() + 1);
-		auto it = make_internal_iterator<iterator>(m_memory + index + 1);
-		move_elements_right(it, it - 1);
-		make_move(m_memory + index, std::forward<value_type&&>(value));
-		++m_size;
-		return make_iterator<iterator>(m_memory + index);
+		AGL_ALLOCATION_SITE();
+		return emplace(pos, std::move(value));
 	}
+	// The range may not come from the vector itself.
 	template <typename TInputIt, typename TEnable = impl::is_iterator<TInputIt>>
 	iterator insert(const_iterator pos, TInputIt first, TInputIt last)
 	{
+		AGL_ALLOCATION_SITE();
+
 		AGL_ASSERT(cbegin() <= pos && pos <= cend(), "Index out of bounds");
-		AGL_ASSERT(cbegin() <= first && first <= cend(), "Index out of bounds");
-		AGL_ASSERT(cbegin() <= last && last <= cend(), "Index out of bounds");
 
-		auto const index = pos - begin();
-		auto const insert_size = std::distance(last - first);
-		if (pos == cend() || empty())
-		{
-			reserve(size() + insert_size);
-			for (auto it = first; it != last; ++it)
-				push_back(*it);
-			return make_iterator<iterator>(m_memory + index);
-		}
-		reserve(size() + insert_size);
-		move_elements_right(begin() + index + insert_size, begin() + index);
-		
-		for (auto i = difference_type{ 0 }; i < insert_size; ++i, ++first)
-			make_move_or_copy(m_memory + index + i, std::forward<value_type&&>(*first));
+		auto const index = static_cast<size_type>(pos - cbegin());
+		auto const count = static_cast<size_type>(last - first);
+		if (size() + count > capacity())
+			realloc(grow_capacity(size() + count));
+
+		open_gap(index, count);
+		construct_range(index, first, count);
 
-		m_size += insert_size;
+		m_size += count;
 		return make_iterator<iterator>(m_memory + index);
 	}
 	template <typename... TArgs>
 	iterator emplace(const_iterator pos, TArgs&&... args)
 	{
+		AGL_ALLOCATION_SITE();
+
 		AGL_ASSERT(cbegin() <= pos && pos <= cend(), "Index out of bounds");
 
-		if (pos == cend() || empty())
-		{
-			emplace_back(std::forward<TArgs>(args)...);
-			return make_iterator<iterator>(m_memory + m_size - 1);
-		}
-		auto const index = pos - begin();
-		reserve(size() + 1);
-		move_elements_right(begin() + index + 1, begin() + index);
-		m_allocator.destruct(m_memory + index);
-		m_allocator.construct(m_memory + index, std::forward<TArgs>(args)...);
+		auto const index = static_cast<size_type>(pos - cbegin());
+		if (index == size())
+			return emplace_back(std::forward<TArgs>(args)...);
+
+		// the arguments may refer to elements that are about to move
+		auto value = value_type(std::forward<TArgs>(args)...);
+		if (size() == capacity())
+			realloc(grow_capacity(size() + 1));
+
+		open_gap(index, 1);
+		m_allocator.construct(m_memory + index, std::move(value));
 		++m_size;
 		return make_iterator<iterator>(m_memory + index);
 	}
 	template <typename... TArgs>
 	iterator emplace_back(TArgs&&... args)
 	{
-		resize(size() + 1);
-		m_allocator.destruct(m_memory + size() - 1);
-		m_allocator.construct(m_memory + size() - 1, std::forward<TArgs>(args)...);
+		AGL_ALLOCATION_SITE();
+
+		if (size() == capacity())
+		{
+			// the arguments may refer to elements, construct the new one before moving them
+			auto const n = grow_capacity(size() + 1);
+			auto* buffer = m_allocator.allocate(n);
+			m_allocator.construct(buffer + size(), std::forward<TArgs>(args)...);
+			relocate_to(buffer, n);
+		}
+		else
+			m_allocator.construct(m_memory + size(), std::forward<TArgs>(args)...);
+
+		++m_size;
 		return make_iterator<iterator>(m_memory + size() - 1);
 	}
 	template <typename... TArgs>
 	iterator emplace_front(TArgs&&... args)
 	{
+		AGL_ALLOCATION_SITE();
 		return emplace(cbegin(), std::forward<TArgs>(args)...);
 	}
 	iterator erase(const_iterator pos)
 	{
 		AGL_ASSERT(cbegin() <= pos && pos < cend(), "Iterator out of bounds");
 
-		if (size() == 1)
-		{
-			clear();
-			return end();
-		}
-
-		m_allocator.destruct(pos.m_ptr);
-		m_allocator.construct(pos.m_ptr);
-		auto it = make_iterator<iterator>(pos.m_ptr);
-		move_elements_left(it, it + 1);
-		--m_size;
-		return it;
+		return erase(pos, pos + 1);
 	}
 	iterator erase(const_iterator first, const_iterator last)
 	{
-		AGL_ASSERT(cbegin() <= first && first < cend(), "Iterator out of bounds");
-		AGL_ASSERT(cbegin() <= last && last < cend(), "Iterator out of bounds");
-
-		if (first == begin() && last == cend())
-		{
-			clear();
-			return end();
-		}
+		AGL_ASSERT(cbegin() <= first && first <= last && last <= cend(), "Iterator out of bounds");
 
-		for (first; first != last; ++first)
-		{
-			m_allocator.destruct(&(*first));
-			m_allocator.construct(&(*first));
-		}
+		auto const index = static_cast<size_type>(first - cbegin());
+		auto const count = static_cast<size_type>(last - first);
+		for (auto i = index; i < index + count; ++i)
+			m_allocator.destruct(m_memory + i);
 
-		move_elements_left(&(*first), &(*last))
-			m_size -= erase_size;
-		return make_iterator<iterator>(m_memory + offset);
+		close_gap(index, count);
+		m_size -= count;
+		return make_iterator<iterator>(m_memory + index);
 	}
 	void push_back(value_type&& value)
 	{
- 		resize(size() + 1);
-		make_move(m_memory + size() - 1, std::forward<value_type&&>(value));
+		AGL_ALLOCATION_SITE();
+		emplace_back(std::move(value));
 	}
 	void push_back(const_reference value)
 	{
-		resize(size() + 1);
-		make_copy(m_memory + size() - 1, value);
+		AGL_ALLOCATION_SITE();
+		emplace_back(value);
 	}
 	void push_front(value_type&& value)
 	{
+		AGL_ALLOCATION_SITE();
 		insert(cbegin(), std::move(value));
 	}
 	void push_front(const_reference value)
 	{
+		AGL_ALLOCATION_SITE();
 		insert(cbegin(), value);
 	}
 	void pop_back()
 	{
-		erase(cend() - 1);
+		AGL_ASSERT(!empty(), "Index out of bounds");
+
+		m_allocator.destruct(m_memory + m_size - 1);
+		--m_size;
 	}
 	void pop_front()
 	{
@@ -471,6 +477,8 @@ public:
 	}
 	void reserve(size_type n)
 	{
+		AGL_ALLOCATION_SITE();
+
 		if (n <= capacity())
 			return;
 		realloc(n);
@@ -481,91 +489,114 @@ private:
 	{
 		return TIterator{ ptr, m_memory, m_memory + size() };
 	}
-	template <typename TIterator>
-	TIterator make_internal_iterator(T* ptr) const // returns iterator checked up to capacity()
+	// Capacity grows geometrically, so that adding 'n' elements one by one costs O(n) moves.
+	size_type grow_capacity(size_type n) const
 	{
-		return TIterator{ ptr, m_memory, m_memory + capacity() };
+		return std::max(n, capacity() * 2);
 	}
-	iterator real_end() const
+	// Copies 'count' elements after the last one, the capacity must suffice.
+	void construct_copies(const_pointer src, size_type count)
 	{
-		return iterator{ m_memory + capacity(), m_memory, m_memory + capacity() };
+		AGL_ASSERT(size() + count <= capacity(), "Index out of bounds");
+
+		construct_range(size(), src, count);
+		m_size += count;
 	}
-	void make_copy(pointer dest, const_reference src)
+	// Copies 'count' elements from 'first' to the uninitialized slots from 'index' on.
+	template <typename TInputIt>
+	void construct_range(size_type index, TInputIt first, size_type count)
 	{
-		AGL_ASSERT(m_memory <= dest && dest < m_memory + capacity(), "iterator out of range");
-		
-		if constexpr (std::is_copy_constructible_v<value_type>)
-			m_allocator.construct(dest, src);
-		else if constexpr (std::is_copy_assignable_v<value_type>)
-			*dest = src;
+		if constexpr (std::is_trivially_copyable_v<value_type> && std::is_same_v<TInputIt, const_pointer>)
+		{
+			if (count > 0)
+				std::memcpy(m_memory + index, first, count * sizeof(value_type));
+		}
+		else if constexpr (std::is_trivially_copyable_v<value_type> && std::is_same_v<TInputIt, pointer>)
+			construct_range(index, const_pointer{ first }, count);
 		else
-			static_assert(false, "invalid use of copy function - type is not copyable");
+		{
+			for (auto i = size_type{ 0 }; i < count; ++i, ++first)
+				m_allocator.construct(m_memory + index + i, *first);
+		}
 	}
-	void make_move(pointer dest, value_type&& src)
+	// Copies 'value' to the uninitialized slots ['index', 'index' + 'count').
+	void fill(size_type index, size_type count, const_reference value)
 	{
-		AGL_ASSERT(m_memory <= dest && dest < m_memory + capacity(), "iterator out of range");
-
-		if constexpr (std::is_move_constructible_v<value_type>)
-			m_allocator.construct(dest, std::forward<value_type&&>(src));
-		else if constexpr (std::is_move_assignable_v<value_type>)
-			*dest = std::move(src);
+		if constexpr (std::is_trivially_copyable_v<value_type>)
+			std::fill_n(m_memory + index, count, value); // lowered to 'memset' or vectorized stores
 		else
-			static_assert(false, "invalid use of copy function - type is not movalbe");
+		{
+			for (auto i = index; i < index + count; ++i)
+				m_allocator.construct(m_memory + i, value);
+		}
 	}
-	void make_move_or_copy(pointer dest, value_type&& src)
+	// Destructs the elements from 'index' on, the size is left to the caller.
+	void destruct_from(size_type index)
 	{
-		make_move(dest, std::forward<value_type&&>(src));
+		if constexpr (!std::is_trivially_destructible_v<value_type>)
+		{
+			for (auto i = index; i < size(); ++i)
+				m_allocator.destruct(m_memory + i);
+		}
+		m_size = std::min(m_size, index);
 	}
-	void make_move_or_copy(pointer dest, const_reference src)
+	void relocate(pointer dest, pointer src)
 	{
-		make_copy(dest, src);
+		m_allocator.construct(dest, std::move(*src));
+		m_allocator.destruct(src);
 	}
-	/// <summary>
-	/// Moves element 'from' and all the elements right to it to the position 'where'
-	/// </summary>
-	void move_elements_left(iterator where, iterator from)
+	// Moves the elements from 'index' on 'count' slots to the right, leaving uninitialized slots behind. The capacity must suffice.
+	void open_gap(size_type index, size_type count)
 	{
-		AGL_ASSERT(where <= from, "Invalid data");
-		AGL_ASSERT(begin() <= where && where < end(), "Index out of bounds");
-		AGL_ASSERT(begin() <= from && from <= end(), "Index out of bounds");
+		AGL_ASSERT(size() + count <= capacity(), "Index out of bounds");
 
-		for (where, from; from != end(); ++where, ++from)
-			make_move_or_copy(&(*where), std::move(*from));
+		if (count == 0 || index == size())
+			return;
+
+		if constexpr (is_trivially_relocatable_v<value_type>)
+			std::memmove(static_cast<void*>(m_memory + index + count), m_memory + index, (size() - index) * sizeof(value_type));
+		else
+		{
+			for (auto i = size(); i > index; --i)
+				relocate(m_memory + i - 1 + count, m_memory + i - 1);
+		}
 	}
-	void move_elements_right(iterator where, iterator from)
+	// Moves the elements after the destructed slots ['index', 'index' + 'count') to the left, over them.
+	void close_gap(size_type index, size_type count)
 	{
-		AGL_ASSERT(where > from, "Invalid data");
-		AGL_ASSERT(begin() < where && where < real_end(), "Index out of bounds");
-		AGL_ASSERT(begin() <= from && from < real_end(), "Index out of bounds");
-
-		auto const offset = where - from;
-		auto w = make_internal_iterator<reverse_iterator>(m_memory + size() + offset - 1);
-		auto f = make_iterator<reverse_iterator>(m_memory + size() - 1);
-		auto const end = make_iterator<reverse_iterator>(&(*from));
+		if (count == 0 || index + count == size())
+			return;
 
-		for (w, f; w != end; ++w, ++f)
-			make_move_or_copy(&(*w), std::move(*f));
+		if constexpr (is_trivially_relocatable_v<value_type>)
+			std::memmove(static_cast<void*>(m_memory + index), m_memory + index + count, (size() - index - count) * sizeof(value_type));
+		else
+		{
+			for (auto i = index + count; i < size(); ++i)
+				relocate(m_memory + i - count, m_memory + i);
+		}
 	}
 	void realloc(size_type n)
 	{
-		auto* tmp_buffer = m_allocator.allocate(n);
-
-		// move current content to new buffer
-		for (auto i = difference_type{ 0 }; i < static_cast<difference_type>(size()); ++i)
-			m_allocator.construct(tmp_buffer + i, std::move(*(m_memory + i)));
-
-		for (auto i = size(); i < n; ++i)
-			m_allocator.construct(tmp_buffer + i);
-
-		if (capacity() > 0)
+		relocate_to(m_allocator.allocate(n), n);
+	}
+	// Moves the elements to 'buffer', which holds 'n' elements, and releases the current memory. Slots past the size stay uninitialized.
+	void relocate_to(pointer buffer, size_type n)
+	{
+		if constexpr (is_trivially_relocatable_v<value_type>)
 		{
-			for (auto i = difference_type{ 0 }; i < static_cast<difference_type>(capacity()); ++i)
-				m_allocator.destruct(m_memory + i);
+			if (size() > 0)
+				std::memcpy(static_cast<void*>(buffer), m_memory, size() * sizeof(value_type));
+		}
+		else
+		{
+			for (auto i = size_type{ 0 }; i < size(); ++i)
+				relocate(buffer + i, m_memory + i);
+		}
 
+		if (m_memory != nullptr)
 			m_allocator.deallocate(m_memory, capacity());
-		}
 
-		m_memory = tmp_buffer;
+		m_memory = buffer;
 		m_capacity = n;
 	}
 private:
@@ -575,6 +606,13 @@ private:
 	size_type m_size;
 };
 
+// Owns its elements through a pointer.
+template <typename T, typename TAlloc>
+struct is_trivially_relocatable<vector<T, TAlloc>>
+	: is_trivially_relocatable<typename TAlloc::template rebind<T>>
+{
+};
+
 namespace impl
 {
 template <typename T>
@@ -1,21 +1,49 @@
 #include "agl/render/opengl/renderer.hpp"
 #include "agl/core/events.hpp"
+#include "agl/core/jobs.hpp"
 #include "agl/core/threads.hpp"
 #include "agl/core/layer.hpp"
+#include "agl/memory/frame-arena.hpp"
 #include "agl/memory/pool.hpp"
 #include "agl/ecs/ecs.hpp"
+#include <algorithm>
 #include <filesystem>
+#include <thread>
 
 namespace agl
 {
+application::application()
+	: m_good{ false }
+	, m_mutex{ make_unique<std::recursive_mutex>() }
+	, m_properties{ false }
+{
+}
+application::application(application&& other)
+	: m_good{ other.m_good }
+	, m_mutex{ std::move(other.m_mutex) }
+	, m_properties{ other.m_properties }
+	, m_resources{ std::move(other.m_resources) }
+	, m_resources_order{ std::move(other.m_resources_order) }
+	, m_table{ other.m_table.exchange(nullptr) }
+	, m_retired{ std::move(other.m_retired) }
+	, m_retiring{ std::move(other.m_retiring) }
+{
+}
 application::~application()
 {
 	close();
+
+	delete m_table.exchange(nullptr);
 }
 
-resource_base::resource_base(type_id_t id)
+resource_base::resource_base(type_id_t id, std::uint32_t index)
 	: m_id{ id }
+	, m_index{ index }
+{
+}
+std::uint32_t resource_base::index() const
 {
+	return m_index;
 }
 type_id_t resource_base::type() const
 {
@@ -29,16 +57,21 @@ void application::close()
 		log.info("Closing...");
 	}
 	
-	std::lock_guard<std::mutex> lock{ *m_mutex };
+	std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
 
 	while (!m_resources.empty())
 	{
 		auto found = m_resources.find(m_resources_order[m_resources_order.size() - 1]);
 		found->second->on_detach(this);
 		
+		publish_resource(found->second->index(), nullptr);
 		m_resources.erase(found);
 		m_resources_order.pop_back();
 	}
+
+	// every thread reading resources belonged to a resource, nobody holds a replaced table anymore
+	reclaim_tables();
+	reclaim_tables();
 }
 application::properties const& application::get_properties() const
 {
@@ -52,41 +85,42 @@ void application::add_resource(unique_ptr<resource_base> resource)
 {
 	auto it = m_resources.end();
 	{
-		std::lock_guard<std::mutex> lock{ *m_mutex };
+		std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
 	
 		m_resources_order.push_back(resource->type());
+		publish_resource(resource->index(), resource.get());
 		it = m_resources.emplace({ resource->type(), std::move(resource) });
 	}
 	it->second->on_attach(this);
 }
 bool application::has_resource(type_id_t type)
 {
-	std::lock_guard<std::mutex> lock{ *m_mutex };
+	std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
 
 	auto found = m_resources.find(type);
 	return found != m_resources.end();
 }
 void application::remove_resource(type_id_t type)
 {
-	std::lock_guard<std::mutex> lock{ *m_mutex };
+	std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
 
 	auto found = m_resources.find(type);
 	
 	AGL_ASSERT(found!= m_resources.end(), "Index out of bounds");
 
 	found->second->on_detach(this);
+	publish_resource(found->second->index(), nullptr);
 	m_resources.erase(found);
+	m_resources_order.erase(std::find(m_resources_order.cbegin(), m_resources_order.cend(), type));
 }
 resource_base* application::get_resource(type_id_t type)
 {
-	std::lock_guard<std::mutex> lock{ *m_mutex };
+	std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
 
 	return m_resources.at(type).get();
 }
 void application::init()
 {
-	m_mutex = make_unique<std::mutex>();
-	
 	{ // threads
 		add_resource(make_unique<resource_base>(threads{}));
 	}
@@ -95,9 +129,15 @@ void application::init()
 		get_resource<logger>().info("Core: Initializing");
 		get_resource<logger>().info("Main thread: {}", std::this_thread::get_id());
 	}
+	{ // JOBS
+		add_resource(make_unique<resource_base>(jobs{}));
+	}
 	{ // MEMORY POOL
 		add_resource(make_unique<resource_base>(mem::pool{}));
 	}
+	{ // FRAME ARENA
+		add_resource(make_unique<resource_base>(mem::frame_arena{}));
+	}
 	{ // GLFW Events
 		add_resource(make_unique<resource_base>(glfw::api{}));
 	}
@@ -117,6 +157,48 @@ std::string application::get_current_path() const
 {
 	return std::filesystem::current_path().string();
 }
+void application::publish_resource(std::uint32_t index, resource_base* resource)
+{
+	if (index == resource_base::invalid_index())
+		return;
+
+	// writers are serialized by 'm_mutex', only readers need to see the table through the release below
+	auto const* current = m_table.load(std::memory_order_relaxed);
+	auto resources = current != nullptr ? current->resources : vector<resource_base*>{};
+	if (index >= resources.size())
+		resources.resize(index + 1);
+
+	resources[index] = resource;
+	m_table.store(new resource_table{ std::move(resources) }, std::memory_order_release);
+
+	// a reader may have loaded 'current' just before the store, it is freed a frame later
+	if (current != nullptr)
+		m_retired.push_back(current);
+}
+resource_base* application::read_table(std::uint32_t index) const
+{
+	auto const* table = m_table.load(std::memory_order_acquire);
+	if (table == nullptr || index >= table->resources.size())
+		return nullptr;
+
+	return table->resources[index];
+}
+void application::reclaim_tables()
+{
+	std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
+
+	for (auto const* table : m_retiring)
+		delete table;
+
+	m_retiring = std::move(m_retired);
+	m_retired = vector<resource_table const*>{};
+}
+std::size_t application::resource_tables()
+{
+	std::lock_guard<std::recursive_mutex> lock{ *m_mutex };
+
+	return (m_table.load(std::memory_order_relaxed) != nullptr ? 1 : 0) + m_retired.size() + m_retiring.size();
+}
 
 void application::run()
 {
@@ -124,11 +206,18 @@ void application::run()
 	log.info("Opening...");
 	m_properties.is_open = true;
 
+	auto& arena = get_resource<mem::frame_arena>();
+
 	int i = 0;
 	while (m_properties.is_open)
 	{
+		// everything allocated for the previous frame is gone from here on
+		arena.reset();
+
 		for(auto &r : m_resources)
 			r.second->on_update(this);
+
+		reclaim_tables();
 	}
 }
 }
\ No newline at end of file
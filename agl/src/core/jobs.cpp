@@ -0,0 +1,394 @@
+#include "agl/core/jobs.hpp"
+#include "agl/core/logger.hpp"
+
+namespace agl
+{
+namespace
+{
+// set on worker threads only, lets 'submit' and 'take' use the deque of the calling worker
+thread_local jobs const* current_jobs = nullptr;
+thread_local std::uint64_t current_worker_index = 0;
+}
+
+namespace impl
+{
+job_deque::job_deque()
+	: m_bottom{ 0 }
+	, m_top{ 0 }
+{
+	for (auto& slot : m_buffer)
+		slot.store(nullptr, std::memory_order_relaxed);
+}
+bool job_deque::push(job* j)
+{
+	auto const bottom = m_bottom.load(std::memory_order_relaxed);
+	auto const top = m_top.load(std::memory_order_acquire);
+	if (bottom - top >= capacity)
+		return false;
+
+	m_buffer[bottom & (capacity - 1)].store(j, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+job* job_deque::pop()
+{
+	auto const bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	auto* j = m_buffer[bottom & (capacity - 1)].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// last job, race the thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			j = nullptr;
+
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return j;
+}
+job* job_deque::steal()
+{
+	auto top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	auto const bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+		return nullptr;
+
+	auto* j = m_buffer[top & (capacity - 1)].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+
+	return j;
+}
+}
+
+job_handle::job_handle()
+	: m_job{ nullptr }
+	, m_jobs{ nullptr }
+{
+}
+job_handle::job_handle(jobs* owner, impl::job* job)
+	: m_job{ job }
+	, m_jobs{ owner }
+{
+	if (m_job != nullptr)
+		m_job->references.fetch_add(1);
+}
+job_handle::job_handle(job_handle const& other)
+	: job_handle{ other.m_jobs, other.m_job }
+{
+}
+job_handle::job_handle(job_handle&& other)
+	: m_job{ other.m_job }
+	, m_jobs{ other.m_jobs }
+{
+	other.m_job = nullptr;
+	other.m_jobs = nullptr;
+}
+job_handle& job_handle::operator=(job_handle const& other)
+{
+	if (this == &other)
+		return *this;
+
+	reset();
+
+	m_job = other.m_job;
+	m_jobs = other.m_jobs;
+	if (m_job != nullptr)
+		m_job->references.fetch_add(1);
+
+	return *this;
+}
+job_handle& job_handle::operator=(job_handle&& other)
+{
+	if (this == &other)
+		return *this;
+
+	reset();
+
+	m_job = other.m_job;
+	m_jobs = other.m_jobs;
+	other.m_job = nullptr;
+	other.m_jobs = nullptr;
+	return *this;
+}
+job_handle::~job_handle()
+{
+	reset();
+}
+bool job_handle::is_done() const
+{
+	AGL_ASSERT(is_valid(), "invalid job");
+
+	return m_job->unfinished.load(std::memory_order_acquire) == 0;
+}
+bool job_handle::is_valid() const
+{
+	return m_job != nullptr;
+}
+void job_handle::wait() const
+{
+	AGL_ASSERT(is_valid(), "invalid job");
+
+	while (!is_done())
+		if (!m_jobs->execute_one())
+			std::this_thread::yield();
+}
+void job_handle::reset()
+{
+	if (m_job != nullptr)
+		m_jobs->release(m_job);
+
+	m_job = nullptr;
+	m_jobs = nullptr;
+}
+
+std::uint64_t jobs::default_worker_count()
+{
+	// one worker per core, the main thread occupies the last one
+	auto const cores = static_cast<std::uint64_t>(std::thread::hardware_concurrency());
+	return std::max<std::uint64_t>(cores, 2) - 1;
+}
+jobs::jobs(std::uint64_t worker_count)
+	: resource<jobs>{ type_id<jobs>::get_id() }
+	, m_injected_count{ 0 }
+	, m_injected_head{ 0 }
+	, m_queued{ 0 }
+	, m_sleeping{ 0 }
+	, m_stop{ false }
+	, m_worker_count{ worker_count }
+{
+}
+jobs::jobs(jobs&& other)
+	: resource<jobs>{ type_id<jobs>::get_id() }
+	, m_injected_count{ 0 }
+	, m_injected_head{ 0 }
+	, m_queued{ 0 }
+	, m_sleeping{ 0 }
+	, m_stop{ false }
+	, m_worker_count{ other.m_worker_count }
+{
+	AGL_ASSERT(other.m_workers.empty(), "cannot move a running job system");
+}
+jobs::~jobs()
+{
+	if (!m_workers.empty())
+		on_detach(nullptr);
+}
+std::uint64_t jobs::current_worker() const
+{
+	return current_jobs == this ? current_worker_index : invalid_worker();
+}
+bool jobs::execute_one()
+{
+	auto* j = take();
+	if (j == nullptr)
+		return false;
+
+	execute(j);
+	return true;
+}
+std::uint64_t jobs::worker_count() const
+{
+	return m_workers.size();
+}
+void jobs::on_attach(application* app)
+{
+	AGL_ASSERT(m_workers.empty(), "job system already attached");
+
+	m_stop = false;
+	m_deques.reserve(m_worker_count);
+	for (auto i = std::uint64_t{ 0 }; i < m_worker_count; ++i)
+		m_deques.push_back(make_unique<impl::job_deque>());
+
+	// every deque must exist before the first worker starts stealing
+	m_workers.reserve(m_worker_count);
+	for (auto i = std::uint64_t{ 0 }; i < m_worker_count; ++i)
+		m_workers.push_back(std::thread{ &jobs::worker_loop, this, i });
+
+	if (app != nullptr)
+		app->get_resource<agl::logger>().debug("Jobs: {} workers", m_worker_count);
+}
+void jobs::on_detach(application*)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_stop = true;
+	}
+	m_cond_var.notify_all();
+
+	for (auto& worker : m_workers)
+		if (worker.joinable())
+			worker.join();
+
+	m_workers.clear();
+
+	// finish whatever was still queued, new jobs run inline from now on
+	while (execute_one())
+		;
+
+	m_deques.clear();
+}
+void jobs::on_update(application*)
+{
+}
+void jobs::execute(impl::job* j)
+{
+	j->invoke(*j);
+	finish(j);
+}
+void jobs::finish(impl::job* j)
+{
+	if (j->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	auto continuations = vector<impl::job*>{};
+	{
+		std::lock_guard<std::mutex> lock{ j->mutex };
+		continuations = std::move(j->continuations);
+	}
+
+	for (auto* continuation : continuations)
+		submit(continuation);
+
+	if (j->parent != nullptr)
+		finish(j->parent);
+
+	release(j);
+}
+impl::job* jobs::allocate_job(impl::job* parent)
+{
+	auto lock = std::unique_lock<std::mutex>{ m_job_pool_mutex };
+	auto* j = m_job_pool.make();
+	lock.unlock();
+
+	j->parent = parent;
+	j->references.store(1);
+	j->unfinished.store(1);
+
+	if (parent != nullptr)
+		parent->unfinished.fetch_add(1);
+
+	return j;
+}
+void jobs::release(impl::job* j)
+{
+	if (j->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	j->destroy(*j);
+
+	std::lock_guard<std::mutex> lock{ m_job_pool_mutex };
+	m_job_pool.destroy(j);
+}
+void jobs::submit(impl::job* j)
+{
+	if (m_workers.empty())
+	{
+		execute(j);
+		return;
+	}
+
+	++m_queued;
+	if (current_jobs != this || !m_deques[current_worker_index]->push(j))
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_injected.push_back(j);
+		m_injected_count.fetch_add(1, std::memory_order_release);
+	}
+
+	if (m_sleeping > 0)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		m_cond_var.notify_one();
+	}
+}
+impl::job* jobs::take()
+{
+	auto const is_worker = current_jobs == this;
+	if (is_worker)
+		if (auto* j = m_deques[current_worker_index]->pop())
+		{
+			--m_queued;
+			return j;
+		}
+
+	// idle workers poll here, only take the lock if something was injected
+	if (m_injected_count.load(std::memory_order_acquire) != 0)
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		if (m_injected_head < m_injected.size())
+		{
+			auto* j = m_injected[m_injected_head++];
+			if (m_injected_head == m_injected.size())
+			{
+				m_injected.resize(0);
+				m_injected_head = 0;
+			}
+			m_injected_count.fetch_sub(1, std::memory_order_relaxed);
+			--m_queued;
+			return j;
+		}
+	}
+
+	auto const count = m_deques.size();
+	auto const first = is_worker ? current_worker_index + 1 : 0;
+	for (auto i = std::uint64_t{ 0 }; i < count; ++i)
+	{
+		auto const victim = (first + i) % count;
+		if (is_worker && victim == current_worker_index)
+			continue;
+
+		if (auto* j = m_deques[victim]->steal())
+		{
+			--m_queued;
+			return j;
+		}
+	}
+	return nullptr;
+}
+void jobs::worker_loop(std::uint64_t index)
+{
+	current_jobs = this;
+	current_worker_index = index;
+
+	while (true)
+	{
+		auto* j = take();
+		for (auto spin = 0; j == nullptr && spin < 64; ++spin)
+		{
+			std::this_thread::yield();
+			j = take();
+		}
+
+		if (j != nullptr)
+		{
+			execute(j);
+			continue;
+		}
+
+		auto lock = std::unique_lock<std::mutex>{ m_mutex };
+		if (m_stop)
+			break;
+
+		++m_sleeping;
+		m_cond_var.wait(lock, [this]
+			{
+				return m_stop || m_queued > 0;
+			});
+		--m_sleeping;
+	}
+
+	current_jobs = nullptr;
+}
+}
@@ -16,15 +16,21 @@ const char* logger::get_logger_name(instance_index index)
 	return "UNKNOWN";
 }
 logger::logger()
+	: logger{ default_capacity() }
+{
+}
+logger::logger(std::uint64_t capacity, overflow_policy policy)
 	: resource<logger>{ }
 	, m_cond_var{ nullptr }
+	, m_consumer_waiting{ false }
+	, m_messages{ capacity, policy }
 	, m_mutex{ nullptr }
-	, m_messages_count{ 0 }
 {
 }
 logger::logger(logger&& other)
 	: resource<logger>{ std::move(other) }
-	, m_messages_count{ other.m_messages_count.load() }
+	, m_consumer_waiting{ false }
+	, m_messages{ std::move(other.m_messages) }
 {
 	if (this == &other)
 		return;
@@ -32,7 +38,6 @@ logger::logger(logger&& other)
 	if (other.m_mutex != nullptr)
 		other.m_mutex->lock();
 
-	m_messages = std::move(other.m_messages);
 	m_cond_var = other.m_cond_var;
 	m_loggers = std::move(other.m_loggers);
 	m_thread = other.m_thread;
@@ -41,20 +46,55 @@ logger::logger(logger&& other)
 	if (m_mutex != nullptr)
 		m_mutex->unlock();
 }
+std::uint64_t logger::get_dropped_count() const
+{
+	return m_messages.dropped();
+}
 bool logger::is_active() const
 {
 	AGL_ASSERT(m_thread != nullptr, "invalid thread object");
 	return m_thread->is_valid() && m_thread->is_running();
 }
 std::string logger::get_date()
+{
+	return get_date(std::chrono::system_clock::now());
+}
+std::string logger::get_date(std::chrono::system_clock::time_point time)
 {
 	using namespace date;
 	using namespace std::chrono;
-	auto const now = floor<date::days>(system_clock::now());
+	auto const day = floor<date::days>(time);
 	auto ss = std::stringstream{};
-	ss << year_month_day{ now } << ' ' << make_time(system_clock::now() - now);
+	ss << year_month_day{ day } << ' ' << make_time(time - day);
 	return ss.str();
 }
+void logger::notify()
+{
+	// pairs with the fence of the listening thread, either it sees the message or we see it waiting
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!m_consumer_waiting.load(std::memory_order_relaxed))
+		return;
+
+	// only the producer clearing the flag wakes the listening thread, the others leave without locking
+	if (!m_consumer_waiting.exchange(false, std::memory_order_relaxed))
+		return;
+
+	// the listening thread sets the flag and checks the ring before it waits, both under the lock,
+	// so taking it here keeps the notification from slipping in between and getting lost until the timeout
+	std::lock_guard<std::mutex> lock{ *m_mutex };
+	m_cond_var->notify_one();
+}
+void logger::write(message& msg)
+{
+	auto& stream = *m_loggers[msg.destination].m_stream;
+	if (msg.format == nullptr)
+	{
+		stream << msg.message << "\n";
+		return;
+	}
+
+	stream << get_date(msg.time) << " [" << get_logger_name(msg.destination) << "] " << msg.render(msg.format->text(), msg.arguments) << "\n";
+}
 void logger::on_attach(application* app)
 {
 	auto logger_thread = [&]
@@ -62,43 +102,45 @@ void logger::on_attach(application* app)
 			AGL_ASSERT(m_mutex != nullptr, "invalid mutex");
 			AGL_ASSERT(m_cond_var != nullptr, "invalid cond_var");
 
-			this->debug("Logger: using thread {}", std::this_thread::get_id());
+			// messages are copied out of the ring before being written, a slot is held only for the copy
+			auto pending = message{};
+			auto take = [&](message& msg)
+				{
+					pending = msg; // the string of 'pending' keeps its capacity
+				};
+
+			// bypasses 'm_messages', with 'BLOCK_WHEN_FULL' a push from its only consumer could wait for room forever
+			auto write_own = [&](std::string const& text)
+				{
+					*m_loggers[DEBUG].m_stream << get_date() << " " << produce_message(DEBUG, text, std::this_thread::get_id()) << "\n";
+				};
+
+			write_own("Logger: using thread {}");
 
 			while (true)
 			{
-				std::unique_lock<std::mutex> lock{ *m_mutex };
-				auto stop_waiting = [&]
-					{
-						return m_messages_count > 0 || m_thread->should_close();
-					};
-				auto log_messages = [&]
-					{
-						auto const messages = m_messages;
-						m_messages.clear();
-						m_messages_count = 0;
-						lock.unlock();
-
-						for (auto& msg : messages)
-						{
-							auto& stream = *m_loggers[msg.destination].m_stream;
-							stream << msg.message << "\n";
-						}
-					};
-
-				m_cond_var->wait(lock, stop_waiting);
-				if (m_messages_count > 0)
-				{
-					log_messages();
-				}
-				else if (m_thread->should_close())
+				while (m_messages.pop(take))
+					write(pending);
+
+				if (m_thread->should_close())
 				{
-					this->debug("Logger: Leaving thread {}", std::this_thread::get_id());
-					if (m_messages_count > 0)
-						log_messages();
+					while (m_messages.pop(take))
+						write(pending);
+					write_own("Logger: Leaving thread {}");
 					break;
 				}
-			}
 
+				std::unique_lock<std::mutex> lock{ *m_mutex };
+				m_consumer_waiting.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+
+				// closing the thread does not notify, the timeout catches it
+				m_cond_var->wait_for(lock, std::chrono::milliseconds{ 10 }, [&]
+					{
+						return !m_messages.empty() || m_thread->should_close();
+					});
+				m_consumer_waiting.store(false, std::memory_order_relaxed);
+			}
 		};
 
 	// init loggers
@@ -0,0 +1,274 @@
+#include "agl/ecs/archetype.hpp"
+
+namespace agl
+{
+namespace ecs
+{
+static std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+archetype::archetype(allocator_type const& allocator, mem::vector<component_info> const& columns, std::uint64_t chunk_size)
+	: m_add_edges{ allocator }
+	, m_allocator{ allocator }
+	, m_alignment{ alignof(std::max_align_t) }
+	, m_chunk_bytes{ chunk_size }
+	, m_chunk_capacity{ 0 }
+	, m_chunks{ allocator }
+	, m_columns{ columns }
+	, m_entities{ allocator }
+	, m_mask{ allocator }
+	, m_offsets{ allocator }
+	, m_remove_edges{ allocator }
+{
+	AGL_ASSERT(chunk_size > 0, "invalid chunk size");
+
+	auto row_size = std::uint64_t{ 0 };
+	for (auto const& column : m_columns)
+	{
+		row_size += column.size;
+		m_alignment = std::max(m_alignment, column.alignment);
+		m_mask.set(column.index);
+	}
+
+	// entities without components do not need any column memory
+	if (row_size == 0)
+	{
+		m_chunk_capacity = chunk_size;
+		return;
+	}
+
+	// find the largest row count whose columns, including alignment padding, fit in one chunk
+	m_offsets.resize(m_columns.size());
+	for (m_chunk_capacity = std::max<std::uint64_t>(chunk_size / row_size, 1); ; --m_chunk_capacity)
+	{
+		auto end = std::uint64_t{ 0 };
+		for (auto i = std::uint64_t{ 0 }; i < m_columns.size(); ++i)
+		{
+			m_offsets[i] = align_up(end, m_columns[i].alignment);
+			end = m_offsets[i] + m_columns[i].size * m_chunk_capacity;
+		}
+
+		if (end <= chunk_size || m_chunk_capacity == 1)
+		{
+			m_chunk_bytes = std::max(chunk_size, end);
+			break;
+		}
+	}
+}
+archetype::archetype(archetype&& other)
+	: m_add_edges{ std::move(other.m_add_edges) }
+	, m_allocator{ std::move(other.m_allocator) }
+	, m_alignment{ other.m_alignment }
+	, m_chunk_bytes{ other.m_chunk_bytes }
+	, m_chunk_capacity{ other.m_chunk_capacity }
+	, m_chunks{ std::move(other.m_chunks) }
+	, m_columns{ std::move(other.m_columns) }
+	, m_entities{ std::move(other.m_entities) }
+	, m_mask{ std::move(other.m_mask) }
+	, m_offsets{ std::move(other.m_offsets) }
+	, m_remove_edges{ std::move(other.m_remove_edges) }
+{
+}
+archetype& archetype::operator=(archetype&& other)
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+
+	m_add_edges = std::move(other.m_add_edges);
+	m_allocator = std::move(other.m_allocator);
+	m_alignment = other.m_alignment;
+	m_chunk_bytes = other.m_chunk_bytes;
+	m_chunk_capacity = other.m_chunk_capacity;
+	m_chunks = std::move(other.m_chunks);
+	m_columns = std::move(other.m_columns);
+	m_entities = std::move(other.m_entities);
+	m_mask = std::move(other.m_mask);
+	m_offsets = std::move(other.m_offsets);
+	m_remove_edges = std::move(other.m_remove_edges);
+	return *this;
+}
+archetype::~archetype()
+{
+	clear();
+}
+std::uint64_t archetype::chunk_capacity() const
+{
+	return m_chunk_capacity;
+}
+std::uint64_t archetype::chunk_count() const
+{
+	return (size() + m_chunk_capacity - 1) / m_chunk_capacity;
+}
+std::uint64_t archetype::chunk_size(std::uint64_t chunk) const
+{
+	AGL_ASSERT(chunk < chunk_count(), "index out of bounds");
+
+	return std::min(m_chunk_capacity, size() - chunk * m_chunk_capacity);
+}
+std::uint64_t archetype::column_count() const
+{
+	return m_columns.size();
+}
+std::uint64_t archetype::count(type_id_t type) const
+{
+	auto result = std::uint64_t{ 0 };
+	for (auto column = find_column(type); column < m_columns.size() && m_columns[column].id == type; ++column)
+		++result;
+	return result;
+}
+void archetype::destruct(std::uint64_t row)
+{
+	AGL_ASSERT(row < size(), "index out of bounds");
+
+	for (auto column = std::uint64_t{ 0 }; column < m_columns.size(); ++column)
+		m_columns[column].destruct(get(column, row));
+}
+std::uint64_t archetype::find_column(type_id_t type, std::uint64_t index) const
+{
+	auto comp = [](component_info const& info, type_id_t type)
+		{
+			return info.id.get_value() < type.get_value();
+		};
+
+	auto found = std::lower_bound(m_columns.cbegin(), m_columns.cend(), type, comp);
+	auto const column = static_cast<std::uint64_t>(found - m_columns.cbegin()) + index;
+
+	if (column >= m_columns.size() || m_columns[column].id != type)
+		return invalid_column();
+	return column;
+}
+std::byte* archetype::get(std::uint64_t column, std::uint64_t row)
+{
+	AGL_ASSERT(column < m_columns.size(), "index out of bounds");
+	AGL_ASSERT(row < size(), "index out of bounds");
+
+	auto* memory = get_chunk(row / m_chunk_capacity);
+	return memory + m_offsets[column] + (row % m_chunk_capacity) * m_columns[column].size;
+}
+std::byte const* archetype::get(std::uint64_t column, std::uint64_t row) const
+{
+	AGL_ASSERT(column < m_columns.size(), "index out of bounds");
+	AGL_ASSERT(row < size(), "index out of bounds");
+
+	auto const* memory = get_chunk(row / m_chunk_capacity);
+	return memory + m_offsets[column] + (row % m_chunk_capacity) * m_columns[column].size;
+}
+std::byte* archetype::get_column(std::uint64_t chunk, std::uint64_t column)
+{
+	AGL_ASSERT(column < m_columns.size(), "index out of bounds");
+
+	return get_chunk(chunk) + m_offsets[column];
+}
+component_info const& archetype::get_column_info(std::uint64_t column) const
+{
+	AGL_ASSERT(column < m_columns.size(), "index out of bounds");
+
+	return m_columns[column];
+}
+mem::vector<component_info> const& archetype::get_columns() const
+{
+	return m_columns;
+}
+type_mask const& archetype::get_mask() const
+{
+	return m_mask;
+}
+std::uint32_t archetype::get_entity(std::uint64_t row) const
+{
+	AGL_ASSERT(row < size(), "index out of bounds");
+
+	return m_entities[row];
+}
+bool archetype::has_component(type_id_t type) const
+{
+	return find_column(type) != invalid_column();
+}
+bool archetype::empty() const
+{
+	return m_entities.empty();
+}
+std::uint64_t archetype::size() const
+{
+	return m_entities.size();
+}
+std::uint64_t archetype::push_entity(std::uint32_t index)
+{
+	auto const row = size();
+
+	if (!m_offsets.empty() && row == m_chunks.size() * m_chunk_capacity)
+		m_chunks.push_back(m_allocator.allocate(m_chunk_bytes, m_alignment));
+
+	m_entities.push_back(index);
+	return row;
+}
+std::uint32_t archetype::pop_entity(std::uint64_t row)
+{
+	AGL_ASSERT(row < size(), "index out of bounds");
+
+	auto moved = std::numeric_limits<std::uint32_t>::max();
+	auto const last = size() - 1;
+	if (row != last)
+	{
+		for (auto column = std::uint64_t{ 0 }; column < m_columns.size(); ++column)
+		{
+			m_columns[column].move(get(column, row), get(column, last));
+			m_columns[column].destruct(get(column, last));
+		}
+		moved = m_entities[last];
+		m_entities[row] = moved;
+	}
+	m_entities.pop_back();
+
+	// release the trailing chunk as soon as it holds no rows
+	if (!m_chunks.empty() && m_chunks.size() > chunk_count())
+	{
+		m_allocator.deallocate(m_chunks.back(), m_chunk_bytes);
+		m_chunks.pop_back();
+	}
+	return moved;
+}
+archetype* archetype::get_add_edge(type_id_t type) const
+{
+	auto found = m_add_edges.find(type);
+	if (found == m_add_edges.cend())
+		return nullptr;
+	return found->second;
+}
+archetype* archetype::get_remove_edge(type_id_t type) const
+{
+	auto found = m_remove_edges.find(type);
+	if (found == m_remove_edges.cend())
+		return nullptr;
+	return found->second;
+}
+void archetype::set_add_edge(type_id_t type, archetype* target)
+{
+	m_add_edges[type] = target;
+}
+void archetype::set_remove_edge(type_id_t type, archetype* target)
+{
+	m_remove_edges[type] = target;
+}
+void archetype::clear()
+{
+	for (auto row = std::uint64_t{ 0 }; row < size(); ++row)
+		destruct(row);
+
+	for (auto* chunk : m_chunks)
+		m_allocator.deallocate(chunk, m_chunk_bytes);
+
+	m_chunks.clear();
+	m_entities.clear();
+}
+std::byte* archetype::get_chunk(std::uint64_t chunk) const
+{
+	AGL_ASSERT(chunk < m_chunks.size(), "index out of bounds");
+
+	return m_chunks[chunk];
+}
+}
+}
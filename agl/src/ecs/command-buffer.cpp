@@ -0,0 +1,121 @@
+#include "agl/ecs/command-buffer.hpp"
+#include <cstddef>
+
+namespace agl
+{
+namespace ecs
+{
+command_buffer::command_buffer(mem::pool::allocator<std::byte> allocator)
+	: m_allocator{ std::move(allocator) }
+	, m_pending_count{ 0 }
+	, m_page_offset{ page_size() }
+{
+}
+command_buffer::command_buffer(command_buffer&& other)
+	: m_allocator{ std::move(other.m_allocator) }
+	, m_commands{ std::move(other.m_commands) }
+	, m_made{ std::move(other.m_made) }
+	, m_pending_count{ other.m_pending_count }
+	, m_page_offset{ other.m_page_offset }
+	, m_pages{ std::move(other.m_pages) }
+{
+	other.m_pending_count = 0;
+	other.m_page_offset = page_size();
+}
+command_buffer& command_buffer::operator=(command_buffer&& other)
+{
+	if (this == &other)
+		return *this;
+
+	clear();
+	free_pages(false);
+
+	m_allocator = std::move(other.m_allocator);
+	m_commands = std::move(other.m_commands);
+	m_made = std::move(other.m_made);
+	m_pending_count = other.m_pending_count;
+	m_page_offset = other.m_page_offset;
+	m_pages = std::move(other.m_pages);
+
+	other.m_pending_count = 0;
+	other.m_page_offset = page_size();
+	return *this;
+}
+command_buffer::~command_buffer()
+{
+	clear();
+	free_pages(false);
+}
+void command_buffer::destroy_entity(entity const& ent)
+{
+	record(command{ DESTROY_ENTITY, type_id_t{}, ent, command::not_pending(), 0, 0, nullptr, nullptr, nullptr });
+}
+bool command_buffer::empty() const
+{
+	return m_commands.empty();
+}
+command_buffer::pending_entity command_buffer::make_entity()
+{
+	record(command{ MAKE_ENTITY, type_id_t{}, entity{}, m_pending_count, 0, 0, nullptr, nullptr, nullptr });
+	return pending_entity{ m_pending_count++ };
+}
+std::uint64_t command_buffer::size() const
+{
+	return m_commands.size();
+}
+std::byte* command_buffer::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	// oversized payloads get a page of their own, inserted before the current one so it keeps being filled
+	if (size + alignment > page_size())
+	{
+		auto const oversized = page{ m_allocator.allocate(size, alignment), size };
+		m_pages.insert(m_pages.empty() ? m_pages.cend() : m_pages.cend() - 1, oversized);
+		return oversized.memory;
+	}
+
+	auto address = m_pages.empty() ? 0 : reinterpret_cast<std::uintptr_t>(m_pages.back().memory) + m_page_offset;
+	auto padding = address == 0 ? 0 : (alignment - address % alignment) % alignment;
+	if (m_pages.empty() || m_page_offset + padding + size > page_size())
+	{
+		m_pages.push_back(page{ m_allocator.allocate(page_size(), alignof(std::max_align_t)), page_size() });
+		m_page_offset = 0;
+		address = reinterpret_cast<std::uintptr_t>(m_pages.back().memory);
+		padding = (alignment - address % alignment) % alignment;
+	}
+
+	auto* result = m_pages.back().memory + m_page_offset + padding;
+	m_page_offset += padding + size;
+	return result;
+}
+void command_buffer::clear()
+{
+	for (auto& cmd : m_commands)
+		if (cmd.payload != nullptr)
+			cmd.destroy(cmd.payload);
+
+	m_commands.resize(0);
+	m_made.resize(0);
+	m_pending_count = 0;
+
+	// keep a single page around, the buffer is refilled every frame
+	free_pages(true);
+	m_page_offset = 0;
+}
+void command_buffer::free_pages(bool keep_current)
+{
+	// oversized pages are never kept, they would be filled up to 'page_size'
+	auto const keep = keep_current && !m_pages.empty() && m_pages.back().size == page_size();
+	auto const last = m_pages.size() - (keep ? 1 : 0);
+	for (auto i = std::uint64_t{ 0 }; i < last; ++i)
+		m_allocator.deallocate(m_pages[i].memory, m_pages[i].size);
+
+	if (keep)
+		m_pages[0] = m_pages.back();
+	m_pages.resize(keep ? 1 : 0);
+}
+void command_buffer::record(command const& cmd)
+{
+	m_commands.push_back(cmd);
+}
+}
+}
@@ -1,35 +1,70 @@
 #include "agl/ecs/ecs.hpp"
+#include <algorithm>
+#include "agl/core/jobs.hpp"
 #include "agl/core/logger.hpp"
 
 namespace agl
 {
 namespace ecs
 {
-organizer::organizer(mem::pool::allocator<organizer> allocator)
+organizer::organizer(mem::pool::allocator<organizer> allocator, storage_type storage, std::uint64_t chunk_size)
 	: resource<organizer>{}
 	, m_allocator{ allocator }
+	, m_archetypes{ allocator }
+	, m_chunk_size{ chunk_size }
 	, m_components{ allocator }
-	, m_entities{ allocator }
+	, m_entities{ mem::make_unique<impl::entity_table>(allocator, impl::entity_table{ allocator }) }
+	, m_queries{ allocator }
+	, m_query_block_storage{ allocator }
+	, m_scheduler{}
+	, m_storage_type{ storage }
+	, m_storages{ allocator }
 	, m_systems{ allocator }
 {
 }
 organizer::organizer(organizer&& other)
 	: resource<organizer>{ std::move(other) }
 	, m_allocator{ std::move(other.m_allocator) }
+	, m_archetypes{ std::move(other.m_archetypes) }
+	, m_chunk_size{ other.m_chunk_size }
+	, m_command_order{ std::move(other.m_command_order) }
+	, m_command_buffers{ std::move(other.m_command_buffers) }
 	, m_components{ std::move(other.m_components) }
 	, m_entities{ std::move(other.m_entities) }
+	, m_queries{ std::move(other.m_queries) }
+	, m_query_block_storage{ std::move(other.m_query_block_storage) }
+	, m_scheduler{ std::move(other.m_scheduler) }
+	, m_storage_type{ other.m_storage_type }
+	, m_storages{ std::move(other.m_storages) }
 	, m_systems{ std::move(other.m_systems) }
+	, m_thread_commands{ std::move(other.m_thread_commands) }
+	, m_thread_ids{ std::move(other.m_thread_ids) }
 {
+	take_query_blocks(other);
+	relink();
 }
 organizer& organizer::operator=(organizer&& other)
 {
 	this->resource<organizer>::operator=(std::move(other));
 
 	m_allocator = std::move(other.m_allocator);
+	m_archetypes = std::move(other.m_archetypes);
+	m_chunk_size = other.m_chunk_size;
+	m_command_order = std::move(other.m_command_order);
+	m_command_buffers = std::move(other.m_command_buffers);
 	m_components = std::move(other.m_components);
 	m_entities = std::move(other.m_entities);
+	m_queries = std::move(other.m_queries);
+	m_query_block_storage = std::move(other.m_query_block_storage);
+	take_query_blocks(other);
+	m_scheduler = std::move(other.m_scheduler);
+	m_storage_type = other.m_storage_type;
+	m_storages = std::move(other.m_storages);
 	m_systems = std::move(other.m_systems);
+	m_thread_commands = std::move(other.m_thread_commands);
+	m_thread_ids = std::move(other.m_thread_ids);
 
+	relink();
 	return *this;
 }
 system_base* organizer::get_system_impl(type_id_t id)
@@ -63,54 +98,145 @@ void organizer::add_system(application* app, mem::unique_ptr<system_base> sys)
 	m_systems.emplace_back(std::move(sys));
 	m_systems.back()->set_organizer(this);
 	m_systems.back()->on_attach(app);
+	m_scheduler.invalidate();
 }
 entity organizer::make_entity()
 {
-	auto data = impl::entity_data{ get_allocator(), m_entities.size() };
-	m_entities.push_back(std::move(data));
-	return entity{ &m_entities.back() };
+	auto result = m_entities->make();
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		auto& root = get_archetype(mem::vector<component_info>{ get_allocator() });
+		auto& data = m_entities->get(result.index());
+		data.m_archetype = &root;
+		data.m_row = root.push_entity(result.index());
+	}
+	return result;
 }
 void organizer::destroy_entity(entity& ent)
 {
 	if (ent.empty())
 		return;
+
+	AGL_ASSERT(is_alive(ent), "entity was already destroyed");
+
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		auto& data = get_data(ent);
+		data.m_archetype->destruct(data.m_row);
+
+		auto const moved = data.m_archetype->pop_entity(data.m_row);
+		if (moved != entity::invalid_index())
+			m_entities->get(moved).m_row = data.m_row;
+
+		m_entities->destroy(ent.index());
+		ent = entity{};
+		return;
+	}
 	
-	auto type_ids = ent.get_component_ids();
+	auto type_ids = get_component_ids(ent);
 	for (auto type_id : type_ids)
 		pop_components(type_id, ent);
 
-	m_entities.erase(ent.m_data);
+	m_entities->destroy(ent.index());
 	ent = entity{};
 }
+bool organizer::is_alive(entity const& ent) const
+{
+	return ent.m_table == m_entities.get() && ent.is_valid();
+}
+std::uint64_t organizer::get_component_count(type_id_t type_id, entity const& ent) const
+{
+	return get_data(ent).size(type_id);
+}
+vector<type_id_t> organizer::get_component_ids(entity const& ent) const
+{
+	return get_data(ent).get_component_ids();
+}
+bool organizer::has_component(type_id_t type_id, entity const& ent) const
+{
+	return get_data(ent).has_component(type_id);
+}
+impl::entity_data& organizer::get_data(entity const& ent)
+{
+	AGL_ASSERT(is_alive(ent), "entity handle is expired");
+
+	return m_entities->get(ent.index());
+}
+impl::entity_data const& organizer::get_data(entity const& ent) const
+{
+	AGL_ASSERT(is_alive(ent), "entity handle is expired");
+
+	return m_entities->get(ent.index());
+}
 void organizer::pop_component(type_id_t type_id, entity& ent, std::uint64_t index)
 {
+	AGL_ASSERT(is_alive(ent), "entity is uninitialized or destroyed");
+	AGL_ASSERT(has_component(type_id, ent), "queried component type is not attached to this entity");
+	AGL_ASSERT(index < get_component_count(type_id, ent), "queried component type is not attached to this entity");
+
+	auto& data = get_data(ent);
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		move_entity(data, get_remove_target(*data.m_archetype, type_id), type_id, index);
+		return;
+	}
+
 	AGL_ASSERT(m_components.find(type_id) != m_components.end(), "invalid component type");
-	AGL_ASSERT(ent.has_component(type_id), "queried component type is not attached to this entity");
-	AGL_ASSERT(index < ent.size(type_id), "queried component type is not attached to this entity");
 
-	auto& components = m_components.at(type_id);
-	auto* ptr = ent.m_data->m_components.at(type_id).at(index);
-	ent.m_data->pop_component(type_id, index);
-	components->pop_component(ptr);
+	auto& storage = *m_components.at(type_id);
+	auto& refs = data.m_components.at(type_id);
+	auto const slot = refs.at(index).slot;
+	data.pop_component(type_id, storage.index(), index);
+
+	// components after 'index' moved one instance down
+	for (auto i = index; i < refs.size(); ++i)
+		storage.set_owner(refs[i].slot, component_owner{ static_cast<std::uint32_t>(data.m_index), static_cast<std::uint32_t>(i) });
+
+	pop_storage_component(storage, type_id, slot);
+	on_component_popped(data, type_id);
 }
 void organizer::pop_components(type_id_t type_id, entity& ent)
 {
-	AGL_ASSERT(m_components.find(type_id) != m_components.end(), "invalid component type");
-	AGL_ASSERT(ent.has_component(type_id), "queried component type is not attached to this entity");
+	AGL_ASSERT(is_alive(ent), "entity is uninitialized or destroyed");
+	AGL_ASSERT(has_component(type_id, ent), "queried component type is not attached to this entity");
 
-	auto& storage = m_components.at(type_id);
-	auto ent_components = ent.m_data->m_components.find(type_id);
+	auto& data = get_data(ent);
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		auto* target = data.m_archetype;
+		for (auto i = data.m_archetype->count(type_id); i > 0; --i)
+			target = &get_remove_target(*target, type_id);
 
-	AGL_ASSERT(ent_components != ent.m_data->m_components.end(), "entity has no component of type 'type_id'");
+		move_entity(data, *target, type_id, archetype::invalid_column());
+		return;
+	}
+
+	AGL_ASSERT(m_components.find(type_id) != m_components.end(), "invalid component type");
 
-	for (auto* ptr : ent_components->second)
-		storage->pop_component(ptr);
+	auto& storage = *m_components.at(type_id);
+	auto& refs = data.m_components.at(type_id);
 
-	ent_components->second.clear();
-	ent.m_data->m_components.erase(ent_components);
+	// last instance first, so the remaining instances keep their index
+	while (!refs.empty())
+	{
+		auto const slot = refs.back().slot;
+		refs.pop_back();
+		pop_storage_component(storage, type_id, slot);
+	}
+
+	data.pop_components(type_id, storage.index());
+	on_component_popped(data, type_id);
 }
 std::uint64_t organizer::get_component_count(type_id_t type_id) const
 {
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		auto result = std::uint64_t{ 0 };
+		for (auto const& arch : m_archetypes)
+			result += arch->size() * arch->count(type_id);
+		return result;
+	}
+
 	auto found = m_components.find(type_id);
 
 	if (found == m_components.end())
@@ -120,6 +246,9 @@ std::uint64_t organizer::get_component_count(type_id_t type_id) const
 }
 void organizer::on_attach(application* app) 
 {
+	if (app->has_resource<jobs>())
+		set_jobs(&app->get_resource<jobs>());
+
 	auto& log = app->get_resource<agl::logger>();
 	log.debug("ECS: OK");
 }
@@ -132,19 +261,347 @@ void organizer::on_detach(application* app)
 		m_systems.back()->on_detach(app);
 		m_systems.erase(m_systems.cend() - 1);
 	}
-	m_entities.clear();
+	m_scheduler.invalidate();
+	set_jobs(nullptr);
+	m_thread_commands.clear();
+	m_thread_ids.clear();
+	clear_queries();
+	m_entities->clear();
+	m_storages.clear();
 	m_components.clear();
+	m_archetypes.clear();
 
 	log.debug("ECS: OFF");
 }
 void organizer::on_update(application* app)
 {
-	for (auto& sys : m_systems)
-		sys->on_update(app);
+	m_scheduler.run(app, m_systems, [this]() { play_commands(); });
+}
+void organizer::set_jobs(jobs* workers)
+{
+	for (auto const& buffer : m_command_buffers)
+		AGL_ASSERT(buffer->empty(), "commands were not played back");
+
+	m_scheduler.set_jobs(workers);
+
+	auto const count = workers != nullptr ? workers->worker_count() : 0;
+	m_command_buffers.clear();
+	m_command_buffers.reserve(count);
+	for (auto i = std::uint64_t{ 0 }; i < count; ++i)
+		m_command_buffers.push_back(make_unique<command_buffer>(command_buffer{ get_allocator() }));
+}
+command_buffer& organizer::get_command_buffer()
+{
+	if (auto* workers = m_scheduler.get_jobs())
+	{
+		auto const worker = workers->current_worker();
+		if (worker < m_command_buffers.size())
+			return *m_command_buffers[worker];
+	}
+
+	std::lock_guard<std::mutex> lock{ m_thread_commands_mutex };
+
+	auto const id = std::this_thread::get_id();
+	for (auto i = std::uint64_t{ 0 }; i < m_thread_ids.size(); ++i)
+		if (m_thread_ids[i] == id)
+			return *m_thread_commands[i];
+
+	m_thread_ids.push_back(id);
+	m_thread_commands.push_back(make_unique<command_buffer>(command_buffer{ get_allocator() }));
+	return *m_thread_commands.back();
+}
+void organizer::play_commands()
+{
+	std::lock_guard<std::mutex> lock{ m_thread_commands_mutex };
+
+	m_command_order.resize(0);
+	auto gather = [this](command_buffer& buffer)
+	{
+		if (m_command_order.capacity() < m_command_order.size() + buffer.size())
+			m_command_order.reserve(std::max(m_command_order.size() + buffer.size(), m_command_order.capacity() * 2));
+
+		buffer.m_made.reserve(buffer.m_pending_count);
+
+		// entities are made first, in the order they were recorded
+		for (auto& cmd : buffer.m_commands)
+			if (cmd.type == command_buffer::MAKE_ENTITY)
+			{
+				buffer.m_made.push_back(make_entity());
+			}
+			else
+			{
+				if (cmd.pending != command_buffer::command::not_pending())
+					cmd.target = buffer.m_made[cmd.pending];
+
+				cmd.sequence = m_command_order.size();
+				m_command_order.push_back(&cmd);
+			}
+	};
+
+	for (auto& buffer : m_command_buffers)
+		if (!buffer->empty())
+			gather(*buffer);
+
+	for (auto& buffer : m_thread_commands)
+		if (!buffer->empty())
+			gather(*buffer);
+
+	// grouped by component type so every storage is updated in one pass, then by entity, keeping the recording order of an entity on a type
+	// destroys come last, the components they take down are not pushed or popped again by a later command
+	std::sort(m_command_order.begin(), m_command_order.end(), [](command_buffer::command const* lhs, command_buffer::command const* rhs)
+		{
+			auto const lhs_destroy = lhs->type == command_buffer::DESTROY_ENTITY;
+			auto const rhs_destroy = rhs->type == command_buffer::DESTROY_ENTITY;
+			if (lhs_destroy != rhs_destroy)
+				return rhs_destroy;
+
+			if (lhs->component != rhs->component)
+				return lhs->component.get_value() < rhs->component.get_value();
+
+			if (lhs->target.index() != rhs->target.index())
+				return lhs->target.index() < rhs->target.index();
+
+			return lhs->sequence < rhs->sequence;
+		});
+
+	for (auto* cmd : m_command_order)
+		play_command(*cmd);
+
+	for (auto& buffer : m_command_buffers)
+		buffer->clear();
+
+	for (auto& buffer : m_thread_commands)
+		buffer->clear();
 }
 typename organizer::allocator_type organizer::get_allocator() const
 {
 	return m_allocator;
 }
+storage_type organizer::get_storage_type() const
+{
+	return m_storage_type;
+}
+impl::query_base& organizer::add_query(std::uint32_t index, mem::unique_ptr<impl::query_base> q)
+{
+	AGL_ASSERT(find_query(index) == nullptr, "query already present");
+	AGL_ASSERT(index < query_block_size * query_block_count, "too many query types");
+
+	if (m_storage_type == ARCHETYPE_STORAGE)
+	{
+		for (auto& arch : m_archetypes)
+			if (q->matches(*arch))
+				q->push_archetype(arch.get());
+	}
+	else
+	{
+		for (auto index = std::uint32_t{ 0 }; index < m_entities->capacity(); ++index)
+		{
+			auto const& data = m_entities->get(index);
+			if (data.is_valid() && q->matches(data))
+				q->push_entity(data);
+		}
+	}
+
+	auto& block = m_query_blocks[index / query_block_size];
+	if (block.load(std::memory_order_relaxed) == nullptr)
+	{
+		m_query_block_storage.push_back(mem::make_unique<query_block>(get_allocator()));
+		block.store(m_query_block_storage.back().get(), std::memory_order_release);
+	}
+
+	m_queries.push_back(std::move(q));
+	block.load(std::memory_order_relaxed)->queries[index % query_block_size].store(m_queries.back().get(), std::memory_order_release);
+	return *m_queries.back();
+}
+void organizer::relink()
+{
+	// systems still point to the moved-from organizer, queries, handles and recorded commands point to the entity table, which moved along
+	for (auto& sys : m_systems)
+		sys->set_organizer(this);
+}
+void organizer::play_command(command_buffer::command& cmd)
+{
+	// the entity may have been destroyed since the command was recorded
+	if (!is_alive(cmd.target))
+		return;
+
+	switch (cmd.type)
+	{
+	case command_buffer::PUSH_COMPONENT:
+		cmd.push(*this, cmd.target, cmd.payload);
+		break;
+	case command_buffer::POP_COMPONENT:
+		if (cmd.index < get_component_count(cmd.component, cmd.target))
+			pop_component(cmd.component, cmd.target, cmd.index);
+		break;
+	case command_buffer::POP_COMPONENTS:
+		if (has_component(cmd.component, cmd.target))
+			pop_components(cmd.component, cmd.target);
+		break;
+	case command_buffer::DESTROY_ENTITY:
+		destroy_entity(cmd.target);
+		break;
+	default:
+		break;
+	}
+}
+impl::query_base* organizer::find_query(std::uint32_t index) const
+{
+	if (index >= query_block_size * query_block_count)
+		return nullptr;
+
+	auto const* block = m_query_blocks[index / query_block_size].load(std::memory_order_acquire);
+	if (block == nullptr)
+		return nullptr;
+
+	return block->queries[index % query_block_size].load(std::memory_order_acquire);
+}
+void organizer::clear_queries()
+{
+	for (auto& block : m_query_blocks)
+		block.store(nullptr, std::memory_order_relaxed);
+
+	m_query_block_storage.clear();
+	m_queries.clear();
+}
+void organizer::take_query_blocks(organizer& other)
+{
+	// the blocks only point to queries, which do not move with the organizer
+	for (auto i = std::uint32_t{ 0 }; i < query_block_count; ++i)
+		m_query_blocks[i].store(other.m_query_blocks[i].exchange(nullptr, std::memory_order_relaxed), std::memory_order_relaxed);
+}
+void organizer::on_component_pushed(impl::entity_data& data, type_id_t type)
+{
+	for (auto& q : m_queries)
+		if (q->has_component(type) && !q->contains(data) && q->matches(data))
+			q->push_entity(data);
+}
+void organizer::on_component_popped(impl::entity_data& data, type_id_t type)
+{
+	// the entity may still own other components of this type
+	if (data.has_component(type))
+		return;
+
+	for (auto& q : m_queries)
+		if (q->has_component(type) && q->contains(data))
+			q->pop_entity(data);
+}
+archetype& organizer::get_archetype(mem::vector<component_info> const& columns)
+{
+	auto same_columns = [&columns](archetype const& arch)
+		{
+			if (arch.column_count() != columns.size())
+				return false;
+
+			for (auto i = std::uint64_t{ 0 }; i < columns.size(); ++i)
+				if (arch.get_column_info(i).id != columns[i].id)
+					return false;
+			return true;
+		};
+
+	for (auto& arch : m_archetypes)
+		if (same_columns(*arch))
+			return *arch;
+
+	m_archetypes.push_back(mem::make_unique<archetype>(get_allocator(), archetype{ get_allocator(), columns, m_chunk_size }));
+
+	auto& result = *m_archetypes.back();
+	for (auto& q : m_queries)
+		if (q->matches(result))
+			q->push_archetype(&result);
+
+	return result;
+}
+archetype& organizer::get_add_target(archetype& source, component_info const& info)
+{
+	auto* target = source.get_add_edge(info.id);
+	if (target != nullptr)
+		return *target;
+
+	// new column goes after the columns of the same type, so that existing component indexes are preserved
+	auto comp = [](type_id_t type, component_info const& column)
+		{
+			return type.get_value() < column.id.get_value();
+		};
+
+	auto columns = source.get_columns();
+	auto const position = std::upper_bound(columns.cbegin(), columns.cend(), info.id, comp);
+	columns.insert(position, info);
+
+	target = &get_archetype(columns);
+	source.set_add_edge(info.id, target);
+	target->set_remove_edge(info.id, &source);
+	return *target;
+}
+archetype& organizer::get_remove_target(archetype& source, type_id_t type)
+{
+	AGL_ASSERT(source.has_component(type), "archetype does not contain this component type");
+
+	auto* target = source.get_remove_edge(type);
+	if (target != nullptr)
+		return *target;
+
+	auto columns = source.get_columns();
+	columns.erase(columns.cbegin() + source.find_column(type, source.count(type) - 1));
+
+	target = &get_archetype(columns);
+	source.set_remove_edge(type, target);
+	target->set_add_edge(type, &source);
+	return *target;
+}
+void organizer::move_entity(impl::entity_data& data, archetype& target, type_id_t removed_type, std::uint64_t removed_index)
+{
+	AGL_ASSERT(data.m_archetype != nullptr, "entity does not belong to any archetype");
+	AGL_ASSERT(data.m_archetype != &target, "entity already belongs to this archetype");
+
+	auto& source = *data.m_archetype;
+	auto const source_row = data.m_row;
+	auto const target_row = target.push_entity(static_cast<std::uint32_t>(data.m_index));
+
+	// 'removed_index' equal to 'archetype::invalid_column()' removes every component of 'removed_type'
+	auto index = std::uint64_t{ 0 };
+	for (auto column = std::uint64_t{ 0 }; column < source.column_count(); ++column)
+	{
+		auto const& info = source.get_column_info(column);
+		index = (column > 0 && source.get_column_info(column - 1).id == info.id) ? index + 1 : 0;
+
+		auto* ptr = source.get(column, source_row);
+		if (info.id == removed_type && (removed_index == archetype::invalid_column() || index == removed_index))
+		{
+			info.destruct(ptr);
+			continue;
+		}
+
+		auto const target_index = (info.id == removed_type && index > removed_index) ? index - 1 : index;
+		info.move(target.get(target.find_column(info.id, target_index), target_row), ptr);
+		info.destruct(ptr);
+	}
+
+	auto const moved = source.pop_entity(source_row);
+	if (moved != entity::invalid_index())
+		m_entities->get(moved).m_row = source_row;
+
+	data.m_archetype = &target;
+	data.m_row = target_row;
+}
+void organizer::pop_storage_component(component_storage_base& storage, type_id_t type_id, std::uint64_t slot)
+{
+	auto const moved = storage.pop_component(slot);
+	if (moved.entity == component_owner::invalid_entity())
+		return;
+
+	// the last component of the storage took 'slot', point its entity to the new location
+	auto& ref = m_entities->get(moved.entity).m_components.at(type_id).at(moved.instance);
+	ref.ptr = storage.get(slot);
+	ref.slot = slot;
+}
+std::byte* organizer::push_archetype_component(impl::entity_data& data, component_info const& info)
+{
+	auto& target = get_add_target(*data.m_archetype, info);
+	auto const index = data.m_archetype->count(info.id);
+
+	move_entity(data, target, type_id_t{}, 0);
+	return target.get(target.find_column(info.id, index), data.m_row);
+}
 }
 }
@@ -6,33 +6,64 @@ namespace ecs
 {
 namespace impl
 {
-entity_data::entity_data(mem::dictionary<type_id_t, mem::vector<std::byte*>>::allocator_type const& allocator, std::uint64_t index)
-	: m_components{ allocator }
+entity_data::entity_data(mem::dictionary<type_id_t, component_refs>::allocator_type const& allocator, std::uint64_t index)
+	: m_archetype{ nullptr }
+	, m_components{ allocator }
 	, m_index{ index }
+	, m_mask{ allocator }
+	, m_row{ 0 }
 {
 }
 bool entity_data::has_component(type_id_t type_id) const
 {
+	if (m_archetype != nullptr)
+		return m_archetype->has_component(type_id);
+
 	auto components = m_components.find(type_id);
 	return components != m_components.cend() && !components->second.empty();
 }
-void entity_data::pop_components(type_id_t type_id)
+void entity_data::pop_components(type_id_t type_id, std::uint32_t type_index)
 {
 	auto found = m_components.find(type_id);
 	m_components.erase(found);
+	m_mask.reset(type_index);
 }
-void entity_data::pop_component(type_id_t type_id, std::uint64_t index)
+void entity_data::pop_component(type_id_t type_id, std::uint32_t type_index, std::uint64_t index)
 {
 	auto& components = m_components.at(type_id);
 	components.erase(components.cbegin() + index);
+
+	if (components.empty())
+		m_mask.reset(type_index);
+}
+void entity_data::push_component(type_id_t type_id, std::uint32_t type_index, component_ref ref)
+{
+	m_mask.set(type_index);
+
+	auto found = m_components.find(type_id);
+	if (found == m_components.end())
+		found = m_components.emplace(std::make_pair(type_id, component_refs{ m_components.get_allocator() }));
+
+	found->second.push_back(ref);
 }
 vector<type_id_t> entity_data::get_component_ids() const
 {
 	auto result = vector<type_id_t>{};
+
+	if (m_archetype != nullptr)
+	{
+		for (auto const& column : m_archetype->get_columns())
+			if (result.empty() || result.back() != column.id)
+				result.push_back(column.id);
+		return result;
+	}
+
 	result.reserve(m_components.size());
 
+	// popping the last instance of a type leaves its entry empty
 	for (auto const& pair : m_components)
-		result.push_back(pair.first);
+		if (!pair.second.empty())
+			result.push_back(pair.first);
 
 	return result;
 }
@@ -42,31 +73,171 @@ bool entity_data::is_valid() const
 }
 std::uint64_t entity_data::size(type_id_t type_id) const
 {
+	if (m_archetype != nullptr)
+		return m_archetype->count(type_id);
+
 	auto found = m_components.find(type_id);
 	if (found == m_components.cend())
 		return 0;
 	return found->second.size();
 }
+entity_table::entity_table(allocator_type const& allocator)
+	: m_allocator{ allocator }
+	, m_data{ allocator }
+	, m_free{ allocator }
+	, m_generations{ allocator }
+	, m_size{ 0 }
+{
+}
+entity_table::entity_table(entity_table&& other)
+	: m_allocator{ std::move(other.m_allocator) }
+	, m_data{ std::move(other.m_data) }
+	, m_free{ std::move(other.m_free) }
+	, m_generations{ std::move(other.m_generations) }
+	, m_size{ other.m_size }
+{
+	other.m_size = 0;
+}
+entity_table& entity_table::operator=(entity_table&& other)
+{
+	m_allocator = std::move(other.m_allocator);
+	m_data = std::move(other.m_data);
+	m_free = std::move(other.m_free);
+	m_generations = std::move(other.m_generations);
+	m_size = other.m_size;
+	other.m_size = 0;
+
+	return *this;
 }
-entity::entity(impl::entity_data* data)
-	: m_data{ data }
+std::uint64_t entity_table::capacity() const
+{
+	return m_data.size();
+}
+void entity_table::clear()
+{
+	// destroy rather than drop the slots, so that handles outliving the table contents stay invalid
+	for (auto index = std::uint32_t{ 0 }; index < m_data.size(); ++index)
+		if (m_data[index].is_valid())
+			destroy(index);
+}
+void entity_table::destroy(std::uint32_t index)
+{
+	AGL_ASSERT(index < m_data.size() && m_data[index].is_valid(), "entity is not alive");
+
+	m_data[index] = entity_data{ m_allocator };
+	++m_generations[index];
+	m_free.push_back(index);
+	--m_size;
+}
+bool entity_table::empty() const
+{
+	return m_size == 0;
+}
+entity_data& entity_table::get(std::uint32_t index)
+{
+	AGL_ASSERT(index < m_data.size(), "index out of bounds");
+
+	return m_data[index];
+}
+entity_data const& entity_table::get(std::uint32_t index) const
+{
+	AGL_ASSERT(index < m_data.size(), "index out of bounds");
+
+	return m_data[index];
+}
+entity entity_table::get_entity(std::uint32_t index)
+{
+	AGL_ASSERT(index < m_data.size(), "index out of bounds");
+
+	return entity{ this, index, m_generations[index] };
+}
+bool entity_table::is_alive(std::uint32_t index, std::uint32_t generation) const
+{
+	return index < m_data.size() && m_generations[index] == generation && m_data[index].is_valid();
+}
+entity entity_table::make()
+{
+	auto index = std::uint32_t{ 0 };
+	if (!m_free.empty())
+	{
+		index = m_free.back();
+		m_free.pop_back();
+	}
+	else
+	{
+		AGL_ASSERT(m_data.size() < entity::invalid_index(), "entity table is full");
+
+		index = static_cast<std::uint32_t>(m_data.size());
+		m_data.push_back(entity_data{ m_allocator });
+		m_generations.push_back(0);
+	}
+
+	m_data[index] = entity_data{ m_allocator, index };
+	++m_size;
+	return entity{ this, index, m_generations[index] };
+}
+std::uint64_t entity_table::size() const
+{
+	return m_size;
+}
+}
+entity::entity()
+	: m_generation{ 0 }
+	, m_index{ invalid_index() }
+	, m_table{ nullptr }
+{
+}
+entity::entity(impl::entity_table* table, std::uint32_t index, std::uint32_t generation)
+	: m_generation{ generation }
+	, m_index{ index }
+	, m_table{ table }
 {
 }
 bool entity::empty() const
 {
-	return m_data == nullptr;
+	return m_table == nullptr || m_index == invalid_index();
+}
+std::uint32_t entity::generation() const
+{
+	return m_generation;
+}
+std::uint64_t entity::id() const
+{
+	return (static_cast<std::uint64_t>(m_generation) << 32) | m_index;
+}
+std::uint32_t entity::index() const
+{
+	return m_index;
+}
+bool entity::is_valid() const
+{
+	return !empty() && m_table->is_alive(m_index, m_generation);
+}
+bool entity::operator==(entity const& other) const
+{
+	return m_table == other.m_table && m_index == other.m_index && m_generation == other.m_generation;
+}
+bool entity::operator!=(entity const& other) const
+{
+	return !(*this == other);
 }
 bool entity::has_component(type_id_t id) const
 {
-	return m_data->has_component(id);
+	return get_data().has_component(id);
 }
 vector<type_id_t> entity::get_component_ids() const
 {
-	return m_data->get_component_ids();
+	return get_data().get_component_ids();
 }
 std::uint64_t entity::size(type_id_t id) const
 {
-	return m_data->size(id);
+	return get_data().size(id);
+}
+impl::entity_data& entity::get_data() const
+{
+	AGL_ASSERT(is_valid(), "entity handle is expired");
+
+	return m_table->get(m_index);
 }
 }
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "agl/ecs/query.hpp"
+
+namespace agl
+{
+namespace ecs
+{
+namespace impl
+{
+query_base::query_base(allocator_type const& allocator, entity_table& table, type_id_t id, mem::vector<type_id_t> const& types)
+	: m_archetypes{ allocator }
+	, m_entities{ allocator }
+	, m_id{ id }
+	, m_positions{ allocator }
+	, m_table{ &table }
+	, m_types{ types }
+{
+}
+query_base::query_base(query_base&& other)
+	: m_archetypes{ std::move(other.m_archetypes) }
+	, m_entities{ std::move(other.m_entities) }
+	, m_id{ other.m_id }
+	, m_positions{ std::move(other.m_positions) }
+	, m_table{ other.m_table }
+	, m_types{ std::move(other.m_types) }
+{
+}
+query_base& query_base::operator=(query_base&& other)
+{
+	m_archetypes = std::move(other.m_archetypes);
+	m_entities = std::move(other.m_entities);
+	m_id = other.m_id;
+	m_positions = std::move(other.m_positions);
+	m_table = other.m_table;
+	m_types = std::move(other.m_types);
+
+	return *this;
+}
+bool query_base::contains(entity_data const& data) const
+{
+	return data.m_index < m_positions.size() && m_positions[data.m_index] != invalid_position();
+}
+bool query_base::empty() const
+{
+	return size() == 0;
+}
+mem::vector<type_id_t> const& query_base::get_types() const
+{
+	return m_types;
+}
+bool query_base::has_component(type_id_t type) const
+{
+	for (auto const& id : m_types)
+		if (id == type)
+			return true;
+	return false;
+}
+type_id_t query_base::id() const
+{
+	return m_id;
+}
+bool query_base::matches(archetype const& arch) const
+{
+	for (auto const& id : m_types)
+		if (!arch.has_component(id))
+			return false;
+	return true;
+}
+bool query_base::matches(entity_data const& data) const
+{
+	for (auto const& id : m_types)
+		if (!data.has_component(id))
+			return false;
+	return true;
+}
+void query_base::pop_entity(entity_data const& data)
+{
+	AGL_ASSERT(contains(data), "entity is not part of the query");
+
+	auto const position = m_positions[data.m_index];
+	auto const last = m_entities.back();
+
+	m_entities[position] = last;
+	m_positions[last] = position;
+	m_entities.pop_back();
+	m_positions[data.m_index] = invalid_position();
+}
+void query_base::push_archetype(archetype* arch)
+{
+	AGL_ASSERT(matches(*arch), "archetype does not match the query");
+
+	m_archetypes.push_back(arch);
+}
+void query_base::push_entity(entity_data const& data)
+{
+	AGL_ASSERT(!contains(data), "entity is already part of the query");
+	AGL_ASSERT(data.is_valid(), "invalid entity");
+
+	if (data.m_index >= m_positions.capacity())
+		m_positions.reserve(std::max(data.m_index + 1, m_positions.capacity() * 2));
+
+	while (m_positions.size() <= data.m_index)
+		m_positions.push_back(invalid_position());
+
+	m_positions[data.m_index] = m_entities.size();
+	m_entities.push_back(static_cast<std::uint32_t>(data.m_index));
+}
+std::uint64_t query_base::size() const
+{
+	auto result = m_entities.size();
+	for (auto const* arch : m_archetypes)
+		result += arch->size();
+	return result;
+}
+}
+}
+}
@@ -0,0 +1,157 @@
+#include "agl/ecs/scheduler.hpp"
+#include "agl/core/jobs.hpp"
+
+namespace agl
+{
+namespace ecs
+{
+scheduler::scheduler()
+	: m_dirty{ true }
+	, m_jobs{ nullptr }
+	, m_main_head{ 0 }
+	, m_remaining{ 0 }
+{
+}
+scheduler::scheduler(scheduler&& other)
+	: m_dirty{ true }
+	, m_jobs{ other.m_jobs }
+	, m_main_head{ 0 }
+	, m_remaining{ 0 }
+{
+}
+scheduler& scheduler::operator=(scheduler&& other)
+{
+	m_dirty = true;
+	m_jobs = other.m_jobs;
+	return *this;
+}
+jobs* scheduler::get_jobs() const
+{
+	return m_jobs;
+}
+void scheduler::invalidate()
+{
+	m_dirty = true;
+}
+void scheduler::run(application* app, mem::vector<mem::unique_ptr<system_base>>& systems, std::function<void()> const& sync)
+{
+	if (m_dirty)
+		build(systems);
+
+	for (auto stage = std::uint64_t{ 0 }; stage + 1 < m_stages.size(); ++stage)
+	{
+		// nodes are already in a valid execution order
+		if (m_jobs == nullptr || m_jobs->worker_count() == 0)
+		{
+			for (auto i = m_stages[stage]; i < m_stages[stage + 1]; ++i)
+				m_nodes[i].system->on_update(app);
+		}
+		else
+			run_stage(app, m_stages[stage], m_stages[stage + 1]);
+
+		sync();
+	}
+}
+void scheduler::set_jobs(jobs* workers)
+{
+	m_jobs = workers;
+}
+void scheduler::build(mem::vector<mem::unique_ptr<system_base>>& systems)
+{
+	m_nodes.clear();
+	m_stages.clear();
+	m_nodes.reserve(systems.size());
+	m_stages.reserve(POST_RENDER + 2);
+
+	for (auto stage : { PRE_RENDER, RENDER, POST_RENDER })
+	{
+		m_stages.push_back(m_nodes.size());
+		for (auto& sys : systems)
+			if (sys->stage() == stage)
+				m_nodes.push_back(node{ sys.get(), 0, vector<std::uint64_t>{} });
+	}
+	m_stages.push_back(m_nodes.size());
+
+	// a system depends on every conflicting system of its stage that was added before it
+	for (auto stage = std::uint64_t{ 0 }; stage + 1 < m_stages.size(); ++stage)
+		for (auto i = m_stages[stage]; i < m_stages[stage + 1]; ++i)
+			for (auto j = i + 1; j < m_stages[stage + 1]; ++j)
+				if (m_nodes[i].system->conflicts_with(*m_nodes[j].system))
+				{
+					m_nodes[i].successors.push_back(j);
+					++m_nodes[j].dependencies;
+				}
+
+	m_main_queue.reserve(m_nodes.size());
+	m_pending.resize(m_nodes.size());
+	m_dirty = false;
+}
+void scheduler::dispatch(application* app, std::uint64_t index)
+{
+	if (m_nodes[index].system->is_exclusive())
+		m_main_queue.push_back(index);
+	else
+		m_jobs->run([this, app, index]() { execute(app, index); });
+}
+void scheduler::execute(application* app, std::uint64_t index)
+{
+	m_nodes[index].system->on_update(app);
+
+	// notify under the lock, 'run_stage' may return and the scheduler go away as soon as 'm_remaining' hits zero
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	for (auto successor : m_nodes[index].successors)
+		if (--m_pending[successor] == 0)
+			dispatch(app, successor);
+
+	--m_remaining;
+	m_cond_var.notify_all();
+}
+void scheduler::run_stage(application* app, std::uint64_t begin, std::uint64_t end)
+{
+	if (begin == end)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+
+		m_main_queue.resize(0);
+		m_main_head = 0;
+		m_remaining = end - begin;
+
+		for (auto i = begin; i < end; ++i)
+			m_pending[i] = m_nodes[i].dependencies;
+
+		for (auto i = begin; i < end; ++i)
+			if (m_pending[i] == 0)
+				dispatch(app, i);
+	}
+
+	while (true)
+	{
+		auto lock = std::unique_lock<std::mutex>{ m_mutex };
+		if (m_remaining == 0)
+			return;
+
+		// exclusive systems can only run here
+		if (m_main_head < m_main_queue.size())
+		{
+			auto const index = m_main_queue[m_main_head++];
+			lock.unlock();
+
+			execute(app, index);
+			continue;
+		}
+		lock.unlock();
+
+		if (m_jobs->execute_one())
+			continue;
+
+		lock.lock();
+		m_cond_var.wait(lock, [this]
+			{
+				return m_remaining == 0 || m_main_head < m_main_queue.size();
+			});
+	}
+}
+}
+}
@@ -6,31 +6,66 @@ namespace agl
 namespace ecs
 {
 system_base::system_base()
-	: m_organizer{ nullptr }
+	: m_declared{ false }
+	, m_organizer{ nullptr }
 {
 }
 system_base::system_base(type_id_t id, std::string const& name, ecs::stage stage)
-	: m_id{ id }
+	: m_declared{ false }
+	, m_id{ id }
 	, m_name{ name }
 	, m_stage{ stage }
 	, m_organizer{ nullptr }
 {
 }
 system_base::system_base(system_base&& other)
-	: m_id{ other.m_id }
+	: m_declared{ other.m_declared }
+	, m_id{ other.m_id }
 	, m_name{ other.m_name }
 	, m_stage{ other.m_stage }
 	, m_organizer{ other.m_organizer }
+	, m_reads{ std::move(other.m_reads) }
+	, m_writes{ std::move(other.m_writes) }
 {
 }
 system_base& system_base::operator=(system_base&& other)
 {
+	m_declared = other.m_declared;
 	m_id = other.m_id;
-	m_name = m_name;
-	m_stage = m_stage;
+	m_name = other.m_name;
+	m_stage = other.m_stage;
 	m_organizer = other.m_organizer;
+	m_reads = std::move(other.m_reads);
+	m_writes = std::move(other.m_writes);
 	return *this;
 }
+bool system_base::conflicts_with(system_base const& other) const
+{
+	if (is_exclusive() || other.is_exclusive())
+		return true;
+
+	return intersects(m_writes, other.m_writes) || intersects(m_writes, other.m_reads) || intersects(m_reads, other.m_writes);
+}
+vector<type_id_t> const& system_base::get_reads() const
+{
+	return m_reads;
+}
+vector<type_id_t> const& system_base::get_writes() const
+{
+	return m_writes;
+}
+bool system_base::is_exclusive() const
+{
+	return !m_declared;
+}
+bool system_base::intersects(vector<type_id_t> const& lhs, vector<type_id_t> const& rhs)
+{
+	for (auto const& l : lhs)
+		for (auto const& r : rhs)
+			if (l == r)
+				return true;
+	return false;
+}
 std::string const& system_base::name() const
 {
 	return m_name;
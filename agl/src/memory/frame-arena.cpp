@@ -0,0 +1,174 @@
+#include "agl/memory/frame-arena.hpp"
+#include "agl/core/logger.hpp"
+#include "agl/util/util.hpp"
+
+namespace agl
+{
+namespace mem
+{
+namespace impl
+{
+linear_buffer::linear_buffer(std::uint64_t block_size)
+	: m_block_size{ block_size }
+	, m_current{ nullptr }
+{
+	AGL_ASSERT(block_size != 0, "cannot allocate blocks of 0 bytes");
+}
+linear_buffer::linear_buffer(linear_buffer&& other)
+	: m_block_size{ other.m_block_size }
+	, m_blocks{ std::move(other.m_blocks) }
+	, m_current{ other.m_current.load() }
+{
+	other.m_current = nullptr;
+}
+linear_buffer::~linear_buffer()
+{
+	free_blocks();
+}
+std::byte* linear_buffer::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	auto* current = m_current.load(std::memory_order_acquire);
+	while (true)
+	{
+		if (current != nullptr)
+		{
+			auto const address = reinterpret_cast<std::uintptr_t>(current->memory);
+			auto offset = current->offset.load(std::memory_order_relaxed);
+			while (true)
+			{
+				auto const begin = offset + (alignment - (address + offset) % alignment) % alignment;
+				if (begin + size > current->size)
+					break;
+
+				if (current->offset.compare_exchange_weak(offset, begin + size, std::memory_order_relaxed))
+					return current->memory + begin;
+			}
+		}
+
+		current = add_block(current, size, alignment);
+	}
+}
+std::uint64_t linear_buffer::occupancy() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	auto result = std::uint64_t{ 0 };
+	for (auto const& b : m_blocks)
+		result += b->offset.load(std::memory_order_relaxed);
+
+	return result;
+}
+void linear_buffer::reset()
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	if (m_blocks.size() > 1)
+	{
+		auto total = std::uint64_t{ 0 };
+		for (auto const& b : m_blocks)
+			total += b->size;
+
+		free_blocks();
+		m_blocks.push_back(make_unique<block>());
+		m_blocks.back()->memory = new std::byte[total];
+		m_blocks.back()->size = total;
+		m_current = m_blocks.back().get();
+	}
+
+	if (!m_blocks.empty())
+		m_blocks.back()->offset.store(0, std::memory_order_relaxed);
+}
+std::uint64_t linear_buffer::size() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	auto result = std::uint64_t{ 0 };
+	for (auto const& b : m_blocks)
+		result += b->size;
+
+	return result;
+}
+linear_buffer::block* linear_buffer::add_block(block* full, std::uint64_t size, std::uint64_t alignment)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	// another thread may have added one already
+	auto* current = m_current.load(std::memory_order_relaxed);
+	if (current != full)
+		return current;
+
+	// new[] aligns to the default new alignment only, leave room for any stronger one
+	auto const block_size = std::max(m_block_size, size + alignment);
+	m_blocks.push_back(make_unique<block>());
+	m_blocks.back()->memory = new std::byte[block_size];
+	m_blocks.back()->size = block_size;
+	m_blocks.back()->offset.store(0, std::memory_order_relaxed);
+
+	m_current.store(m_blocks.back().get(), std::memory_order_release);
+	return m_blocks.back().get();
+}
+void linear_buffer::free_blocks()
+{
+	for (auto& b : m_blocks)
+		delete[] b->memory;
+
+	m_blocks.clear();
+	m_current = nullptr;
+}
+}
+
+frame_arena::frame_arena(std::uint64_t block_size)
+	: resource<frame_arena>{ type_id<frame_arena>::get_id() }
+	, m_double{ impl::linear_buffer{ block_size }, impl::linear_buffer{ block_size } }
+	, m_frame{ 0 }
+	, m_single{ block_size }
+{
+}
+frame_arena::frame_arena(frame_arena&& other)
+	: resource<frame_arena>{ type_id<frame_arena>::get_id() }
+	, m_double{ std::move(other.m_double[0]), std::move(other.m_double[1]) }
+	, m_frame{ other.m_frame }
+	, m_single{ std::move(other.m_single) }
+{
+}
+std::byte* frame_arena::allocate(std::uint64_t size, std::uint64_t alignment, lifetime life)
+{
+	if (life == DOUBLE_FRAME)
+		return m_double[m_frame % 2].allocate(size, alignment);
+
+	return m_single.allocate(size, alignment);
+}
+std::uint64_t frame_arena::frame() const
+{
+	return m_frame;
+}
+std::uint64_t frame_arena::occupancy() const
+{
+	return m_single.occupancy() + m_double[0].occupancy() + m_double[1].occupancy();
+}
+void frame_arena::reset()
+{
+	++m_frame;
+	m_single.reset();
+
+	// the other buffer holds the previous frame, which stays valid for one more
+	m_double[m_frame % 2].reset();
+}
+std::uint64_t frame_arena::size() const
+{
+	return m_single.size() + m_double[0].size() + m_double[1].size();
+}
+void frame_arena::on_attach(application* app)
+{
+	auto& log = app->get_resource<agl::logger>();
+	log.debug("Frame arena: OK");
+}
+void frame_arena::on_detach(application* app)
+{
+	auto& log = app->get_resource<agl::logger>();
+	log.debug("Frame arena | {}: OFF", util::ns::memory_size(size()));
+}
+void frame_arena::on_update(application* app)
+{
+}
+}
+}
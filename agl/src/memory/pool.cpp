@@ -1,37 +1,100 @@
 #include "agl/memory/pool.hpp"
+#include <cstring>
 #include "agl/core/logger.hpp"
+#include "agl/hash-map.hpp"
+#include "agl/memory/virtual-memory.hpp"
 #include "agl/util/util.hpp"
 
 namespace agl
 {
 namespace mem
 {
-pool::pool()
-	: m_memory{ nullptr }
+namespace
+{
+std::atomic<std::uint64_t> next_pool_id{ 1 };
+
+// live pools by id, exiting threads reach the pools they cached blocks of through it
+struct pool_registry
+{
+	std::mutex mutex; // taken before the mutex of any pool
+	agl::hash_map<std::uint64_t, pool*> pools;
+};
+
+pool_registry& get_registry()
+{
+	// never destroyed, threads and static pools may outlive static objects
+	static auto* instance = new pool_registry{};
+	return *instance;
+}
+}
+
+struct pool::thread_cache_owner
+{
+	~thread_cache_owner();
+
+	agl::hash_map<std::uint64_t, thread_cache*> caches; // ids of destroyed pools are dropped on the next miss
+};
+
+pool::thread_cache_owner::~thread_cache_owner()
+{
+	// destroyed pools took the blocks back already
+	auto& registry = get_registry();
+	std::lock_guard<std::mutex> lock{ registry.mutex };
+	for (auto const& entry : caches)
+	{
+		auto const found = registry.pools.find(entry.first);
+		if (found != registry.pools.end())
+			found->second->release_thread_cache(*entry.second);
+	}
+}
+
+pool::pool(std::uint64_t chunk_size, std::uint64_t max_size, std::uint32_t backing)
+	: m_backing{ backing }
+	, m_chunk_size{ chunk_size }
+	, m_chunks_version{ 0 }
+	, m_id{ 0 }
+	, m_max_size{ max_size }
 	, m_occupancy{ 0 }
 	, m_size{ 0 }
 {
+	AGL_ASSERT(chunk_size != 0, "cannot allocate chunks of 0 bytes");
 }
 pool::pool(pool&& other)
-	: m_free_spaces{ std::move(other.m_free_spaces) }
-	, m_memory{ other.m_memory }
-	, m_occupancy{ other.m_occupancy}
-	, m_occupied_spaces{ std::move(other.m_occupied_spaces) }
-	, m_size{ other.m_size }
+	: pool{ other.m_chunk_size, other.m_max_size, other.m_backing }
 {
-	other.m_memory = nullptr;
+	*this = std::move(other);
 }
 pool& pool::operator=(pool&& other)
 {
 	if (&other == this)
 		return *this;
 
+	destroy();
+
+	// the thread caches are looked up by id, they keep working for the moved pool
+	// an exiting thread may be flushing its cache into 'other', it holds the registry while doing so
+	auto& registry = get_registry();
+	std::lock_guard<std::mutex> lock{ registry.mutex };
+	m_backing = other.m_backing;
+	m_caches = std::move(other.m_caches);
+	m_chunk_size = other.m_chunk_size;
+	m_chunks = std::move(other.m_chunks);
+	m_chunks_version = other.m_chunks_version.load();
+	m_free_addresses = std::move(other.m_free_addresses);
 	m_free_spaces = std::move(other.m_free_spaces);
-	m_memory = other.m_memory;
+	m_id = other.m_id;
+	m_max_size = other.m_max_size;
 	m_occupancy = other.m_occupancy;
 	m_occupied_spaces = std::move(other.m_occupied_spaces);
 	m_size = other.m_size;
-	other.m_memory = nullptr;
+	m_size_classes = std::move(other.m_size_classes);
+	other.m_id = 0;
+	other.m_occupancy = 0;
+	other.m_size = 0;
+
+	if (m_id != 0)
+		registry.pools[m_id] = this;
+
 	return *this;
 }
 pool::~pool() noexcept
@@ -41,92 +104,296 @@ pool::~pool() noexcept
 
 std::byte* pool::allocate(std::uint64_t size, std::uint64_t alignment)
 {
-	AGL_ASSERT(!full(), "the pool is at it's maximum capacity");
+	AGL_ASSERT(m_id != 0, "operation on uninitialized object");
+
+	if (size <= small_size_limit())
+	{
+		auto const size_class = get_size_class(size);
+		if (alignment <= get_class_alignment(size_class))
+		{
+			auto& cache = get_thread_cache();
+			auto& cls = cache.classes[size_class];
+			auto const class_size = get_class_size(size_class);
+
+			if (cls.free == nullptr)
+			{
+				std::lock_guard<std::mutex> lock{ m_mutex };
+				for (; cls.count < cache_batch_size(); ++cls.count)
+				{
+					auto* block = allocate_small(size_class);
+					if (block == nullptr)
+						break;
 
-	auto space = pop_free_space(size);
-	auto i = size;
-	std::align(alignment, size, reinterpret_cast<void*&>(space.ptr), i);
+					std::memcpy(block, &cls.free, sizeof(std::byte*));
+					cls.free = block;
+				}
+				cache.cached.store(cache.cached.load(std::memory_order_relaxed) + cls.count * class_size, std::memory_order_relaxed);
+			}
 
-	AGL_ASSERT(space.ptr != nullptr, "invalid pointer after alignment");
+			if (auto* ptr = cls.free)
+			{
+				std::memcpy(&cls.free, ptr, sizeof(std::byte*));
+				--cls.count;
+				cache.cached.store(cache.cached.load(std::memory_order_relaxed) - class_size, std::memory_order_relaxed);
+				return ptr;
+			}
+		}
+	}
+
+	// zero sized blocks would not be told apart from their neighbours
+	size = std::max<std::uint64_t>(size, 1);
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	auto space = pop_free_space(size, alignment);
+	if (space.ptr == nullptr && grow(size, alignment))
+		space = pop_free_space(size, alignment);
+
+	AGL_ASSERT(space.ptr != nullptr, "insufficient memory to allocate this object");
+	if (space.ptr == nullptr)
+		return nullptr;
+
+	m_chunks[find_chunk(space.ptr)]->occupancy += space.size;
 	m_occupancy += space.size;
 	push_occupied_space(space);
 	return space.ptr;
 }
+std::uint64_t pool::chunk_count() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_chunks.size();
+}
 void pool::create(std::uint64_t size)
 {
 	AGL_ASSERT(size != 0, "cannot allocate pool of 0 bytes");
+	AGL_ASSERT(m_chunks.empty(), "pool already created");
+	AGL_ASSERT(size <= m_max_size, "pool exceeds its maximum size");
 
-	m_memory = reinterpret_cast<std::byte*>(std::malloc(size));
-	
-	if (m_memory == nullptr)
-		throw std::exception{ logger::combine_message("not enough memory to allocate pool of {} bytes", size).c_str() };
-
-	m_size = size;
-	push_free_space({ m_memory, m_size });
+	auto& registry = get_registry();
+	std::lock_guard<std::mutex> registry_lock{ registry.mutex };
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	m_id = next_pool_id.fetch_add(1);
+	registry.pools.emplace({ m_id, this });
+	m_size_classes.assign(size_class_count(), size_class{ nullptr, nullptr, nullptr });
+	add_chunk(size);
 }
 void pool::deallocate(std::byte* ptr, std::uint64_t count)
 {
+	AGL_ASSERT(m_id != 0, "operation on uninitialized object");
+
+	// the size class is looked up from the slab, 'count' may be off for polymorphic types
+	auto& cache = get_thread_cache();
+	auto const size_class = find_cached_class(cache, ptr);
+	if (size_class != size_class_count())
+	{
+		auto& cls = cache.classes[size_class];
+		std::memcpy(ptr, &cls.free, sizeof(std::byte*));
+		cls.free = ptr;
+		++cls.count;
+		cache.cached.store(cache.cached.load(std::memory_order_relaxed) + get_class_size(size_class), std::memory_order_relaxed);
+
+		if (cls.count >= 2 * cache_batch_size())
+		{
+			std::lock_guard<std::mutex> lock{ m_mutex };
+			flush_cache(cache, size_class, cache_batch_size());
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	auto const index = find_chunk(ptr);
+	AGL_ASSERT(index < m_chunks.size(), "pointer does not belong to the pool");
+
 	auto found = find_occupied_space(ptr);
 	auto space = *found;
+	m_chunks[index]->occupancy -= space.size;
 	m_occupancy -= space.size;
 	m_occupied_spaces.erase(found);
+
+	// only the block itself, its free neighbours were discarded when freed if they were large enough
+	if (get_discard_size() != 0 && space.size >= get_discard_size())
+		virtual_memory::discard(space.ptr, space.size);
+
 	push_free_space(std::move(space));
+
+	if (m_chunks[index]->occupancy == 0 && m_chunks.size() > 1)
+		release_chunk(index);
 }
 void pool::destroy()
 {
-	if (m_memory == nullptr)
+	auto& registry = get_registry();
+	std::lock_guard<std::mutex> registry_lock{ registry.mutex };
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	if (m_chunks.empty())
 		return;
 
-	AGL_ASSERT(m_occupied_spaces.empty(), "some objects were not deallocated");
+	registry.pools.erase(m_id);
+
+	// no other thread may use the pool anymore
+	for (auto& cache : m_caches)
+		for (auto i = std::uint64_t{ 0 }; i < size_class_count(); ++i)
+			flush_cache(*cache, i, cache->classes[i].count);
+
+	AGL_ASSERT(m_occupancy == 0, "some objects were not deallocated");
+
+	for (auto& ch : m_chunks)
+		free_chunk(*ch);
 
-	std::free(m_memory);
 	m_size = 0;
 	m_occupancy = 0;
-	m_memory = nullptr;
+	m_id = 0;
+	m_caches.clear();
+	m_chunks.clear();
+	m_free_addresses.clear();
 	m_free_spaces.clear();
 	m_occupied_spaces.clear();
+	m_size_classes.clear();
+}
+void pool::flush_thread_cache()
+{
+	auto& cache = get_thread_cache();
+
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	for (auto i = std::uint64_t{ 0 }; i < size_class_count(); ++i)
+		flush_cache(cache, i, cache.classes[i].count);
+}
+pool::fragmentation pool::get_fragmentation() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	auto result = fragmentation{ m_free_spaces.size(), 0, 0, 0.0 };
+	for (auto const& space : m_free_spaces)
+		result.free_size += space.size;
+
+	// sorted by size, the last one is the largest
+	if (!m_free_spaces.empty())
+		result.largest_free_block = m_free_spaces.back().size;
+
+	if (result.free_size != 0)
+		result.ratio = 1.0 - static_cast<double>(result.largest_free_block) / static_cast<double>(result.free_size);
+
+	return result;
 }
 bool pool::full() const
 {
-	return m_occupancy == m_size;
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return m_occupancy == m_size && m_max_size - m_size < m_chunk_size;
 }
 bool pool::empty() const
 {
-	return m_occupancy == 0;
+	return occupancy() == 0;
+}
+std::uint64_t pool::get_chunk_size() const
+{
+	return m_chunk_size;
+}
+pool::chunk_usage pool::get_chunk_usage(std::uint64_t index) const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	AGL_ASSERT(index < m_chunks.size(), "index out of bounds");
+
+	auto const& ch = *m_chunks[index];
+	return chunk_usage{ ch.memory, ch.size, ch.occupancy };
+}
+std::uint64_t pool::get_max_size() const
+{
+	return m_max_size;
 }
 std::uint64_t pool::occupancy() const
 {
-	return m_occupancy;
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	auto cached = std::uint64_t{ 0 };
+	for (auto const& cache : m_caches)
+		cached += cache->cached.load(std::memory_order_relaxed);
+
+	return m_occupancy - cached;
 }
 std::uint64_t pool::size() const
 {
+	std::lock_guard<std::mutex> lock{ m_mutex };
 	return m_size;
 }
 bool pool::has_pointer(std::byte* ptr) const
 {
-	return m_memory <= ptr && ptr < m_memory + m_size;
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	return find_chunk(ptr) != m_chunks.size();
 }
-pool::space pool::pop_free_space(std::uint64_t size)
+pool::space pool::pop_free_space(std::uint64_t size, std::uint64_t alignment)
 {
-	auto found = find_free_space(size);
-	AGL_ASSERT(found != m_free_spaces.cend(), "insufficient memory to allocate this object");
+	// free spaces are sorted by size, take the smallest one that still fits 'size' bytes once aligned (exact fits included)
+	for (auto it = find_free_space(std::max<std::uint64_t>(size, 1) - 1); it != m_free_spaces.cend(); ++it)
+	{
+		auto* ptr = static_cast<void*>(it->ptr);
+		auto available = static_cast<std::size_t>(it->size);
+		if (std::align(alignment, size, ptr, available) == nullptr)
+			continue;
 
-	auto space = *found;
-	m_free_spaces.erase(found);
+		auto const space = *it;
+		auto* const begin = static_cast<std::byte*>(ptr);
+		erase_free_space(space);
 
-	if (space.size > size)
-	{
-		auto excess = space.size - size;
-		space.size -= excess;
-		push_free_space(pool::space{ space.ptr + size, excess });
+		// give back the alignment padding and the excess
+		if (begin != space.ptr)
+			push_free_space(pool::space{ space.ptr, static_cast<std::uint64_t>(begin - space.ptr) });
+
+		if (begin + size < space.ptr + space.size)
+			push_free_space(pool::space{ begin + size, static_cast<std::uint64_t>(space.ptr + space.size - begin - size) });
+
+		return pool::space{ begin, size };
 	}
-	
-	return space;
+
+	return pool::space{ nullptr, 0 };
 }
 void pool::push_free_space(pool::space space)
 {
-	auto it = find_free_space(space.size);
-	m_free_spaces.insert(it, space);
+	// merge with the neighbours first, so that freeing all parts of a block makes it whole again
+	// chunks may happen to be adjacent, a space never spans two of them
+	auto const& ch = *m_chunks[find_chunk(space.ptr)];
+	auto next = find_free_address(space.ptr);
+	if (next != m_free_addresses.cend() && space.ptr + space.size == next->ptr && next->ptr != ch.memory + ch.size)
+	{
+		space.size += next->size;
+		erase_free_space(*next);
+		next = find_free_address(space.ptr);
+	}
+
+	if (next != m_free_addresses.cbegin() && (next - 1)->ptr + (next - 1)->size == space.ptr && space.ptr != ch.memory)
+	{
+		space = pool::space{ (next - 1)->ptr, (next - 1)->size + space.size };
+		erase_free_space(*(next - 1));
+		next = find_free_address(space.ptr);
+	}
+
+	m_free_addresses.insert(next, space);
+
+	auto const by_size = [](pool::space const& lhs, pool::space const& rhs)
+		{
+			return lhs.size < rhs.size || (lhs.size == rhs.size && lhs.ptr < rhs.ptr);
+		};
+	m_free_spaces.insert(std::lower_bound(m_free_spaces.cbegin(), m_free_spaces.cend(), space, by_size), space);
+}
+void pool::erase_free_space(pool::space space)
+{
+	auto const by_size = [](pool::space const& lhs, pool::space const& rhs)
+		{
+			return lhs.size < rhs.size || (lhs.size == rhs.size && lhs.ptr < rhs.ptr);
+		};
+	auto const it = std::lower_bound(m_free_spaces.cbegin(), m_free_spaces.cend(), space, by_size);
+	AGL_ASSERT(it != m_free_spaces.cend() && it->ptr == space.ptr, "not a free space");
+	m_free_spaces.erase(it);
+
+	auto const address = find_free_address(space.ptr);
+	AGL_ASSERT(address != m_free_addresses.cend() && address->ptr == space.ptr, "not a free space");
+	m_free_addresses.erase(address);
+}
+vector<pool::space>::const_iterator pool::find_free_address(std::byte* ptr) const
+{
+	auto comp = [](pool::space const& space, std::byte* ptr)
+		{
+			return space.ptr < ptr;
+		};
+
+	return std::lower_bound(m_free_addresses.cbegin(), m_free_addresses.cend(), ptr, comp);
 }
 vector<pool::space>::const_iterator pool::find_free_space(std::uint64_t size) const
 {
@@ -167,16 +434,306 @@ bool pool::occupied_space_comparator(std::byte* ptr, pool::space const& space)
 {
 	return ptr < space.ptr;
 }
+std::uint64_t pool::get_size_class(std::uint64_t size)
+{
+	return size <= 8 ? 0 : (size + 15) / 16;
+}
+std::uint64_t pool::get_class_size(std::uint64_t size_class)
+{
+	return size_class == 0 ? 8 : size_class * 16;
+}
+std::uint64_t pool::get_class_alignment(std::uint64_t size_class)
+{
+	// slabs are aligned to their size, so every block is aligned to the largest power of two dividing its class size, capped at 16
+	return size_class == 0 ? 8 : 16;
+}
+std::byte* pool::allocate_small(std::uint64_t size_class)
+{
+	auto& cls = m_size_classes[size_class];
+	auto const class_size = get_class_size(size_class);
+
+	auto* ptr = cls.free;
+	if (ptr != nullptr)
+		std::memcpy(&cls.free, ptr, sizeof(std::byte*));
+	else
+	{
+		if (cls.next == cls.end)
+		{
+			// the slab is exhausted, carve a new one from the free spaces
+			auto slab = pop_free_space(slab_size(), slab_size());
+			if (slab.ptr == nullptr && grow(slab_size(), slab_size()))
+				slab = pop_free_space(slab_size(), slab_size());
+
+			if (slab.ptr == nullptr)
+				return nullptr;
+
+			auto& ch = *m_chunks[find_chunk(slab.ptr)];
+			ch.slabs[(reinterpret_cast<std::uintptr_t>(slab.ptr) - ch.slab_base) / slab_size()] = static_cast<std::uint8_t>(size_class + 1);
+			cls.next = slab.ptr;
+			cls.end = slab.ptr + slab_size() / class_size * class_size;
+		}
+
+		ptr = cls.next;
+		cls.next += class_size;
+	}
+
+	m_chunks[find_chunk(ptr)]->occupancy += class_size;
+	m_occupancy += class_size;
+	return ptr;
+}
+void pool::deallocate_small(std::byte* ptr, std::uint64_t size_class)
+{
+	auto& cls = m_size_classes[size_class];
+	std::memcpy(ptr, &cls.free, sizeof(std::byte*));
+	cls.free = ptr;
+	m_occupancy -= get_class_size(size_class);
+}
+void pool::flush_cache(thread_cache& cache, std::uint64_t size_class, std::uint64_t count)
+{
+	auto& cls = cache.classes[size_class];
+	auto const class_size = get_class_size(size_class);
+
+	for (auto i = std::uint64_t{ 0 }; i < count && cls.free != nullptr; ++i)
+	{
+		auto* ptr = cls.free;
+		std::memcpy(&cls.free, ptr, sizeof(std::byte*));
+		--cls.count;
+		cache.cached.store(cache.cached.load(std::memory_order_relaxed) - class_size, std::memory_order_relaxed);
+
+		deallocate_small(ptr, size_class);
+
+		auto const index = find_chunk(ptr);
+		m_chunks[index]->occupancy -= class_size;
+		if (m_chunks[index]->occupancy == 0 && m_chunks.size() > 1)
+			release_chunk(index);
+	}
+}
+pool::thread_cache& pool::get_thread_cache()
+{
+	auto& owner = get_cache_owner();
+	auto const found = owner.caches.find(m_id);
+	if (found != owner.caches.end())
+		return *found->second;
+
+	auto& registry = get_registry();
+	std::lock_guard<std::mutex> registry_lock{ registry.mutex };
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	// ids are never reused, the caches of destroyed pools cannot be reached anymore
+	for (auto it = owner.caches.begin(); it != owner.caches.end();)
+	{
+		if (registry.pools.contains(it->first))
+			++it;
+		else
+			it = owner.caches.erase(it);
+	}
+
+	m_caches.push_back(make_unique<thread_cache>());
+	auto* cache = m_caches.back().get();
+	cache->classes.assign(size_class_count(), cached_class{ nullptr, 0 });
+	cache->cached.store(0);
+	cache->chunks_version = 0;
+
+	owner.caches.emplace({ m_id, cache });
+	return *cache;
+}
+void pool::release_thread_cache(thread_cache& cache)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+	for (auto i = std::uint64_t{ 0 }; i < size_class_count(); ++i)
+		flush_cache(cache, i, cache.classes[i].count);
+
+	auto const comp = [&cache](unique_ptr<thread_cache> const& c)
+		{
+			return c.get() == &cache;
+		};
+	m_caches.erase(std::find_if(m_caches.cbegin(), m_caches.cend(), comp));
+}
+pool::thread_cache_owner& pool::get_cache_owner()
+{
+	thread_local auto owner = thread_cache_owner{};
+	return owner;
+}
+std::uint64_t pool::find_cached_class(thread_cache& cache, std::byte* ptr)
+{
+	// a chunk holding 'ptr' was added before 'ptr' was handed out, so a stale copy would have an older version
+	if (cache.chunks_version != m_chunks_version.load(std::memory_order_acquire))
+	{
+		std::lock_guard<std::mutex> lock{ m_mutex };
+		cache.chunks.resize(0);
+		if (cache.chunks.capacity() < m_chunks.size())
+			cache.chunks.reserve(m_chunks.capacity());
+
+		for (auto& ch : m_chunks)
+			cache.chunks.push_back(chunk_range{ ch->memory, ch->memory + ch->size, ch.get() });
+
+		cache.chunks_version = m_chunks_version.load(std::memory_order_relaxed);
+	}
+
+	auto const comp = [](std::byte* ptr, chunk_range const& rhs)
+		{
+			return ptr < rhs.begin;
+		};
+
+	// the chunk of a live block cannot be released, reading its slabs needs no lock
+	auto const it = std::upper_bound(cache.chunks.cbegin(), cache.chunks.cend(), ptr, comp);
+	if (it == cache.chunks.cbegin() || ptr >= (it - 1)->end)
+		return size_class_count();
+
+	return find_slab_class(*(it - 1)->ch, ptr);
+}
+std::uint64_t pool::find_slab_class(chunk const& ch, std::byte* ptr) const
+{
+	auto const index = (reinterpret_cast<std::uintptr_t>(ptr) - ch.slab_base) / slab_size();
+	if (index >= ch.slabs.size() || ch.slabs[index] == 0)
+		return size_class_count();
+
+	return ch.slabs[index] - 1;
+}
+void pool::add_chunk(std::uint64_t size)
+{
+	auto* memory = static_cast<std::byte*>(nullptr);
+	if ((m_backing & MAPPED) != 0)
+	{
+		auto flags = std::uint32_t{ virtual_memory::NONE };
+		if ((m_backing & HUGE_PAGES) == HUGE_PAGES)
+			flags |= virtual_memory::HUGE_PAGES;
+		if ((m_backing & POPULATE) == POPULATE)
+			flags |= virtual_memory::POPULATE;
+
+		memory = virtual_memory::map(size, flags);
+	}
+	else
+		memory = reinterpret_cast<std::byte*>(std::malloc(size));
+
+	if (memory == nullptr)
+		throw std::exception{ logger::combine_message("not enough memory to allocate pool chunk of {} bytes", size).c_str() };
+
+	auto const address = reinterpret_cast<std::uintptr_t>(memory);
+	auto ch = make_unique<chunk>();
+	ch->memory = memory;
+	ch->size = size;
+	ch->occupancy = 0;
+	ch->slab_base = address - address % slab_size();
+	ch->slabs.assign((address + size - ch->slab_base + slab_size() - 1) / slab_size(), std::uint8_t{ 0 });
+
+	auto const comp = [](unique_ptr<chunk> const& lhs, std::byte* ptr)
+		{
+			return lhs->memory < ptr;
+		};
+
+	m_chunks.insert(std::lower_bound(m_chunks.cbegin(), m_chunks.cend(), memory, comp), std::move(ch));
+	m_chunks_version.fetch_add(1, std::memory_order_release);
+	m_size += size;
+	push_free_space(pool::space{ memory, size });
+}
+void pool::free_chunk(chunk const& ch) const
+{
+	if ((m_backing & MAPPED) == 0)
+	{
+		std::free(ch.memory);
+		return;
+	}
+
+	auto const flags = (m_backing & HUGE_PAGES) == HUGE_PAGES ? virtual_memory::HUGE_PAGES : virtual_memory::NONE;
+	virtual_memory::unmap(ch.memory, ch.size, flags);
+}
+std::uint64_t pool::get_discard_size() const
+{
+	if ((m_backing & MAPPED) == 0)
+		return 0;
+
+	// discarding part of a huge page would split it
+	if ((m_backing & HUGE_PAGES) == HUGE_PAGES)
+		return std::max(discard_threshold(), virtual_memory::huge_page_size());
+
+	return discard_threshold();
+}
+std::uint64_t pool::find_chunk(std::byte* ptr) const
+{
+	auto const comp = [](std::byte* ptr, unique_ptr<chunk> const& rhs)
+		{
+			return ptr < rhs->memory;
+		};
+
+	// the last chunk starting at or before 'ptr'
+	auto const it = std::upper_bound(m_chunks.cbegin(), m_chunks.cend(), ptr, comp);
+	if (it == m_chunks.cbegin() || ptr >= (*(it - 1))->memory + (*(it - 1))->size)
+		return m_chunks.size();
+
+	return static_cast<std::uint64_t>(it - 1 - m_chunks.cbegin());
+}
+bool pool::grow(std::uint64_t size, std::uint64_t alignment)
+{
+	// malloc aligns to 'alignof(std::max_align_t)' only, leave room for any stronger alignment
+	auto const chunk_size = std::max(m_chunk_size, size + alignment);
+	if (m_max_size - m_size < chunk_size)
+		return false;
+
+	add_chunk(chunk_size);
+	return true;
+}
+void pool::release_chunk(std::uint64_t index)
+{
+	auto const& ch = *m_chunks[index];
+	auto* const begin = ch.memory;
+	auto* const end = ch.memory + ch.size;
+
+	// nothing is allocated from the chunk, drop the free blocks and current slabs of the size classes it holds
+	for (auto& cls : m_size_classes)
+	{
+		auto* prev = static_cast<std::byte*>(nullptr);
+		for (auto* block = cls.free; block != nullptr;)
+		{
+			auto* next = static_cast<std::byte*>(nullptr);
+			std::memcpy(&next, block, sizeof(std::byte*));
+
+			if (begin <= block && block < end)
+			{
+				if (prev == nullptr)
+					cls.free = next;
+				else
+					std::memcpy(prev, &next, sizeof(std::byte*));
+			}
+			else
+				prev = block;
+
+			block = next;
+		}
+
+		if (begin <= cls.next && cls.next < end)
+		{
+			cls.next = nullptr;
+			cls.end = nullptr;
+		}
+	}
+
+	// its free spaces are adjacent in address order
+	for (auto it = find_free_address(begin); it != m_free_addresses.cend() && it->ptr < end; it = find_free_address(begin))
+		erase_free_space(*it);
+
+	m_size -= ch.size;
+	free_chunk(ch);
+	m_chunks.erase(m_chunks.cbegin() + index);
+	m_chunks_version.fetch_add(1, std::memory_order_release);
+}
 void pool::on_attach(application* app)
 {
 	auto& log = app->get_resource<agl::logger>();
-	create(10 * 1024 * 1024);
-	log.debug("Pool at {} | {}: OK", m_memory, util::ns::memory_size(size()));
+	create(m_chunk_size);
+	log.debug("Pool at {} | {}: OK", get_chunk_usage(0).memory, util::ns::memory_size(size()));
 }
 void pool::on_detach(application* app)
 {
 	auto& log = app->get_resource<agl::logger>();
-	log.debug("Pool at {} | {}: OFF", m_memory, util::ns::memory_size(size()));
+	auto const frag = get_fragmentation();
+	for (auto i = std::uint64_t{ 0 }; i < chunk_count(); ++i)
+	{
+		auto const usage = get_chunk_usage(i);
+		log.debug("Pool chunk at {} | {}: {} occupied", usage.memory, util::ns::memory_size(usage.size), util::ns::memory_size(usage.occupancy));
+	}
+	log.debug("Pool | {}: {} free blocks, largest {}, fragmentation {}", util::ns::memory_size(size()), frag.free_block_count, util::ns::memory_size(frag.largest_free_block), frag.ratio);
+	log.debug("Pool | {}: OFF", util::ns::memory_size(size()));
 	destroy();
 }
 void pool::on_update(application* app)
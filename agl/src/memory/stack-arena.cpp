@@ -0,0 +1,104 @@
+#include "agl/memory/stack-arena.hpp"
+#include <cstdlib>
+
+namespace agl
+{
+namespace mem
+{
+stack_arena::scope::scope(stack_arena& arena)
+	: m_arena{ arena }
+	, m_marker{ arena.get_marker() }
+{
+}
+stack_arena::scope::~scope()
+{
+	m_arena.rewind(m_marker);
+}
+
+stack_arena& stack_arena::get_thread_stack()
+{
+	thread_local auto stack = stack_arena{};
+	return stack;
+}
+stack_arena::stack_arena(std::uint64_t size)
+	: m_memory{ new std::byte[size] }
+	, m_offset{ 0 }
+	, m_size{ size }
+{
+}
+stack_arena::stack_arena(stack_arena&& other)
+	: m_memory{ other.m_memory }
+	, m_offset{ other.m_offset }
+	, m_overflow{ std::move(other.m_overflow) }
+	, m_size{ other.m_size }
+{
+	other.m_memory = nullptr;
+	other.m_offset = 0;
+	other.m_size = 0;
+}
+stack_arena::~stack_arena()
+{
+	rewind(marker{ 0, 0 });
+	delete[] m_memory;
+}
+std::byte* stack_arena::allocate(std::uint64_t size, std::uint64_t alignment)
+{
+	auto const address = reinterpret_cast<std::uintptr_t>(m_memory) + m_offset;
+	auto const begin = m_offset + (alignment - address % alignment) % alignment;
+	if (begin + size <= m_size)
+	{
+		m_offset = begin + size;
+		return m_memory + begin;
+	}
+
+	// 'std::malloc' aligns to 'alignof(std::max_align_t)' only
+	AGL_ASSERT(alignment <= alignof(std::max_align_t), "alignment not supported by the heap fallback");
+
+	m_overflow.push_back(reinterpret_cast<std::byte*>(std::malloc(size)));
+	return m_overflow.back();
+}
+void stack_arena::deallocate(std::byte* ptr, std::uint64_t size)
+{
+	if (m_memory <= ptr && ptr < m_memory + m_size)
+	{
+		// only the top can be popped, the rest waits for 'rewind'
+		if (ptr + size == m_memory + m_offset)
+			m_offset = static_cast<std::uint64_t>(ptr - m_memory);
+
+		return;
+	}
+
+	// the slot stays, markers count them
+	for (auto i = m_overflow.size(); i > 0; --i)
+		if (m_overflow[i - 1] == ptr)
+		{
+			std::free(ptr);
+			m_overflow[i - 1] = nullptr;
+			break;
+		}
+}
+stack_arena::marker stack_arena::get_marker() const
+{
+	return marker{ m_offset, m_overflow.size() };
+}
+std::uint64_t stack_arena::occupancy() const
+{
+	return m_offset;
+}
+void stack_arena::rewind(marker const& m)
+{
+	// the top may already have been popped below the marker
+	m_offset = std::min(m_offset, m.offset);
+
+	while (m_overflow.size() > m.overflow_count)
+	{
+		std::free(m_overflow.back());
+		m_overflow.pop_back();
+	}
+}
+std::uint64_t stack_arena::size() const
+{
+	return m_size;
+}
+}
+}
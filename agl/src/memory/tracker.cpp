@@ -0,0 +1,233 @@
+#include "agl/memory/tracker.hpp"
+#include <algorithm>
+#include <fstream>
+
+namespace agl
+{
+namespace mem
+{
+namespace
+{
+thread_local void const* current_site = nullptr;
+
+// Type names hold commas, quote them.
+void write_quoted(std::ofstream& file, std::string_view str)
+{
+	file << '"';
+	for (auto c : str)
+	{
+		if (c == '"')
+			file << '"';
+		file << c;
+	}
+	file << '"';
+}
+
+template <typename TStats>
+TStats gone(TStats stats)
+{
+	stats.count = 0;
+	stats.bytes = 0;
+	stats.total_count = 0;
+	return stats;
+}
+
+// Both vectors are sorted according to 'less'.
+template <typename TStats, typename TLess, typename TSubtract>
+std::vector<TStats> diff_stats(std::vector<TStats> const& later, std::vector<TStats> const& earlier, TLess less, TSubtract subtract)
+{
+	auto result = std::vector<TStats>{};
+	auto it = earlier.begin();
+	for (auto const& stats : later)
+	{
+		for (; it != earlier.end() && less(*it, stats); ++it)
+			result.push_back(subtract(gone(*it), *it));
+
+		auto entry = stats;
+		if (it != earlier.end() && !less(stats, *it))
+			entry = subtract(stats, *it++);
+
+		if (entry.count != 0 || entry.bytes != 0 || entry.total_count != 0)
+			result.push_back(entry);
+	}
+
+	for (; it != earlier.end(); ++it)
+		result.push_back(subtract(gone(*it), *it));
+
+	return result;
+}
+}
+
+tracker::snapshot tracker::snapshot::diff(snapshot const& earlier) const
+{
+	auto result = snapshot{};
+	result.m_bytes = m_bytes - earlier.m_bytes;
+	result.m_peak_bytes = m_peak_bytes;
+
+	result.m_types = diff_stats(m_types, earlier.m_types,
+		[](type_stats const& lhs, type_stats const& rhs)
+		{
+			return lhs.type.get_value() < rhs.type.get_value();
+		},
+		[](type_stats lhs, type_stats const& rhs)
+		{
+			lhs.count -= rhs.count;
+			lhs.bytes -= rhs.bytes;
+			lhs.total_count -= rhs.total_count;
+			return lhs;
+		});
+
+	result.m_sites = diff_stats(m_sites, earlier.m_sites,
+		[](site_stats const& lhs, site_stats const& rhs)
+		{
+			return std::make_pair(lhs.site, lhs.type.get_value()) < std::make_pair(rhs.site, rhs.type.get_value());
+		},
+		[](site_stats lhs, site_stats const& rhs)
+		{
+			lhs.count -= rhs.count;
+			lhs.bytes -= rhs.bytes;
+			lhs.total_count -= rhs.total_count;
+			return lhs;
+		});
+
+	return result;
+}
+bool tracker::snapshot::dump(std::string const& path) const
+{
+	auto file = std::ofstream{ path, std::ios::out | std::ios::trunc };
+	if (!file.is_open())
+		return false;
+
+	file << "kind,type,site,count,bytes,peak_bytes,total_count\n";
+	file << "total,,," << 0 << ',' << m_bytes << ',' << m_peak_bytes << ",0\n";
+	for (auto const& t : m_types)
+	{
+		file << "type,";
+		write_quoted(file, t.type.get_name());
+		file << ",," << t.count << ',' << t.bytes << ',' << t.peak_bytes << ',' << t.total_count << '\n';
+	}
+
+	for (auto const& s : m_sites)
+	{
+		file << "site,";
+		write_quoted(file, s.type.get_name());
+		file << ',' << s.site << ',' << s.count << ',' << s.bytes << ",0," << s.total_count << '\n';
+	}
+
+	return file.good();
+}
+tracker::type_stats const* tracker::snapshot::find(type_id_t type) const
+{
+	auto it = std::lower_bound(m_types.begin(), m_types.end(), type.get_value(), [](type_stats const& stats, std::uint64_t id)
+		{
+			return stats.type.get_value() < id;
+		});
+
+	if (it == m_types.end() || it->type != type)
+		return nullptr;
+
+	return &*it;
+}
+std::int64_t tracker::snapshot::get_bytes() const
+{
+	return m_bytes;
+}
+std::int64_t tracker::snapshot::get_peak_bytes() const
+{
+	return m_peak_bytes;
+}
+std::vector<tracker::site_stats> const& tracker::snapshot::get_sites() const
+{
+	return m_sites;
+}
+std::vector<tracker::type_stats> const& tracker::snapshot::get_types() const
+{
+	return m_types;
+}
+
+tracker::site_scope::site_scope(void const* site)
+	: m_previous{ current_site }
+{
+	if (current_site == nullptr)
+		current_site = site;
+}
+tracker::site_scope::~site_scope()
+{
+	current_site = m_previous;
+}
+
+tracker& tracker::get()
+{
+	static auto* instance = new tracker{};
+	return *instance;
+}
+void const* tracker::get_site(void const* fallback)
+{
+	return current_site != nullptr ? current_site : fallback;
+}
+tracker::tracker()
+	: m_bytes{ 0 }
+	, m_peak_bytes{ 0 }
+{
+}
+void tracker::on_allocate(type_id_t type, void const* ptr, std::uint64_t size, void const* site)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	m_allocations[ptr] = allocation{ type, site, size };
+	m_bytes += size;
+	m_peak_bytes = std::max(m_peak_bytes, m_bytes);
+
+	auto t = m_types.try_emplace(type.get_value(), type_stats{ type, 0, 0, 0, 0 }).first;
+	++t->second.count;
+	t->second.bytes += size;
+	t->second.peak_bytes = std::max(t->second.peak_bytes, t->second.bytes);
+	++t->second.total_count;
+
+	auto s = m_sites.try_emplace(std::make_pair(site, type.get_value()), site_stats{ site, type, 0, 0, 0 }).first;
+	++s->second.count;
+	s->second.bytes += size;
+	++s->second.total_count;
+}
+void tracker::on_deallocate(void const* ptr)
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	auto it = m_allocations.find(ptr);
+	if (it == m_allocations.end())
+		return;
+
+	// the size recorded on allocation is the one that counts, deallocations may pass the size of a base class
+	auto const& a = it->second;
+	m_bytes -= a.size;
+
+	auto& t = m_types[a.type.get_value()];
+	--t.count;
+	t.bytes -= a.size;
+
+	auto& s = m_sites[std::make_pair(a.site, a.type.get_value())];
+	--s.count;
+	s.bytes -= a.size;
+
+	m_allocations.erase(it);
+}
+tracker::snapshot tracker::take_snapshot() const
+{
+	std::lock_guard<std::mutex> lock{ m_mutex };
+
+	auto result = snapshot{};
+	result.m_bytes = m_bytes;
+	result.m_peak_bytes = m_peak_bytes;
+
+	result.m_types.reserve(m_types.size());
+	for (auto const& [id, stats] : m_types)
+		result.m_types.push_back(stats);
+
+	result.m_sites.reserve(m_sites.size());
+	for (auto const& [key, stats] : m_sites)
+		result.m_sites.push_back(stats);
+
+	return result;
+}
+}
+}
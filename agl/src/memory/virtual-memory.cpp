@@ -0,0 +1,160 @@
+#include "agl/memory/virtual-memory.hpp"
+#include "agl/core/debug.hpp"
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace agl
+{
+namespace mem
+{
+namespace virtual_memory
+{
+namespace
+{
+std::uint64_t round_up(std::uint64_t size, std::uint64_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+std::uint64_t mapped_size(std::uint64_t size, std::uint32_t flags)
+{
+	return round_up(size, (flags & HUGE_PAGES) != 0 ? huge_page_size() : page_size());
+}
+// Writing a byte per page commits it.
+void touch(std::byte* ptr, std::uint64_t size)
+{
+	auto const step = page_size();
+	for (auto offset = std::uint64_t{ 0 }; offset < size; offset += step)
+		*static_cast<std::byte volatile*>(ptr + offset) = std::byte{ 0 };
+}
+}
+
+#if defined(_WIN32)
+std::uint64_t page_size()
+{
+	static auto const size = []
+		{
+			auto info = SYSTEM_INFO{};
+			GetSystemInfo(&info);
+			return static_cast<std::uint64_t>(info.dwPageSize);
+		}();
+
+	return size;
+}
+std::uint64_t huge_page_size()
+{
+	// large pages need the 'SeLockMemoryPrivilege', without it they are 0 and regular pages are used
+	static auto const size = static_cast<std::uint64_t>(GetLargePageMinimum());
+	return size != 0 ? size : page_size();
+}
+std::byte* map(std::uint64_t size, std::uint32_t flags)
+{
+	auto const total = mapped_size(size, flags);
+	auto* ptr = static_cast<void*>(nullptr);
+	if ((flags & HUGE_PAGES) != 0 && huge_page_size() != page_size())
+		ptr = VirtualAlloc(nullptr, total, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+	// committing only charges the page file, physical pages are still given on first touch
+	if (ptr == nullptr)
+		ptr = VirtualAlloc(nullptr, total, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+	if (ptr != nullptr && (flags & POPULATE) != 0)
+		touch(static_cast<std::byte*>(ptr), total);
+
+	return static_cast<std::byte*>(ptr);
+}
+void unmap(std::byte* ptr, std::uint64_t size, std::uint32_t flags)
+{
+	VirtualFree(ptr, 0, MEM_RELEASE);
+}
+void discard(std::byte* ptr, std::uint64_t size)
+{
+	auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+	auto const begin = round_up(address, page_size());
+	auto const end = (address + size) / page_size() * page_size();
+	if (begin >= end)
+		return;
+
+	// fails on large pages, which cannot be given back anyway
+	VirtualAlloc(reinterpret_cast<void*>(begin), end - begin, MEM_RESET, PAGE_READWRITE);
+}
+#else
+std::uint64_t page_size()
+{
+	static auto const size = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+	return size;
+}
+std::uint64_t huge_page_size()
+{
+	return 2 * 1024 * 1024;
+}
+std::byte* map(std::uint64_t size, std::uint32_t flags)
+{
+	auto const total = mapped_size(size, flags);
+	auto mapping_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+	// huge pages are populated once advised, below
+	if ((flags & POPULATE) != 0 && (flags & HUGE_PAGES) == 0)
+		mapping_flags |= MAP_POPULATE;
+#endif
+
+	if ((flags & HUGE_PAGES) == 0)
+	{
+		auto* ptr = mmap(nullptr, total, PROT_READ | PROT_WRITE, mapping_flags, -1, 0);
+		if (ptr == MAP_FAILED)
+			return nullptr;
+
+#ifndef MAP_POPULATE
+		if ((flags & POPULATE) != 0)
+			touch(static_cast<std::byte*>(ptr), total);
+#endif
+		return static_cast<std::byte*>(ptr);
+	}
+
+	// map one huge page more and trim both ends, so that the mapping starts on a huge page boundary
+	auto const alignment = huge_page_size();
+	auto* ptr = mmap(nullptr, total + alignment, PROT_READ | PROT_WRITE, mapping_flags, -1, 0);
+	if (ptr == MAP_FAILED)
+		return nullptr;
+
+	auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+	auto const begin = round_up(address, alignment);
+	if (begin != address)
+		munmap(ptr, begin - address);
+
+	munmap(reinterpret_cast<void*>(begin + total), address + alignment - begin);
+
+	auto* memory = reinterpret_cast<std::byte*>(begin);
+#ifdef MADV_HUGEPAGE
+	madvise(memory, total, MADV_HUGEPAGE);
+#endif
+
+	if ((flags & POPULATE) != 0)
+		touch(memory, total);
+
+	return memory;
+}
+void unmap(std::byte* ptr, std::uint64_t size, std::uint32_t flags)
+{
+	munmap(ptr, mapped_size(size, flags));
+}
+void discard(std::byte* ptr, std::uint64_t size)
+{
+	auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+	auto const begin = round_up(address, page_size());
+	auto const end = (address + size) / page_size() * page_size();
+	if (begin >= end)
+		return;
+
+	madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+}
+#endif
+}
+}
+}
@@ -1,6 +1,7 @@
 #include "agl/render/opengl/call.hpp"
 #include "agl/render/opengl/shader.hpp"
 #include "agl/core/logger.hpp"
+#include "agl/memory/stack-arena.hpp"
 #include <regex>
 #include <fstream>
 
@@ -36,14 +37,13 @@ static vector<shader_source> parse_shader_source(std::string const& source)
 		shader_type type;
 	};
 
-	auto keywords = std::vector<keyword>{
-		{ std::string::npos, SHADER_VERTEX },
-		{ std::string::npos, SHADER_TESS_CONTROL },
-		{ std::string::npos, SHADER_TESS_EVALUATION },
-		{ std::string::npos, SHADER_GEOMETRY },
-		{ std::string::npos, SHADER_FRAGMENT },
-		{ std::string::npos, SHADER_COMPUTE },
-	};
+	auto& stack = mem::stack_arena::get_thread_stack();
+	auto const scope = mem::stack_arena::scope{ stack };
+
+	auto keywords = mem::stack_vector<keyword>{ stack.make_allocator<keyword>() };
+	keywords.reserve(6);
+	for (auto type : { SHADER_VERTEX, SHADER_TESS_CONTROL, SHADER_TESS_EVALUATION, SHADER_GEOMETRY, SHADER_FRAGMENT, SHADER_COMPUTE })
+		keywords.push_back({ std::string::npos, type });
 
 	for (auto& k : keywords)
 		k.index = source.find(get_sub_shader_type_string(k.type));
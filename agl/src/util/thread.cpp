@@ -5,6 +5,7 @@ namespace agl
 {
 thread::thread()
 	: m_is_running{ false }
+	, m_should_close{ false }
 	//, m_my_cond_var{ nullptr }
 	//, m_my_mutex{ nullptr }
 	, m_internal_id{ threads::invalid_id() }
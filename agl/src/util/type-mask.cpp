@@ -0,0 +1,57 @@
+#include "agl/util/type-mask.hpp"
+
+namespace agl
+{
+type_mask::type_mask(allocator_type const& allocator)
+	: m_words{ allocator }
+{
+}
+void type_mask::clear()
+{
+	m_words.clear();
+}
+bool type_mask::contains(type_mask const& other) const
+{
+	for (auto i = std::uint64_t{ 0 }; i < other.m_words.size(); ++i)
+	{
+		auto const word = i < m_words.size() ? m_words[i] : 0;
+		if ((word & other.m_words[i]) != other.m_words[i])
+			return false;
+	}
+	return true;
+}
+bool type_mask::empty() const
+{
+	for (auto word : m_words)
+		if (word != 0)
+			return false;
+	return true;
+}
+void type_mask::reset(std::uint32_t index)
+{
+	auto const word = index / word_bits();
+	if (word < m_words.size())
+		m_words[word] &= ~(std::uint64_t{ 1 } << (index % word_bits()));
+}
+void type_mask::set(std::uint32_t index)
+{
+	auto const word = index / word_bits();
+	if (word >= m_words.size())
+		m_words.resize(word + 1);
+
+	m_words[word] |= std::uint64_t{ 1 } << (index % word_bits());
+}
+bool type_mask::test(std::uint32_t index) const
+{
+	auto const word = index / word_bits();
+	return word < m_words.size() && (m_words[word] & (std::uint64_t{ 1 } << (index % word_bits()))) != 0;
+}
+bool type_mask::operator==(type_mask const& other) const
+{
+	return contains(other) && other.contains(*this);
+}
+bool type_mask::operator!=(type_mask const& other) const
+{
+	return !(*this == other);
+}
+}
\ No newline at end of file
@@ -1,14 +1,92 @@
 #include <gtest/gtest.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "agl/vector.hpp"
 #include "agl/deque.hpp"
 #include "agl/set.hpp"
+#include "agl/small-vector.hpp"
 #include "agl/util/random.hpp"
 #include "agl/dictionary.hpp"
+#include "agl/hash-map.hpp"
+#include "agl/util/typeid.hpp"
 
 auto const size = 10000;
 
+// Counts the live objects.
+struct counted
+{
+	static inline auto alive = 0;
+
+	counted(int v = 0)
+		: value{ std::to_string(v) }
+	{
+		++alive;
+	}
+	counted(counted const& other)
+		: value{ other.value }
+	{
+		++alive;
+	}
+	counted(counted&& other)
+		: value{ std::move(other.value) }
+	{
+		++alive;
+	}
+	counted& operator=(counted const&) = default;
+	counted& operator=(counted&&) = default;
+	~counted()
+	{
+		--alive;
+	}
+
+	std::string value;
+};
+
+// Opts in to relocation, vectors must never call its move constructor to shift it.
+struct relocated
+{
+	static inline auto moves = 0;
+
+	relocated(int v = 0)
+		: value{ new int{ v } }
+	{
+	}
+	relocated(relocated&& other)
+		: value{ other.value }
+	{
+		other.value = nullptr;
+		++moves;
+	}
+	relocated& operator=(relocated&& other)
+	{
+		std::swap(value, other.value);
+		return *this;
+	}
+	~relocated()
+	{
+		delete value;
+	}
+
+	int* value;
+};
+
+template <>
+struct agl::is_trivially_relocatable<relocated>
+	: std::true_type
+{
+};
+
+// Keys below 200 share home 0, the others a home 1/512th of the capacity further. 0x9E80000000000000 times the Fibonacci multiplier of 'hash_map' is 2^55.
+struct two_homes
+{
+	std::size_t operator()(int key) const
+	{
+		return key < 200 ? 0 : 0x9E80000000000000;
+	}
+};
+
 TEST(vector, vector)
 {
 	auto vec = agl::vector<int>{};
@@ -136,7 +214,7 @@ TEST(vector, vector)
 
 	while (!vec.empty())
 	{
-		auto index = agl::simple_rand(std::uint64_t{}, vec.size() - 1);
+		auto index = agl::simple_rand(std::uint64_t{}, vec.size());
 		vec.erase(vec.cbegin() + index);
 		std_vec.erase(std_vec.cbegin() + index);
 
@@ -267,6 +345,175 @@ TEST(vector, vector_ptr)
 	}
 }
 
+TEST(vector, vector_uninitialized_capacity)
+{
+	{
+		auto vec = agl::vector<counted>{};
+		vec.reserve(size);
+		if (counted::alive != 0)
+			FAIL() << "Capacity was constructed";
+
+		// grows geometrically
+		auto reallocations = 0;
+		auto capacity = vec.capacity();
+		for (auto i = 0; i < 4 * size; ++i)
+		{
+			vec.emplace_back(i);
+			if (vec.capacity() != capacity)
+			{
+				++reallocations;
+				capacity = vec.capacity();
+			}
+		}
+
+		if (reallocations > 3 || counted::alive != 4 * size)
+			FAIL() << "Invalid growth";
+
+		auto std_vec = std::vector<std::string>{};
+		for (auto const& c : vec)
+			std_vec.push_back(c.value);
+
+		vec.insert(vec.cbegin() + 10, counted{ -1 });
+		std_vec.insert(std_vec.cbegin() + 10, "-1");
+		vec.erase(vec.cbegin() + 20, vec.cbegin() + 30);
+		std_vec.erase(std_vec.cbegin() + 20, std_vec.cbegin() + 30);
+		vec.emplace(vec.cbegin(), vec.back());
+		std_vec.insert(std_vec.cbegin(), std_vec.back());
+		vec.resize(size);
+		std_vec.resize(size);
+
+		if (counted::alive != size)
+			FAIL() << "Invalid number of objects";
+
+		for (auto i = 0; i < size; ++i)
+			if (vec[i].value != std_vec[i])
+				FAIL() << "Invalid vector value";
+
+		vec.assign(16, vec[3]);
+		if (counted::alive != 16 || vec.back().value != std_vec[3])
+			FAIL() << "Invalid assignment";
+	}
+
+	if (counted::alive != 0)
+		FAIL() << "Objects were leaked";
+}
+
+TEST(vector, vector_trivially_relocatable)
+{
+	static_assert(agl::is_trivially_relocatable_v<int>);
+	static_assert(agl::is_trivially_relocatable_v<std::pair<agl::type_id_t, agl::vector<counted>>>);
+	static_assert(!agl::is_trivially_relocatable_v<counted>);
+
+	auto vec = agl::vector<relocated>{};
+	for (auto i = 0; i < size; ++i)
+		vec.emplace_back(i);
+
+	vec.erase(vec.cbegin(), vec.cbegin() + 10);
+	if (relocated::moves != 0)
+		FAIL() << "Elements were moved one by one";
+
+	vec.insert(vec.cbegin() + 1, relocated{ -1 });
+	if (relocated::moves > 2 || *vec[1].value != -1)
+		FAIL() << "Invalid insertion";
+
+	for (auto i = 2; i < vec.size(); ++i)
+		if (*vec[i].value != i + 9)
+			FAIL() << "Invalid vector value";
+
+	// sorted insertions at the front shift every pair
+	auto dict = agl::dictionary<int, relocated>{};
+	relocated::moves = 0;
+	for (auto i = 1000; i > 0; --i)
+		*dict[i].value = i;
+
+	// building the pair and inserting it moves a few times per key, shifting one by one would be quadratic
+	if (relocated::moves > 3 * 1000)
+		FAIL() << "Pairs were moved one by one";
+
+	auto key = 1;
+	for (auto const& [k, v] : dict)
+		if (k != key++ || *v.value != k)
+			FAIL() << "Invalid dictionary value";
+
+	// the bulk fill must still value-initialize
+	auto ints = agl::vector<int>{};
+	ints.assign(16, 7);
+	ints.resize(4);
+	ints.resize(16);
+	for (auto i = 0; i < 16; ++i)
+		if (ints[i] != (i < 4 ? 7 : 0))
+			FAIL() << "Invalid resize";
+}
+
+TEST(vector, small_vector)
+{
+	static_assert(agl::is_trivially_relocatable_v<agl::small_vector<int, 2>>);
+	static_assert(!agl::is_trivially_relocatable_v<agl::small_vector<counted, 2>>);
+
+	{
+		auto vec = agl::small_vector<counted, 4>{};
+		auto std_vec = std::vector<std::string>{};
+		for (auto i = 0; i < 4; ++i)
+		{
+			vec.emplace_back(i);
+			std_vec.push_back(std::to_string(i));
+		}
+
+		if (!vec.is_inline() || vec.capacity() != 4)
+			FAIL() << "Inline elements were allocated";
+
+		for (auto i = 4; i < 100; ++i)
+		{
+			vec.emplace(vec.cbegin() + i / 2, vec.back());
+			std_vec.insert(std_vec.cbegin() + i / 2, std_vec.back());
+		}
+
+		if (vec.is_inline() || counted::alive != 100)
+			FAIL() << "Invalid spill";
+
+		vec.erase(vec.cbegin() + 1, vec.cend() - 1);
+		std_vec.erase(std_vec.cbegin() + 1, std_vec.cend() - 1);
+		vec.shrink_to_fit();
+		if (!vec.is_inline() || counted::alive != 2)
+			FAIL() << "Elements were not moved back inline";
+
+		auto copy = vec;
+		auto moved = std::move(vec);
+		if (!vec.empty() || copy.size() != 2 || moved.size() != 2)
+			FAIL() << "Invalid copy";
+
+		for (auto i = 0; i < 2; ++i)
+			if (copy[i].value != std_vec[i] || moved[i].value != std_vec[i])
+				FAIL() << "Invalid small_vector value";
+
+		copy.resize(50);
+		copy.clear();
+		if (!copy.is_inline() || counted::alive != 2)
+			FAIL() << "Invalid clear";
+
+		copy = moved;
+		if (copy.size() != 2 || copy[1].value != std_vec[1])
+			FAIL() << "Invalid assignment";
+	}
+
+	if (counted::alive != 0)
+		FAIL() << "Objects were leaked";
+
+	// relocated with 'std::memmove' by the outer vector, inline ones included
+	auto nested = agl::vector<agl::small_vector<int, 2>>{};
+	for (auto i = 0; i < size; ++i)
+	{
+		nested.emplace_back();
+		for (auto j = 0; j <= i % 4; ++j)
+			nested.back().push_back(i + j);
+	}
+
+	for (auto i = 0; i < size; ++i)
+		for (auto j = 0; j <= i % 4; ++j)
+			if (nested[i][j] != i + j)
+				FAIL() << "Invalid nested value";
+}
+
 TEST(deque, deque)
 {
 	auto deq = agl::deque<int>{};
@@ -576,6 +823,86 @@ TEST(dictionary, dictionary)
 	}
 }
 
+TEST(hash_map, hash_map)
+{
+	{
+		auto map = agl::hash_map<int, counted>{};
+		auto std_map = std::unordered_map<int, std::string>{};
+
+		// random inserts and erasures, keys collide on purpose
+		for (auto i = 0; i < 8 * size; ++i)
+		{
+			auto const key = agl::simple_rand(0, size);
+			if (agl::simple_rand(0, 3) != 0)
+			{
+				map[key] = counted{ i };
+				std_map[key] = std::to_string(i);
+			}
+			else if (map.erase(key) != (std_map.erase(key) != 0))
+				FAIL() << "Invalid hash_map erase [ 0 ]";
+		}
+
+		if (map.size() != std_map.size() || counted::alive != map.size())
+			FAIL() << "Invalid hash_map size [ 0 ]";
+
+		for (auto const& [key, value] : std_map)
+			if (!map.contains(key) || map.at(key).value != value)
+				FAIL() << "Invalid hash_map value [ 0 ]";
+
+		auto iterated = std::uint64_t{ 0 };
+		for (auto const& [key, value] : map)
+			if (std_map.at(key) == value.value)
+				++iterated;
+
+		if (iterated != map.size())
+			FAIL() << "Invalid hash_map iteration";
+
+		auto copy = map;
+		for (auto it = map.begin(); it != map.end();)
+			if (it->first % 2 == 0)
+				it = map.erase(it);
+			else
+				++it;
+
+		for (auto const& [key, value] : std_map)
+			if (map.contains(key) == (key % 2 == 0) || copy.at(key).value != value)
+				FAIL() << "Invalid hash_map value [ 1 ]";
+
+		auto moved = std::move(copy);
+		if (!copy.empty() || moved.size() != std_map.size())
+			FAIL() << "Invalid hash_map size [ 1 ]";
+
+		moved.clear();
+		if (!moved.empty() || counted::alive != map.size())
+			FAIL() << "Invalid hash_map size [ 2 ]";
+	}
+
+	if (counted::alive != 0)
+		FAIL() << "Objects were leaked";
+
+	auto types = agl::hash_map<agl::type_id_t, int>{};
+	types.reserve(3);
+	auto const capacity = types.capacity();
+	types.emplace({ agl::type_id<int>::get_id(), 0 });
+	types.emplace({ agl::type_id<float>::get_id(), 1 });
+	types[agl::type_id<counted>::get_id()] = 2;
+	if (types.capacity() != capacity || types.at(agl::type_id<float>::get_id()) != 1 || types.find(agl::type_id<double>::get_id()) != types.end())
+		FAIL() << "Invalid type lookup";
+
+	// the homes of both groups are next to each other, the second group is pushed far from its home until the table grew enough
+	auto clustered = agl::hash_map<int, int, two_homes>{};
+	for (auto i = 0; i < 300; ++i)
+		clustered[i] = i;
+
+	clustered.reserve(4 * clustered.capacity());
+	for (auto i = 0; i < 300; i += 2)
+		clustered.erase(i);
+
+	for (auto i = 0; i < 300; ++i)
+		if (clustered.contains(i) != (i % 2 == 1) || (i % 2 == 1 && clustered.at(i) != i))
+			FAIL() << "Invalid clustered value";
+}
+
 TEST(set, set)
 {
 	struct foo 
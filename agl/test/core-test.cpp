@@ -0,0 +1,352 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "agl/core/application.hpp"
+#include "agl/core/jobs.hpp"
+#include "agl/core/logger.hpp"
+#include "agl/core/threads.hpp"
+#include "agl/util/mpsc-ring.hpp"
+
+struct indexed final
+	: agl::resource<indexed>
+{
+	virtual void on_attach(agl::application*) override {}
+	virtual void on_detach(agl::application*) override {}
+	virtual void on_update(agl::application*) override {}
+};
+
+// Registered without an index, 'get_resource<T>' finds it through the locked lookup.
+struct unindexed final
+	: agl::resource_base
+{
+	unindexed()
+		: resource_base{ agl::type_id<unindexed>::get_id() }
+	{
+	}
+	virtual void on_attach(agl::application*) override {}
+	virtual void on_detach(agl::application*) override {}
+	virtual void on_update(agl::application*) override {}
+
+	int value = 7;
+};
+
+// Looks 'unindexed' up from 'on_detach', which runs with the mutex of the application held.
+struct dependent final
+	: agl::resource<dependent>
+{
+	static inline auto found = 0;
+
+	virtual void on_attach(agl::application*) override {}
+	virtual void on_detach(agl::application* app) override
+	{
+		found = app->get_resource<unindexed>().value;
+	}
+	virtual void on_update(agl::application*) override {}
+};
+
+TEST(core, jobs)
+{
+	auto workers = agl::jobs{ 4 };
+	static_cast<agl::resource_base&>(workers).on_attach(nullptr);
+
+	{ // handles and continuations
+		auto value = std::atomic<int>{ 0 };
+		auto first = workers.run([&value]() { value = 1; });
+		auto second = workers.then(first, [&value]() { value = value * 10; });
+		second.wait();
+
+		if (!first.is_done() || value != 10)
+			FAIL() << "Continuation ran before its job [ 0 ]";
+	}
+	{ // children
+		auto count = std::atomic<int>{ 0 };
+		auto release = std::atomic<bool>{ false };
+		auto parent = workers.run([&release]()
+			{
+				while (!release)
+					std::this_thread::yield();
+			});
+
+		for (auto i = 0; i < 64; ++i)
+			workers.run(parent, [&count]() { ++count; });
+
+		release = true;
+		parent.wait();
+
+		if (count != 64)
+			FAIL() << "Parent done before its children [ 0 ]";
+	}
+	{ // parallel for
+		auto values = std::vector<int>(100000, 1);
+		auto sums = std::vector<std::uint64_t>(values.size(), 0);
+
+		workers.parallel_for(0, values.size(), 1000, [&values, &sums](std::uint64_t first, std::uint64_t last)
+			{
+				for (auto i = first; i < last; ++i)
+					sums[i] = static_cast<std::uint64_t>(values[i]) * 2;
+			});
+
+		for (auto sum : sums)
+			if (sum != 2)
+				FAIL() << "Range not processed [ 0 ]";
+
+		// waiting from inside a job executes other jobs instead of blocking a worker
+		auto total = std::atomic<std::uint64_t>{ 0 };
+		workers.parallel_for(0, 8, 1, [&workers, &total](std::uint64_t, std::uint64_t)
+			{
+				workers.parallel_for(0, 1000, 10, [&total](std::uint64_t first, std::uint64_t last) { total += last - first; });
+			});
+
+		if (total != 8000)
+			FAIL() << "Nested range not processed [ 0 ]";
+	}
+	{ // fire-and-forget, all of them run before detaching returns
+		auto count = std::atomic<int>{ 0 };
+		for (auto i = 0; i < 10000; ++i)
+			workers.run([&count]() { ++count; });
+
+		static_cast<agl::resource_base&>(workers).on_detach(nullptr);
+
+		if (count != 10000)
+			FAIL() << "Queued jobs were dropped [ 0 ]";
+	}
+}
+
+
+TEST(core, mpsc_ring)
+{
+	{ // every element of every producer arrives, in order per producer
+		auto ring = agl::mpsc_ring<std::uint64_t>{ 100 };
+		if (ring.capacity() != 128 || !ring.empty())
+			FAIL() << "Invalid capacity [ 0 ]";
+
+		auto producers = std::vector<std::thread>{};
+		for (auto p = std::uint64_t{ 0 }; p < 4; ++p)
+			producers.emplace_back([&ring, p]()
+				{
+					for (auto i = std::uint64_t{ 0 }; i < 20000; ++i)
+						ring.push([p, i](std::uint64_t& value) { value = p << 32 | i; });
+				});
+
+		auto next = std::vector<std::uint64_t>(4, 0);
+		auto received = 0;
+		while (received < 4 * 20000)
+			if (ring.pop([&next](std::uint64_t& value)
+				{
+					if ((value & 0xffffffff) != next[value >> 32]++)
+						FAIL() << "Invalid order [ 0 ]";
+				}))
+				++received;
+
+		for (auto& producer : producers)
+			producer.join();
+
+		if (!ring.empty() || ring.dropped() != 0)
+			FAIL() << "Invalid state [ 0 ]";
+	}
+	{ // drop newest keeps the first elements
+		auto ring = agl::mpsc_ring<int>{ 4, agl::DROP_NEWEST };
+		for (auto i = 0; i < 10; ++i)
+			ring.push([i](int& value) { value = i; });
+
+		auto values = std::vector<int>{};
+		while (ring.pop([&values](int& value) { values.push_back(value); }))
+			;
+
+		if (values != std::vector<int>{ 0, 1, 2, 3 } || ring.dropped() != 6)
+			FAIL() << "Invalid drop [ 0 ]";
+	}
+	{ // drop oldest keeps the last elements
+		auto ring = agl::mpsc_ring<int>{ 4, agl::DROP_OLDEST };
+		for (auto i = 0; i < 10; ++i)
+			ring.push([i](int& value) { value = i; });
+
+		auto values = std::vector<int>{};
+		while (ring.pop([&values](int& value) { values.push_back(value); }))
+			;
+
+		if (values != std::vector<int>{ 6, 7, 8, 9 } || ring.dropped() != 6)
+			FAIL() << "Invalid drop [ 1 ]";
+	}
+	{ // drop oldest waits for the slot the consumer is reading instead of evicting the elements behind it
+		auto ring = agl::mpsc_ring<int>{ 4, agl::DROP_OLDEST };
+		for (auto i = 0; i < 4; ++i)
+			ring.push([i](int& value) { value = i; });
+
+		auto reading = std::atomic<bool>{ false };
+		auto release = std::atomic<bool>{ false };
+		auto consumer = std::thread{ [&ring, &reading, &release]()
+			{
+				ring.pop([&reading, &release](int&)
+					{
+						reading = true;
+						while (!release)
+							std::this_thread::yield();
+					});
+			} };
+		while (!reading)
+			std::this_thread::yield();
+
+		auto producer = std::thread{ [&ring]() { ring.push([](int& value) { value = 4; }); } };
+
+		// lets the producer find the slot taken, the outcome does not depend on it
+		std::this_thread::sleep_for(std::chrono::milliseconds{ 10 });
+		release = true;
+		consumer.join();
+		producer.join();
+
+		auto values = std::vector<int>{};
+		while (ring.pop([&values](int& value) { values.push_back(value); }))
+			;
+
+		if (values != std::vector<int>{ 1, 2, 3, 4 } || ring.dropped() != 0)
+			FAIL() << "Invalid drop [ 2 ]";
+	}
+	{ // drop oldest with a slow consumer, every element is either received in order or counted as dropped
+		auto ring = agl::mpsc_ring<std::uint64_t>{ 16, agl::DROP_OLDEST };
+		auto finished = std::atomic<int>{ 0 };
+		auto producers = std::vector<std::thread>{};
+		for (auto p = std::uint64_t{ 0 }; p < 4; ++p)
+			producers.emplace_back([&ring, &finished, p]()
+				{
+					for (auto i = std::uint64_t{ 0 }; i < 2000; ++i)
+						ring.push([p, i](std::uint64_t& value) { value = p << 32 | i; });
+					++finished;
+				});
+
+		auto next = std::vector<std::uint64_t>(4, 0);
+		auto received = std::uint64_t{ 0 };
+		auto ordered = true;
+		auto take = [&next, &ordered](std::uint64_t& value)
+			{
+				// gaps are the dropped elements, what arrives still comes in order
+				if ((value & 0xffffffff) < next[value >> 32])
+					ordered = false;
+				next[value >> 32] = (value & 0xffffffff) + 1;
+				std::this_thread::sleep_for(std::chrono::microseconds{ 20 });
+			};
+		while (finished != 4 || !ring.empty())
+			if (ring.pop(take))
+				++received;
+
+		for (auto& producer : producers)
+			producer.join();
+
+		if (!ordered || received + ring.dropped() != 4 * 2000)
+			FAIL() << "Invalid drop [ 3 ]";
+	}
+}
+
+TEST(core, deferred_log_arguments)
+{
+	auto const text = std::string{ "world" };
+	auto const* literal = "users";
+	auto bytes = std::vector<std::byte>(agl::logger::max_argument_bytes());
+
+	auto* dest = bytes.data();
+	dest = agl::impl::log_argument<int>::write(dest, -5);
+	dest = agl::impl::log_argument<std::string>::write(dest, text);
+	dest = agl::impl::log_argument<char const*>::write(dest, literal);
+	dest = agl::impl::log_argument<double>::write(dest, 0.5);
+	if (dest - bytes.data() != sizeof(int) + 4 + 5 + 4 + 5 + sizeof(double))
+		FAIL() << "Invalid size [ 0 ]";
+
+	// strings are copied, the message does not point to the caller's memory
+	auto const* src = static_cast<std::byte const*>(bytes.data());
+	if (agl::impl::log_argument<int>::read(src) != -5 || agl::impl::log_argument<std::string>::read(src) != "world" || agl::impl::log_argument<char const*>::read(src) != "users" || agl::impl::log_argument<double>::read(src) != 0.5)
+		FAIL() << "Invalid value [ 0 ]";
+
+	// null strings are written as text
+	auto const* missing = static_cast<char const*>(nullptr);
+	src = bytes.data();
+	agl::impl::log_argument<char const*>::write(bytes.data(), missing);
+	if (agl::impl::log_argument<char const*>::size(missing) != 4 + 6 || agl::impl::log_argument<char const*>::read(src) != "(null)")
+		FAIL() << "Invalid value [ 1 ]";
+
+	if (AGL_LOG_FORMAT("{} world").text() != std::string_view{ "{} world" })
+		FAIL() << "Invalid format [ 0 ]";
+}
+
+TEST(core, resource_table)
+{
+	auto app = agl::application{};
+	app.add_resource(agl::make_unique<agl::resource_base>(agl::threads{}));
+	app.add_resource(agl::make_unique<agl::resource_base>(agl::logger{}));
+	auto const* log = &app.get_resource<agl::logger>();
+
+	// readers do not lock, the table they read gets replaced meanwhile
+	auto stop = std::atomic<bool>{ false };
+	auto mismatches = std::atomic<int>{ 0 };
+	auto readers = std::vector<std::thread>{};
+	for (auto i = 0; i < 4; ++i)
+		readers.emplace_back([&app, &stop, &mismatches, log]()
+			{
+				while (!stop)
+					if (&app.get_resource<agl::logger>() != log)
+						++mismatches;
+			});
+
+	for (auto i = 0; i < 1000; ++i)
+	{
+		app.add_resource(agl::make_unique<agl::resource_base>(indexed{}));
+		if (!app.has_resource<indexed>())
+			++mismatches;
+
+		app.remove_resource<indexed>();
+	}
+
+	stop = true;
+	for (auto& reader : readers)
+		reader.join();
+
+	if (mismatches != 0)
+		FAIL() << "Invalid resource while publishing";
+
+	// replaced tables outlive the frame they were replaced in, then they are freed
+	app.reclaim_tables();
+	if (app.resource_tables() == 1)
+		FAIL() << "Replaced tables freed too early";
+
+	app.reclaim_tables();
+	if (app.resource_tables() != 1)
+		FAIL() << "Replaced tables kept alive";
+}
+
+TEST(core, resource_lookup_on_detach)
+{
+	auto app = agl::application{};
+	app.add_resource(agl::make_unique<agl::resource_base>(agl::threads{}));
+	app.add_resource(agl::make_unique<agl::resource_base>(agl::logger{}));
+	app.add_resource(agl::make_unique<agl::resource_base>(unindexed{}));
+	app.add_resource(agl::make_unique<agl::resource_base>(dependent{}));
+
+	// 'remove_resource' holds the mutex while 'dependent' looks 'unindexed' up
+	dependent::found = 0;
+	app.remove_resource<dependent>();
+	if (dependent::found != 7 || app.has_resource<dependent>())
+		FAIL() << "Lookup from 'on_detach' failed";
+}
+
+TEST(core, deferred_log)
+{
+	// the outputs of the logger are set to 'std::cout' on attach
+	auto captured = std::stringstream{};
+	auto* const previous = std::cout.rdbuf(captured.rdbuf());
+	{
+		auto app = agl::application{};
+		app.add_resource(agl::make_unique<agl::resource_base>(agl::threads{}));
+		app.add_resource(agl::make_unique<agl::resource_base>(agl::logger{}));
+
+		auto const* missing = static_cast<char const*>(nullptr);
+		app.get_resource<agl::logger>().info(AGL_LOG_FORMAT("{} users, {} and {}"), 3, missing, std::string{ "world" });
+	} // closing the application joins the listening thread, which writes every pending message first
+	std::cout.rdbuf(previous);
+
+	if (captured.str().find("[INFO] 3 users, (null) and world\n") == std::string::npos)
+		FAIL() << "Invalid deferred message";
+}
\ No newline at end of file
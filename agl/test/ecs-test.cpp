@@ -1,4 +1,7 @@
 #include <gtest/gtest.h>
+#include <mutex>
+#include <vector>
+#include "agl/core/jobs.hpp"
 #include "agl/ecs/ecs.hpp"
 
 /*
@@ -45,4 +48,614 @@ TEST(ECS, ecs)
 
 
 }
-*/
\ No newline at end of file
+*/
+TEST(ECS, archetype_storage)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(64 * 1024 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>(), agl::ecs::ARCHETYPE_STORAGE, 1024 };
+		auto entities = std::vector<agl::ecs::entity>{};
+
+		for (auto i = 0; i < 1000; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities[i], i);
+			ecs.push_component<int>(entities[i], i + 1);
+			ecs.push_component<float>(entities[i], static_cast<float>(i));
+		}
+
+		for (auto i = 0; i < 1000; ++i)
+		{
+			if (entities[i].size<int>() != 2)
+				FAIL() << "Invalid component count size [ 0 ]";
+
+			if (entities[i].get_component<int>(0) != i || entities[i].get_component<int>(1) != i + 1)
+				FAIL() << "Invalid value after insertion [ 0 ]";
+
+			if (entities[i].get_component<float>(0) != i)
+				FAIL() << "Invalid value after insertion [ 1 ]";
+		}
+
+		// pop the first 'int', the second one must take its index
+		for (auto i = 0; i < 1000; i += 2)
+			ecs.pop_component<int>(entities[i], 0);
+
+		for (auto i = 0; i < 1000; i += 2)
+			if (entities[i].size<int>() != 1 || entities[i].get_component<int>(0) != i + 1)
+				FAIL() << "Invalid value after removal [ 0 ]";
+
+		auto count = 0;
+		ecs.for_each<float, int>([&count](float& f, int& v)
+			{
+				if (static_cast<int>(f) != v && static_cast<int>(f) + 1 != v)
+					++count;
+				f += 1.f;
+			});
+
+		if (count != 0)
+			FAIL() << "Invalid value during iteration [ 0 ]";
+
+		for (auto i = 0; i < 1000; i += 3)
+			ecs.destroy_entity(entities[i]);
+
+		for (auto i = 0; i < 1000; ++i)
+			if (i % 3 != 0 && entities[i].get_component<float>(0) != i + 1)
+				FAIL() << "Invalid value after destruction [ 0 ]";
+
+		if (ecs.get_component_count<float>() != 666)
+			FAIL() << "Invalid component count [ 0 ]";
+
+		for (auto i = 0; i < 1000; ++i)
+			if (i % 3 != 0)
+				ecs.destroy_entity(entities[i]);
+	}
+}
+
+TEST(ECS, query)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(64 * 1024 * 1024);
+
+	for (auto storage : { agl::ecs::SPARSE_STORAGE, agl::ecs::ARCHETYPE_STORAGE })
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>(), storage };
+		auto entities = std::vector<agl::ecs::entity>{};
+
+		// registered before any entity exists, must be kept up to date
+		auto& q = ecs.get_query<int, float>();
+
+		for (auto i = 0; i < 100; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities[i], i);
+			if (i % 2 == 0)
+				ecs.push_component<float>(entities[i], static_cast<float>(i));
+		}
+
+		if (q.size() != 50 || &q != &ecs.get_query<int, float>())
+			FAIL() << "Invalid query size [ 0 ]";
+
+		auto sum = 0;
+		q.for_each([&sum](int& v, float& f)
+			{
+				if (static_cast<int>(f) != v)
+					++sum;
+			});
+
+		if (sum != 0)
+			FAIL() << "Invalid value during iteration [ 0 ]";
+
+		for (auto i = 0; i < 100; i += 4)
+			ecs.pop_components<float>(entities[i]);
+
+		for (auto i = 1; i < 100; i += 2)
+			ecs.destroy_entity(entities[i]);
+
+		if (q.size() != 25 || ecs.view<int, float>().size() != 25)
+			FAIL() << "Invalid query size [ 1 ]";
+
+		// recycled entity indexes must not confuse the query
+		for (auto i = 1; i < 100; i += 2)
+		{
+			entities[i] = ecs.make_entity();
+			ecs.push_component<float>(entities[i], 0.f);
+			ecs.push_component<int>(entities[i], 0);
+		}
+
+		if (q.size() != 75)
+			FAIL() << "Invalid query size [ 2 ]";
+
+		auto count = 0;
+		q.for_each_entity([&count](agl::ecs::entity ent, int&, float&)
+			{
+				if (ent.has_component<int>() && ent.has_component<float>())
+					++count;
+			});
+
+		if (count != 75)
+			FAIL() << "Invalid entity during iteration [ 0 ]";
+
+		for (auto& ent : entities)
+			ecs.destroy_entity(ent);
+
+		if (!q.empty())
+			FAIL() << "Invalid query size [ 3 ]";
+	}
+}
+
+TEST(ECS, entity_handle)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(16 * 1024 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>() };
+
+		auto ent = ecs.make_entity();
+		ecs.push_component<int>(ent, 5);
+
+		auto copy = ent;
+		if (!copy.is_valid() || copy != ent || !ecs.is_alive(copy))
+			FAIL() << "Invalid handle [ 0 ]";
+
+		ecs.destroy_entity(ent);
+		if (copy.is_valid() || ecs.is_alive(copy) || !ent.empty())
+			FAIL() << "Handle valid after destruction [ 0 ]";
+
+		// the slot gets reused with a new generation
+		auto reused = ecs.make_entity();
+		if (reused.index() != copy.index() || reused.generation() == copy.generation() || copy.is_valid())
+			FAIL() << "Invalid slot reuse [ 0 ]";
+
+		auto entities = std::vector<agl::ecs::entity>{};
+		for (auto i = 0; i < 1000; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities.back(), i);
+		}
+
+		// the table grows, handles must keep pointing to the right components
+		for (auto i = 0; i < 1000; ++i)
+			if (!entities[i].is_valid() || entities[i].get_component<int>(0) != i)
+				FAIL() << "Invalid value after growth [ 0 ]";
+
+		for (auto& e : entities)
+			ecs.destroy_entity(e);
+		ecs.destroy_entity(reused);
+	}
+}
+
+TEST(ECS, organizer_move)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(16 * 1024 * 1024);
+
+	for (auto storage : { agl::ecs::SPARSE_STORAGE, agl::ecs::ARCHETYPE_STORAGE })
+	{ // ensure pool gets destroyed as last
+		auto source = agl::ecs::organizer{ pool.make_allocator<int>(), storage };
+		auto& q = source.get_query<int>();
+
+		auto ent = source.make_entity();
+		source.push_component<int>(ent, 5);
+		source.get_command_buffer().push_component<float>(ent, 1.f);
+
+		// queries, recorded commands and entity handles follow the organizer
+		auto ecs = std::move(source);
+		ecs.play_commands();
+
+		if (!ent.is_valid() || !ecs.is_alive(ent) || ent.get_component<int>(0) != 5 || ent.get_component<float>(0) != 1.f)
+			FAIL() << "Invalid handle after move [ 0 ]";
+
+		auto entities = std::vector<agl::ecs::entity>{};
+		q.for_each_entity([&entities](agl::ecs::entity e, int& v)
+			{
+				if (v == 5 && e.has_component<float>())
+					entities.push_back(e);
+			});
+
+		if (entities.size() != 1 || &q != &ecs.get_query<int>())
+			FAIL() << "Invalid query after move [ 0 ]";
+
+		entities.push_back(ecs.make_entity());
+		ecs.push_component<int>(entities.back(), 6);
+		if (q.size() != 2)
+			FAIL() << "Invalid query after move [ 1 ]";
+
+		for (auto& e : entities)
+			ecs.destroy_entity(e);
+	}
+}
+
+TEST(ECS, component_removal)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(64 * 1024 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>() };
+		auto entities = std::vector<agl::ecs::entity>{};
+
+		for (auto i = 0; i < 2000; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities[i], i);
+			ecs.push_component<int>(entities[i], -i);
+			ecs.push_component<std::uint64_t>(entities[i], static_cast<std::uint64_t>(i));
+		}
+
+		// removals move the last components of the storage, every entity must still see its own values
+		for (auto i = 0; i < 2000; i += 2)
+			ecs.pop_component<int>(entities[i], 0);
+
+		for (auto i = 0; i < 2000; ++i)
+		{
+			auto const expected = i % 2 == 0 ? 1u : 2u;
+			if (entities[i].size<int>() != expected || entities[i].get_component<int>(expected - 1) != -i)
+				FAIL() << "Invalid value after removal [ 0 ]";
+
+			if (i % 2 == 1 && entities[i].get_component<int>(0) != i)
+				FAIL() << "Invalid value after removal [ 1 ]";
+
+			if (entities[i].get_component<std::uint64_t>(0) != static_cast<std::uint64_t>(i))
+				FAIL() << "Invalid value after removal [ 2 ]";
+		}
+
+		for (auto i = 0; i < 2000; i += 3)
+			ecs.destroy_entity(entities[i]);
+
+		if (ecs.get_component_count<std::uint64_t>() != 1333)
+			FAIL() << "Invalid component count [ 0 ]";
+
+		for (auto i = 0; i < 2000; ++i)
+			if (i % 3 != 0 && entities[i].get_component<std::uint64_t>(0) != static_cast<std::uint64_t>(i))
+				FAIL() << "Invalid value after destruction [ 0 ]";
+
+		for (auto& ent : entities)
+			ecs.destroy_entity(ent);
+
+		if (ecs.get_component_count<int>() != 0 || ecs.get_component_count<std::uint64_t>() != 0)
+			FAIL() << "Invalid component count [ 1 ]";
+	}
+}
+
+TEST(ECS, component_mask)
+{
+	struct family;
+	auto const first = agl::type_index<int, family>::get();
+	auto const second = agl::type_index<float, family>::get();
+	if (first == second || agl::type_index<int const, family>::get() != first || agl::type_index<int, family>::count() < 2)
+		FAIL() << "Invalid type index [ 0 ]";
+
+	auto pool = agl::mem::pool{};
+	pool.create(16 * 1024 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto mask = agl::type_mask::make<family, int>(pool.make_allocator<std::uint64_t>());
+		mask.set(200);
+		if (!mask.test(first) || mask.test(second) || !mask.test(200) || mask.test(1000))
+			FAIL() << "Invalid mask [ 0 ]";
+
+		// the first words are inline, comparing them allocates nothing
+		if (!mask.contains(agl::type_mask::make<family, int>()) || mask.contains(agl::type_mask::make<family, int, float>()))
+			FAIL() << "Invalid mask [ 1 ]";
+
+		mask.reset(200);
+		if (mask != agl::type_mask::make<family, int>() || !agl::type_mask{}.empty())
+			FAIL() << "Invalid mask [ 2 ]";
+	}
+
+	for (auto storage : { agl::ecs::SPARSE_STORAGE, agl::ecs::ARCHETYPE_STORAGE })
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>(), storage };
+
+		auto ent = ecs.make_entity();
+		ecs.push_component<int>(ent, 1);
+		ecs.push_component<int>(ent, 2);
+		ecs.push_component<float>(ent, 3.f);
+		if (!ent.has_component<int, float>() || ent.has_component<int, double>() || !ent.has_component<float>())
+			FAIL() << "Invalid component check [ 0 ]";
+
+		// the type stays in the mask until its last instance is gone
+		ecs.pop_component<int>(ent, 0);
+		if (!ent.has_component<int>() || ent.get_component<int>(0) != 2)
+			FAIL() << "Invalid component check [ 1 ]";
+
+		ecs.pop_component<int>(ent, 0);
+		ecs.push_component<double>(ent, 4.0);
+		if (ent.has_component<int>() || !ent.has_component<float, double>())
+			FAIL() << "Invalid component check [ 2 ]";
+
+		ecs.pop_components<float>(ent);
+		if (ent.has_component<float>() || !ent.has_component<double>() || ent.get_component<double>(0) != 4.0)
+			FAIL() << "Invalid component check [ 3 ]";
+
+		ecs.destroy_entity(ent);
+	}
+}
+
+namespace
+{
+// Start and end of every system update in the order they happened, checked once the updates returned.
+struct update_trace
+{
+	struct event
+	{
+		int system;
+		bool begin;
+	};
+
+	void record(int system, bool begin)
+	{
+		std::lock_guard<std::mutex> lock{ mutex };
+		events.push_back({ system, begin });
+	}
+
+	std::mutex mutex;
+	std::vector<event> events;
+};
+
+template <int TIndex>
+class int_writer
+	: public agl::ecs::system<int_writer<TIndex>>
+{
+public:
+	int_writer(update_trace* trace)
+		: agl::ecs::system<int_writer<TIndex>>{ agl::ecs::PRE_RENDER }
+		, m_trace{ trace }
+	{
+		this->template writes<int>();
+	}
+	virtual void on_attach(agl::application*) override {}
+	virtual void on_detach(agl::application*) override {}
+	virtual void on_update(agl::application*) override
+	{
+		m_trace->record(TIndex, true);
+		this->get_organizer().template for_each<int>([](int& v) { ++v; });
+		m_trace->record(TIndex, false);
+	}
+
+	update_trace* m_trace;
+};
+
+class int_to_float
+	: public agl::ecs::system<int_to_float>
+{
+public:
+	int_to_float(update_trace* trace)
+		: agl::ecs::system<int_to_float>{ agl::ecs::PRE_RENDER }
+		, m_trace{ trace }
+	{
+		reads<int>();
+		writes<float>();
+	}
+	virtual void on_attach(agl::application*) override {}
+	virtual void on_detach(agl::application*) override {}
+	virtual void on_update(agl::application*) override
+	{
+		m_trace->record(2, true);
+		get_organizer().for_each<int, float>([](int& v, float& f) { f = static_cast<float>(v); });
+		m_trace->record(2, false);
+	}
+
+	update_trace* m_trace;
+};
+
+class main_thread_system
+	: public agl::ecs::system<main_thread_system>
+{
+public:
+	main_thread_system()
+		: agl::ecs::system<main_thread_system>{ agl::ecs::POST_RENDER }
+		, m_thread{ std::this_thread::get_id() }
+		, m_wrong_thread{ false }
+	{
+	}
+	virtual void on_attach(agl::application*) override {}
+	virtual void on_detach(agl::application*) override {}
+	virtual void on_update(agl::application*) override
+	{
+		if (std::this_thread::get_id() != m_thread)
+			m_wrong_thread = true;
+	}
+
+	std::thread::id m_thread;
+	bool m_wrong_thread;
+};
+}
+
+TEST(ECS, scheduler)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(16 * 1024 * 1024);
+
+	auto workers = agl::jobs{ 3 };
+	static_cast<agl::resource_base&>(workers).on_attach(nullptr);
+
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>() };
+		auto entities = std::vector<agl::ecs::entity>{};
+		auto trace = update_trace{};
+
+		ecs.set_jobs(&workers);
+		for (auto i = 0; i < 100; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities[i], i);
+			ecs.push_component<float>(entities[i], 0.f);
+		}
+
+		// added in reverse stage order, the scheduler must still run 'PRE_RENDER' first
+		ecs.add_system(nullptr, agl::mem::make_unique<agl::ecs::system_base>(pool.make_allocator<int>(), main_thread_system{}));
+		ecs.add_system(nullptr, agl::mem::make_unique<agl::ecs::system_base>(pool.make_allocator<int>(), int_writer<0>{ &trace }));
+		ecs.add_system(nullptr, agl::mem::make_unique<agl::ecs::system_base>(pool.make_allocator<int>(), int_writer<1>{ &trace }));
+		ecs.add_system(nullptr, agl::mem::make_unique<agl::ecs::system_base>(pool.make_allocator<int>(), int_to_float{ &trace }));
+
+		for (auto frame = 0; frame < 20; ++frame)
+			static_cast<agl::resource_base&>(ecs).on_update(nullptr);
+
+		// all three systems access 'int', every update must end before the next one starts
+		if (trace.events.size() != 20 * 6)
+			FAIL() << "Invalid update count [ 0 ]";
+
+		for (auto i = std::size_t{ 0 }; i < trace.events.size(); i += 2)
+			if (!trace.events[i].begin || trace.events[i + 1].begin || trace.events[i].system != trace.events[i + 1].system)
+				FAIL() << "Conflicting systems ran concurrently [ 0 ]";
+
+		// both writers ran before the reader in every frame
+		for (auto i = std::size_t{ 4 }; i < trace.events.size(); i += 6)
+			if (trace.events[i].system != 2)
+				FAIL() << "Reader ran before a writer [ 0 ]";
+
+		if (ecs.get_system<main_thread_system>().m_wrong_thread)
+			FAIL() << "Exclusive system ran on a worker thread [ 0 ]";
+
+		for (auto i = 0; i < 100; ++i)
+			if (entities[i].get_component<int>(0) != i + 40 || entities[i].get_component<float>(0) != static_cast<float>(i + 40))
+				FAIL() << "Invalid value after update [ 0 ]";
+
+		for (auto& ent : entities)
+			ecs.destroy_entity(ent);
+	}
+	static_cast<agl::resource_base&>(workers).on_detach(nullptr);
+}
+
+TEST(ECS, for_each_parallel)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(64 * 1024 * 1024);
+
+	auto workers = agl::jobs{ 3 };
+	static_cast<agl::resource_base&>(workers).on_attach(nullptr);
+
+	for (auto storage : { agl::ecs::SPARSE_STORAGE, agl::ecs::ARCHETYPE_STORAGE })
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>(), storage };
+		auto entities = std::vector<agl::ecs::entity>{};
+
+		ecs.set_jobs(&workers);
+		for (auto i = 0; i < 4096; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities[i], i);
+			ecs.push_component<float>(entities[i], 0.f);
+		}
+
+		ecs.for_each_parallel<int, float>([](int& v, float& f) { f = static_cast<float>(v * 2); });
+
+		for (auto i = 0; i < 4096; ++i)
+			if (entities[i].get_component<float>(0) != static_cast<float>(i * 2))
+				FAIL() << "Invalid value after parallel update [ " << storage << " ]";
+
+		// per chunk sums do not depend on the worker count
+		auto& q = ecs.get_query<int, float>();
+		auto const chunks = q.parallel_chunk_count(&workers, agl::ecs::DETERMINISTIC);
+		auto parallel = std::vector<std::int64_t>(chunks, 0);
+		auto serial = std::vector<std::int64_t>(q.parallel_chunk_count(nullptr, agl::ecs::DETERMINISTIC), 0);
+
+		q.for_each_parallel(&workers, [&parallel](std::uint64_t chunk, int& v, float&) { parallel[chunk] += v; }, agl::ecs::DETERMINISTIC);
+		q.for_each_parallel(nullptr, [&serial](std::uint64_t chunk, int& v, float&) { serial[chunk] += v; }, agl::ecs::DETERMINISTIC);
+
+		if (chunks < 2 || parallel != serial)
+			FAIL() << "Deterministic chunks differ [ " << storage << " ]";
+
+		for (auto& ent : entities)
+			ecs.destroy_entity(ent);
+	}
+	static_cast<agl::resource_base&>(workers).on_detach(nullptr);
+}
+
+TEST(ECS, command_buffer)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(64 * 1024 * 1024);
+
+	auto workers = agl::jobs{ 3 };
+	static_cast<agl::resource_base&>(workers).on_attach(nullptr);
+
+	for (auto storage : { agl::ecs::SPARSE_STORAGE, agl::ecs::ARCHETYPE_STORAGE })
+	{ // ensure pool gets destroyed as last
+		auto ecs = agl::ecs::organizer{ pool.make_allocator<int>(), storage };
+		auto entities = std::vector<agl::ecs::entity>{};
+
+		ecs.set_jobs(&workers);
+		for (auto i = 0; i < 1000; ++i)
+		{
+			entities.push_back(ecs.make_entity());
+			ecs.push_component<int>(entities[i], i);
+		}
+
+		// odd entities get destroyed, even ones get a float, every tenth spawns a new entity
+		workers.parallel_for(0, entities.size(), 64, [&ecs, &entities](std::uint64_t first, std::uint64_t last)
+			{
+				auto& commands = ecs.get_command_buffer();
+				for (auto i = first; i < last; ++i)
+				{
+					if (i % 2 == 1)
+						commands.destroy_entity(entities[i]);
+					else
+						commands.push_component<float>(entities[i], static_cast<float>(i));
+
+					if (i % 10 == 0)
+					{
+						auto spawned = commands.make_entity();
+						commands.push_component<int>(spawned, -1);
+					}
+				}
+			});
+
+		// recorded twice, must not be applied twice
+		ecs.get_command_buffer().destroy_entity(entities[1]);
+
+		if (ecs.get_component_count<int>() != 1000 || ecs.get_component_count<float>() != 0)
+			FAIL() << "Commands applied before play back [ " << storage << " ]";
+
+		ecs.play_commands();
+
+		if (ecs.get_component_count<int>() != 600 || ecs.get_component_count<float>() != 500)
+			FAIL() << "Invalid component count after play back [ " << storage << " ]";
+
+		for (auto i = 0; i < 1000; ++i)
+		{
+			if ((i % 2 == 1) == entities[i].is_valid())
+				FAIL() << "Invalid entity state after play back [ " << storage << " ]";
+
+			if (i % 2 == 0 && entities[i].get_component<float>(0) != static_cast<float>(i))
+				FAIL() << "Invalid component after play back [ " << storage << " ]";
+		}
+
+		auto spawned = 0;
+		ecs.for_each<int>([&spawned](int& v) { spawned += v == -1 ? 1 : 0; });
+		if (spawned != 100)
+			FAIL() << "Spawned entities missing [ " << storage << " ]";
+
+		// commands of a single entity are played back in the order they were recorded
+		ecs.get_command_buffer().pop_components<float>(entities[0]);
+		ecs.get_command_buffer().push_component<float>(entities[0], -1.f);
+		ecs.get_command_buffer().push_component<float>(entities[2], -2.f);
+		ecs.get_command_buffer().pop_components<float>(entities[2]);
+		ecs.play_commands();
+
+		if (entities[0].size<float>() != 1 || entities[0].get_component<float>(0) != -1.f || entities[2].has_component<float>())
+			FAIL() << "Invalid command order [ " << storage << " ]";
+
+		// payloads live in the pool, a page of its own for an oversized one is given back once played
+		struct large
+		{
+			std::byte data[3 * 4096];
+		};
+		auto const occupancy = pool.occupancy();
+		ecs.get_command_buffer().push_component<large>(entities[1], large{});
+		if (pool.occupancy() <= occupancy)
+			FAIL() << "Payload not taken from the pool [ " << storage << " ]";
+
+		ecs.play_commands();
+		if (pool.occupancy() != occupancy)
+			FAIL() << "Payload page kept after play back [ " << storage << " ]";
+
+		for (auto ent : ecs.view<int>())
+			ecs.destroy_entity(ent);
+	}
+	static_cast<agl::resource_base&>(workers).on_detach(nullptr);
+}
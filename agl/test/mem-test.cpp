@@ -1,10 +1,20 @@
 #include <gtest/gtest.h>
+#include <agl/memory/frame-arena.hpp>
+#include <agl/memory/object-pool.hpp>
 #include <agl/memory/pool.hpp>
+#include <agl/memory/stack-arena.hpp>
+#include <agl/memory/tracker.hpp>
+#include <agl/memory/virtual-memory.hpp>
 #include <agl/util/random.hpp>
 #include <agl/vector.hpp>
 #include <agl/set.hpp>
+#include <agl/unique-ptr.hpp>
 #include <algorithm>
 #include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
 
 template <typename T>
 struct allocation
@@ -48,7 +58,8 @@ TEST(pool, impl_defragmented_space)
 
 TEST(memory, pool_fill_whole)
 {
-	auto pool = agl::mem::pool{};
+	// a single chunk, 'full' is never reached while the pool may still grow
+	auto pool = agl::mem::pool{ sizeof(int) * 10000, sizeof(int) * 10000 };
 	pool.create(sizeof(int) * 10000);
 
 	{ // ensure pool gets destroyed as last
@@ -76,15 +87,16 @@ TEST(memory, pool_fill_whole)
 }
 TEST(memory, pool_random_allocs)
 {
-	auto pool = agl::mem::pool{};
+	auto pool = agl::mem::pool{ 1024 * 100, 1024 * 100 };
 	pool.create(1024 * 100);
 
 	{ // ensure pool gets destroyed as last
 		auto allocator = pool.make_allocator<std::byte>();
 		auto allocs = agl::set<allocation<std::byte>>{};
-		auto occupancy = 0;
+		auto occupancy = std::uint64_t{ 0 };
+		// small blocks take the whole block of their size class
+		auto class_size = [](std::uint64_t size) -> std::uint64_t { return size <= 8 ? 8 : (size + 15) / 16 * 16; };
 
-		
 		allocs.reserve(5000);
 		// push random
 		for (auto i = 0; i < 2500; ++i)
@@ -96,7 +108,7 @@ TEST(memory, pool_random_allocs)
 				FAIL() << "Invalid pointer returned";
 
 			allocs.emplace({ ptr, size });
-			occupancy += size;
+			occupancy += class_size(size);
 		}
 
 		if (pool.occupancy() != occupancy)
@@ -111,34 +123,524 @@ TEST(memory, pool_random_allocs)
 			allocs.erase(it);
 		}
 
-		// fill till full
+		// fill till no free space is left, the blocks freed above stay with their size class
 		allocs.reserve(80000);
-		while (!pool.full())
+		while (!pool.full() && pool.get_fragmentation().free_size != 0)
 		{
-			auto* ptr = allocator.allocate();
+			auto* ptr = allocator.allocate(8);
 
 			if (!pool.has_pointer(reinterpret_cast<std::byte*>(ptr)))
 				FAIL() << "Invalid pointer returned";
-			allocs.emplace({ ptr, 1 });
+			allocs.emplace({ ptr, 8 });
 		}
 
-		// sort allocs and check if there are gaps or if allocated objects are overlapping
-		std::sort(allocs.begin(), allocs.end(), [](auto const& lhs, auto const& rhs) { return lhs.ptr < rhs.ptr; });
+		// allocated objects must not overlap and together make up the whole occupancy
 		auto overlapping = 0;
-		auto unused_memory = 0;
-		for (auto it = allocs.cbegin(); it != allocs.cend() - 1; ++it)
+		occupancy = 0;
+		for (auto it = allocs.cbegin(); it != allocs.cend(); ++it)
 		{
-			auto next = it++;
-			if (it->ptr + it->size > next->ptr)
+			auto next = it + 1;
+			if (next != allocs.cend() && it->ptr + class_size(it->size) > next->ptr)
 				++overlapping;
-			else if (it->ptr + it->size < next->ptr)
-				++unused_memory;
+			occupancy += class_size(it->size);
+		}
+
+		if (overlapping > 0 || pool.occupancy() != occupancy)
+			FAIL() << "Overlapping: " << overlapping << " unaccounted memory: " << pool.occupancy() - occupancy;
+
+		for (auto& alloc : allocs)
+			allocator.deallocate(alloc.ptr, alloc.size);
+	}
+}
+
+TEST(memory, pool_size_classes)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(1024 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto allocator = pool.make_allocator<std::byte>();
+		auto allocs = agl::vector<allocation<std::byte>>{};
+		allocs.reserve(2048);
+
+		for (auto i = 0; i < 2048; ++i)
+		{
+			auto const size = agl::simple_rand<std::uint64_t>(1, 512);
+			auto* ptr = allocator.allocate(size, size > 8 ? 16 : 8);
+
+			if (!pool.has_pointer(ptr))
+				FAIL() << "Invalid pointer returned";
+
+			if (reinterpret_cast<std::uintptr_t>(ptr) % (size > 8 ? 16 : 8) != 0)
+				FAIL() << "Invalid alignment";
+
+			allocs.push_back({ ptr, size });
 		}
 
-		if (overlapping > 0 || unused_memory > 0)
-			FAIL() << "Overlapping: " << overlapping << " unused memory: " << unused_memory;
+		// a freed block is handed out again to the next allocation of its class
+		auto const reused = allocs[100];
+		allocator.deallocate(reused.ptr, reused.size);
+		allocs[100].ptr = allocator.allocate(reused.size, reused.size > 8 ? 16 : 8);
+		if (allocs[100].ptr != reused.ptr)
+			FAIL() << "Freed block was not reused";
+
+		// blocks with a stronger alignment than their class provides and large blocks use the free spaces
+		auto* aligned = allocator.allocate(24, 64);
+		auto* large = allocator.allocate(4096, 8);
+		if (reinterpret_cast<std::uintptr_t>(aligned) % 64 != 0)
+			FAIL() << "Invalid alignment";
+
+		allocs.push_back({ aligned, 24 });
+		allocs.push_back({ large, 4096 });
+
+		std::sort(allocs.begin(), allocs.end());
+		for (auto it = allocs.cbegin(); it + 1 != allocs.cend(); ++it)
+			if (it->ptr + it->size > (it + 1)->ptr)
+				FAIL() << "Overlapping allocations";
+
+		for (auto& alloc : allocs)
+			allocator.deallocate(alloc.ptr, alloc.size);
+
+		if (!pool.empty())
+			FAIL() << "Invalid pool occupancy";
+	}
+}
+TEST(memory, pool_coalescing)
+{
+	auto pool = agl::mem::pool{};
+	pool.create(64 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto allocator = pool.make_allocator<std::byte>();
+		auto allocs = agl::vector<std::byte*>{};
+		allocs.reserve(64);
+
+		// blocks above the size class limit filling the whole pool, served by the best-fit path
+		for (auto i = 0; i < 64; ++i)
+			allocs.push_back(allocator.allocate(1024, 8));
+
+		// free every other block, the free spaces are scattered
+		for (auto i = 0; i < 64; i += 2)
+			allocator.deallocate(allocs[i], 1024);
+
+		auto frag = pool.get_fragmentation();
+		if (frag.free_block_count != 32 || frag.largest_free_block != 1024 || frag.ratio < 0.9)
+			FAIL() << "Invalid fragmentation report";
+
+		// freeing the rest merges everything back into a single space
+		for (auto i = 1; i < 64; i += 2)
+			allocator.deallocate(allocs[i], 1024);
+
+		frag = pool.get_fragmentation();
+		if (frag.free_block_count != 1 || frag.largest_free_block != pool.size() || frag.ratio != 0.0)
+			FAIL() << "Free spaces were not merged";
+
+		auto* whole = allocator.allocate(pool.size(), 8);
+		if (whole == nullptr)
+			FAIL() << "Merged space cannot be allocated";
+
+		allocator.deallocate(whole, pool.size());
+
+		// the free space picked must still fit the block once aligned, its padding goes back to the free spaces
+		auto* offset = allocator.allocate(1000, 8);
+		auto* aligned = allocator.allocate(2048, 4096);
+		if (reinterpret_cast<std::uintptr_t>(aligned) % 4096 != 0 || !pool.has_pointer(aligned))
+			FAIL() << "Invalid alignment";
+
+		if (pool.occupancy() != 1000 + 2048)
+			FAIL() << "Padding counted as occupied";
+
+		allocator.deallocate(aligned, 2048);
+		allocator.deallocate(offset, 1000);
+
+		frag = pool.get_fragmentation();
+		if (frag.free_block_count != 1 || frag.largest_free_block != pool.size())
+			FAIL() << "Padding was not merged back";
+	}
+}
+TEST(memory, pool_chunks)
+{
+	auto pool = agl::mem::pool{ 64 * 1024, 256 * 1024 };
+	pool.create(64 * 1024);
+
+	{ // ensure pool gets destroyed as last
+		auto allocator = pool.make_allocator<std::byte>();
+		auto allocs = agl::vector<allocation<std::byte>>{};
+		allocs.reserve(256);
+
+		// four times the first chunk
+		for (auto i = 0; i < 128; ++i)
+			allocs.push_back({ allocator.allocate(1024, 8), 1024 });
+		for (auto i = 0; i < 128; ++i)
+			allocs.push_back({ allocator.allocate(16, 16), 16 });
+
+		if (pool.chunk_count() < 3 || pool.size() > pool.get_max_size())
+			FAIL() << "Pool did not grow";
+
+		// blocks cached by the thread still count in their chunk
+		pool.flush_thread_cache();
+		auto occupancy = std::uint64_t{ 0 };
+		for (auto i = std::uint64_t{ 0 }; i < pool.chunk_count(); ++i)
+			occupancy += pool.get_chunk_usage(i).occupancy;
+
+		if (occupancy != pool.occupancy())
+			FAIL() << "Invalid chunk occupancy";
 
+		for (auto& alloc : allocs)
+			if (!pool.has_pointer(alloc.ptr))
+				FAIL() << "Invalid pointer returned";
+
+		// empty chunks are given back, except the last one
 		for (auto& alloc : allocs)
 			allocator.deallocate(alloc.ptr, alloc.size);
+
+		pool.flush_thread_cache();
+		if (pool.chunk_count() != 1 || !pool.empty())
+			FAIL() << "Empty chunks were not released";
+
+		// a block larger than the chunk size gets a chunk of its own
+		auto* large = allocator.allocate(128 * 1024, 8);
+		if (!pool.has_pointer(large) || pool.chunk_count() != 2)
+			FAIL() << "Large block was not allocated";
+
+		allocator.deallocate(large, 128 * 1024);
+	}
+}
+TEST(memory, pool_mapped)
+{
+	constexpr auto chunk_size = 1024 * 1024;
+	constexpr auto block_size = 256 * 1024;
+
+	for (auto backing : { agl::mem::pool::MAPPED, agl::mem::pool::HUGE_PAGES, agl::mem::pool::POPULATE })
+	{
+		auto pool = agl::mem::pool{ chunk_size, agl::mem::pool::unlimited(), backing };
+		pool.create(chunk_size);
+
+		auto const alignment = backing == agl::mem::pool::HUGE_PAGES ? agl::mem::virtual_memory::huge_page_size() : agl::mem::virtual_memory::page_size();
+		if (reinterpret_cast<std::uintptr_t>(pool.get_chunk_usage(0).memory) % alignment != 0)
+			FAIL() << "Chunk is not aligned to its pages";
+
+		// the pages of the freed block are discarded, reusing them is fine
+		auto* first = pool.allocate(block_size, 16);
+		std::memset(first, 0xAB, block_size);
+		pool.deallocate(first, block_size);
+
+		auto* second = pool.allocate(block_size, 16);
+		std::memset(second, 0xCD, block_size);
+		auto* small = pool.allocate(64, 16);
+		std::memset(small, 0xEF, 64);
+
+		// past the first chunk
+		auto* large = pool.allocate(2 * chunk_size, 16);
+		std::memset(large, 0x12, 2 * chunk_size);
+		if (pool.chunk_count() != 2 || static_cast<std::uint8_t>(second[block_size - 1]) != 0xCD)
+			FAIL() << "Invalid mapped chunks";
+
+		pool.deallocate(large, 2 * chunk_size);
+		pool.deallocate(small, 64);
+		pool.deallocate(second, block_size);
+		pool.flush_thread_cache();
+		pool.destroy();
 	}
+}
+
+TEST(memory, pool_threads)
+{
+	auto pool = agl::mem::pool{ 256 * 1024 };
+	pool.create(256 * 1024);
+
+	constexpr auto thread_count = 4;
+	constexpr auto alloc_count = 2000;
+	auto allocs = std::array<agl::vector<allocation<std::byte>>, thread_count>{};
+	auto threads = std::array<std::thread, thread_count>{};
+
+	for (auto t = 0; t < thread_count; ++t)
+		threads[t] = std::thread{ [&pool, &allocs, t]()
+			{
+				auto& mine = allocs[t];
+				mine.reserve(alloc_count);
+				for (auto i = 0; i < alloc_count; ++i)
+				{
+					auto const size = i % 10 == 0 ? std::uint64_t{ 2048 } : std::uint64_t{ 1 } + (i * 37) % 256;
+					auto* ptr = pool.allocate(size, 8);
+					std::memset(ptr, t, size);
+					mine.push_back({ ptr, size });
+				}
+			} };
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (auto t = 0; t < thread_count; ++t)
+		for (auto const& alloc : allocs[t])
+			for (auto i = std::uint64_t{ 0 }; i < alloc.size; ++i)
+				if (alloc.ptr[i] != static_cast<std::byte>(t))
+					FAIL() << "Block was handed out twice";
+
+	// every thread frees the blocks of its neighbour, they go to its own cache
+	for (auto t = 0; t < thread_count; ++t)
+		threads[t] = std::thread{ [&pool, &allocs, t]()
+			{
+				for (auto const& alloc : allocs[(t + 1) % thread_count])
+					pool.deallocate(alloc.ptr, alloc.size);
+			} };
+
+	for (auto& thread : threads)
+		thread.join();
+
+	if (!pool.empty())
+		FAIL() << "Invalid pool occupancy";
+
+	// the threads exited, their caches went back to the shared free lists
+	for (auto i = std::uint64_t{ 0 }; i < pool.chunk_count(); ++i)
+		if (pool.get_chunk_usage(i).occupancy != 0)
+			FAIL() << "Blocks of an exited thread still cached [ 0 ]";
+
+	// a thread switching between two pools keeps a cache in each
+	auto other = agl::mem::pool{ 256 * 1024 };
+	other.create(256 * 1024);
+	std::thread{ [&pool, &other]()
+		{
+			for (auto i = 0; i < alloc_count; ++i)
+			{
+				auto* lhs = pool.allocate(32, 8);
+				auto* rhs = other.allocate(32, 8);
+				pool.deallocate(lhs, 32);
+				other.deallocate(rhs, 32);
+			}
+		} }.join();
+
+	if (!pool.empty() || !other.empty() || pool.get_chunk_usage(0).occupancy != 0 || other.get_chunk_usage(0).occupancy != 0)
+		FAIL() << "Blocks of an exited thread still cached [ 1 ]";
+}
+TEST(memory, frame_arena)
+{
+	auto arena = agl::mem::frame_arena{ 4096 };
+
+	auto values = agl::mem::frame_vector<int>{ arena.make_allocator<int>() };
+	for (auto i = 0; i < 1000; ++i)
+	{
+		values.push_back(i);
+	}
+
+	for (auto i = 0; i < 1000; ++i)
+		if (values[i] != i)
+			FAIL() << "Invalid value";
+
+	auto* aligned = arena.allocate(24, 64);
+	if (reinterpret_cast<std::uintptr_t>(aligned) % 64 != 0)
+		FAIL() << "Invalid alignment";
+
+	auto* kept = reinterpret_cast<int*>(arena.allocate(sizeof(int), alignof(int), agl::mem::frame_arena::DOUBLE_FRAME));
+	*kept = 42;
+
+	// the arena grew during the frame, its blocks are merged on reset
+	auto const size = arena.size();
+	if (arena.occupancy() < 1000 * sizeof(int) || size <= 4096)
+		FAIL() << "Invalid arena occupancy";
+
+	values = agl::mem::frame_vector<int>{};
+	arena.reset();
+	if (*kept != 42 || arena.frame() != 1)
+		FAIL() << "Double buffered allocation did not survive the frame";
+
+	auto* first = arena.allocate(16, 16);
+	arena.reset();
+	auto* second = arena.allocate(16, 16);
+	if (first != second || arena.size() != size)
+		FAIL() << "Arena memory was not reused";
+
+	if (arena.occupancy() != 16)
+		FAIL() << "Invalid arena occupancy";
+}
+TEST(memory, stack_arena)
+{
+	auto stack = agl::mem::stack_arena{ 1024 };
+
+	{
+		auto const scope = agl::mem::stack_arena::scope{ stack };
+		auto values = agl::mem::stack_vector<int>{ stack.make_allocator<int>() };
+		values.reserve(16);
+		for (auto i = 0; i < 16; ++i)
+			values.push_back(i);
+
+		// strictly nested, everything is released on leaving the scope
+		auto const occupancy = stack.occupancy();
+		{
+			auto const inner = agl::mem::stack_arena::scope{ stack };
+			auto sorted = agl::mem::stack_set<int>{ stack.make_allocator<int>() };
+			sorted.reserve(16);
+			for (auto i = 15; i >= 0; --i)
+				sorted.emplace(i);
+
+			if (*sorted.cbegin() != 0 || stack.occupancy() < occupancy + 16 * sizeof(int))
+				FAIL() << "Invalid set";
+		}
+
+		if (stack.occupancy() != occupancy)
+			FAIL() << "Inner scope was not released";
+
+		auto const marker = stack.get_marker();
+		auto* top = stack.allocate(64, 16);
+		stack.deallocate(top, 64);
+		if (stack.get_marker().offset != marker.offset)
+			FAIL() << "Top allocation was not popped";
+
+		// past the buffer allocations go to the heap, they are released by the scope as well
+		auto* overflow = stack.allocate(4096, 8);
+		std::memset(overflow, 0, 4096);
+	}
+
+	if (stack.occupancy() != 0)
+		FAIL() << "Scope was not released";
+}
+
+TEST(memory, object_pool)
+{
+	struct node
+	{
+		std::uint64_t value;
+		node* next;
+	};
+
+	auto pool = agl::mem::object_pool<node>{ 4 };
+	auto nodes = agl::vector<node*>{};
+	nodes.reserve(16);
+	for (auto i = std::uint64_t{ 0 }; i < 16; ++i)
+		nodes.push_back(pool.make(node{ i, nullptr }));
+
+	// slabs of 4, 8 then 16 objects
+	if (pool.slab_count() != 3 || pool.capacity() != 28 || pool.occupancy() != 16)
+		FAIL() << "Invalid slab growth";
+
+	for (auto i = std::uint64_t{ 0 }; i < 16; ++i)
+		if (nodes[i]->value != i)
+			FAIL() << "Object was overwritten";
+
+	// freed slots are reused first, most recent first
+	auto* freed = nodes[5];
+	pool.destroy(freed);
+	nodes[5] = pool.make(node{ 5, nullptr });
+	if (nodes[5] != freed || pool.slab_count() != 3)
+		FAIL() << "Slot was not reused";
+
+	for (auto* n : nodes)
+		pool.destroy(n);
+
+	if (pool.occupancy() != 0)
+		FAIL() << "Invalid occupancy";
+
+	{
+		// single objects come from the pool, arrays from the heap
+		using allocator_type = agl::mem::object_pool<node>::allocator<node>;
+		auto ptr = agl::unique_ptr<node, allocator_type>{ pool.make_allocator(), pool.make_allocator().allocate() };
+		*ptr = node{ 42, nullptr };
+		if (pool.occupancy() != 1)
+			FAIL() << "Object was not allocated from the pool";
+
+		auto allocator = pool.make_allocator<std::uint64_t>();
+		auto* array = allocator.allocate(64);
+		std::memset(array, 0, 64 * sizeof(std::uint64_t));
+		if (pool.occupancy() != 1)
+			FAIL() << "Array was allocated from the pool";
+
+		allocator.deallocate(array, 64);
+	}
+
+	if (pool.occupancy() != 0)
+		FAIL() << "Invalid occupancy";
+}
+
+TEST(memory, tracker)
+{
+	auto tracker = agl::mem::tracker{};
+	auto ints = std::array<int, 4>{};
+	auto floats = std::array<float, 2>{};
+	auto const* site_a = static_cast<void const*>(&ints);
+	auto const* site_b = static_cast<void const*>(&floats);
+
+	tracker.on_allocate(agl::type_id<int>::get_id(), &ints[0], 64, site_a);
+	tracker.on_allocate(agl::type_id<int>::get_id(), &ints[1], 32, site_b);
+	auto const before = tracker.take_snapshot();
+
+	tracker.on_deallocate(&ints[0]);
+	tracker.on_allocate(agl::type_id<float>::get_id(), &floats[0], 16, site_a);
+	tracker.on_allocate(agl::type_id<float>::get_id(), &floats[1], 16, site_a);
+	tracker.on_deallocate(&floats[1]);
+	// unknown pointers are ignored
+	tracker.on_deallocate(&ints[2]);
+	auto const after = tracker.take_snapshot();
+
+	auto const* int_stats = after.find(agl::type_id<int>::get_id());
+	if (int_stats == nullptr || int_stats->count != 1 || int_stats->bytes != 32 || int_stats->peak_bytes != 96 || int_stats->total_count != 2)
+		FAIL() << "Invalid type stats";
+
+	if (after.get_bytes() != 48 || after.get_peak_bytes() != 96 || after.get_sites().size() != 3)
+		FAIL() << "Invalid totals";
+
+	auto const diff = after.diff(before);
+	auto const* int_diff = diff.find(agl::type_id<int>::get_id());
+	auto const* float_diff = diff.find(agl::type_id<float>::get_id());
+	if (int_diff == nullptr || int_diff->count != -1 || int_diff->bytes != -64 || int_diff->total_count != 0)
+		FAIL() << "Invalid diff of a released type";
+
+	if (float_diff == nullptr || float_diff->count != 1 || float_diff->bytes != 16 || float_diff->total_count != 2)
+		FAIL() << "Invalid diff of a new type";
+
+	// the allocation from 'site_b' did not change
+	if (diff.get_bytes() != -48 || diff.get_sites().size() != 2)
+		FAIL() << "Invalid diff";
+
+	auto const path = std::string{ "agl-tracker-test.csv" };
+	if (!after.dump(path))
+		FAIL() << "Could not dump the snapshot";
+
+	auto file = std::ifstream{ path };
+	auto line = std::string{};
+	auto lines = 0;
+	while (std::getline(file, line))
+		++lines;
+
+	file.close();
+	std::remove(path.c_str());
+
+	// header, total, 2 types, 3 sites
+	if (lines != 7)
+		FAIL() << "Invalid dump";
+}
+
+
+TEST(memory, tracker_sites)
+{
+	auto sites = std::array<int, 2>{};
+
+	// the outermost scope wins, containers calling each other report the site of the user
+	{
+		auto const outer = agl::mem::tracker::site_scope{ &sites[0] };
+		auto const inner = agl::mem::tracker::site_scope{ &sites[1] };
+		if (agl::mem::tracker::get_site(nullptr) != &sites[0])
+			FAIL() << "Invalid nested site";
+	}
+
+	if (agl::mem::tracker::get_site(&sites[1]) != &sites[1])
+		FAIL() << "Site kept after its scope";
+
+#if defined(AGL_TRACK_ALLOCATIONS) && defined(AGL_DEBUG)
+	// sites are only exact where the containers are not inlined
+	auto const before = agl::mem::tracker::get().take_snapshot();
+
+	auto first = agl::vector<std::uint16_t>{};
+	auto second = agl::vector<std::uint16_t>{};
+	first.push_back(1);
+	second.push_back(2);
+
+	auto const diff = agl::mem::tracker::get().take_snapshot().diff(before);
+	auto const count = std::count_if(diff.get_sites().begin(), diff.get_sites().end(), [](agl::mem::tracker::site_stats const& s)
+		{
+			return s.type == agl::type_id<std::uint16_t>::get_id() && s.count == 1;
+		});
+
+	if (count != 2)
+		FAIL() << "Call sites not told apart";
+#endif
 }
\ No newline at end of file